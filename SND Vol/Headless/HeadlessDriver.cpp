@@ -0,0 +1,219 @@
+#include <chrono>
+#include <iostream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "MeterBallistics.h"
+#include "NotificationFilters.h"
+#include "PeakPollingScheduler.h"
+#include "SlotMap.h"
+#include "SyntheticSessionScript.h"
+
+using namespace std;
+using namespace Audio;
+using namespace System;
+
+/*
+* Runs the synthetic session script against the platform independent parts of the metering and event paths: sessions are indexed in a
+* slot map, creation notifications go through the creation filter (every creation is notified twice, like the audio service can), peaks
+* are smoothed by the meter ballistics and polled at the rate chosen by the polling scheduler. Time is simulated, the run is deterministic.
+* 
+* Usage: SNDVolHeadless [simulated seconds] [session count]
+*/
+
+namespace
+{
+    struct HeadlessSession
+    {
+        wstring instanceId{};
+        bool active = false;
+        float peak = 0.f;
+        float lastPeak = 0.f;
+        MeterChannelState meter{};
+    };
+
+    struct HeadlessStatistics
+    {
+        uint64_t events = 0;
+        uint64_t creations = 0;
+        uint64_t repeatedCreations = 0;
+        uint64_t expirations = 0;
+        uint64_t polls = 0;
+        uint64_t steps = 0;
+        uint64_t ratePolls[3]{};
+    };
+}
+
+int main(int argc, char** argv)
+{
+    int64_t seconds = argc > 1 ? atoll(argv[1]) : 10;
+    SyntheticSessionSettings settings{};
+    if (argc > 2)
+    {
+        settings.sessionCount = static_cast<uint32_t>(atoi(argv[2]));
+    }
+    if (seconds <= 0)
+    {
+        cerr << "Usage: SNDVolHeadless [simulated seconds] [session count]" << endl;
+        return 2;
+    }
+
+    SyntheticSessionScript script{ settings };
+    SlotMap<HeadlessSession> sessions{};
+    sessions.Reserve(settings.sessionCount);
+    // Script slot -> handle of the session in the slot map.
+    vector<SlotHandle> handles{};
+    SessionCreationFilter creationFilter{};
+    MeterBallistics ballistics{};
+    PeakPollingScheduler scheduler{};
+    HeadlessStatistics statistics{};
+    uint32_t generation = 0;
+
+    const chrono::milliseconds tick{ 1 };
+    const chrono::milliseconds end{ seconds * 1000 };
+    chrono::milliseconds now{ 0 };
+    chrono::milliseconds lastPoll{ 0 };
+    chrono::milliseconds nextPoll{ scheduler.Interval(scheduler.Rate()) };
+    vector<SyntheticEvent> events{};
+    while (now < end)
+    {
+        events.clear();
+        script.Advance(tick, events);
+        now += tick;
+        statistics.events += events.size();
+
+        for (const SyntheticEvent& event : events)
+        {
+            if (event.session >= handles.size())
+            {
+                handles.resize(event.session + 1);
+            }
+
+            switch (event.type)
+            {
+                case SyntheticEventType::Add:
+                {
+                    HeadlessSession session{};
+                    session.instanceId = L"synthetic|" + to_wstring(event.session) + L"|" + to_wstring(++generation);
+                    session.active = event.value > 0.f;
+
+                    statistics.repeatedCreations += creationFilter.Accept(session.instanceId) ? 0 : 1;
+                    statistics.repeatedCreations += creationFilter.Accept(session.instanceId) ? 0 : 1;
+                    statistics.creations++;
+
+                    if (session.active && scheduler.Rate() == PeakPollingRate::Stopped)
+                    {
+                        scheduler.Wake(now);
+                        nextPoll = now + scheduler.Interval(scheduler.Rate());
+                    }
+                    handles[event.session] = sessions.Insert(move(session));
+                    break;
+                }
+                case SyntheticEventType::Expire:
+                {
+                    if (HeadlessSession* session = sessions.Get(handles[event.session]))
+                    {
+                        creationFilter.Remove(session->instanceId);
+                    }
+                    sessions.Remove(handles[event.session]);
+                    statistics.expirations++;
+                    break;
+                }
+                case SyntheticEventType::Activate:
+                case SyntheticEventType::Deactivate:
+                {
+                    if (HeadlessSession* session = sessions.Get(handles[event.session]))
+                    {
+                        session->active = event.type == SyntheticEventType::Activate;
+                        if (session->active && scheduler.Rate() == PeakPollingRate::Stopped)
+                        {
+                            scheduler.Wake(now);
+                            nextPoll = now + scheduler.Interval(scheduler.Rate());
+                        }
+                    }
+                    break;
+                }
+                case SyntheticEventType::Peak:
+                {
+                    if (HeadlessSession* session = sessions.Get(handles[event.session]))
+                    {
+                        session->peak = event.value;
+                    }
+                    break;
+                }
+                case SyntheticEventType::Volume:
+                default:
+                    break;
+            }
+        }
+
+        if (scheduler.Rate() == PeakPollingRate::Stopped || now < nextPoll)
+        {
+            continue;
+        }
+
+        // Poll: every active session is stepped by the time elapsed since the previous poll.
+        ballistics.Prepare(now - lastPoll);
+        lastPoll = now;
+        uint32_t activeCount = 0;
+        float maxPeak = 0.f;
+        float maxDelta = 0.f;
+        for (HeadlessSession& session : sessions)
+        {
+            if (!session.active)
+            {
+                session.peak = 0.f;
+            }
+            else
+            {
+                activeCount++;
+            }
+
+            ballistics.Step(session.meter, session.peak);
+            statistics.steps++;
+
+            float delta = session.peak > session.lastPeak ? session.peak - session.lastPeak : session.lastPeak - session.peak;
+            maxPeak = session.peak > maxPeak ? session.peak : maxPeak;
+            maxDelta = delta > maxDelta ? delta : maxDelta;
+            session.lastPeak = session.peak;
+        }
+
+        chrono::milliseconds interval = scheduler.Update(activeCount, maxPeak, maxDelta, now);
+        statistics.polls++;
+        switch (scheduler.Rate())
+        {
+            case PeakPollingRate::Fast:
+                statistics.ratePolls[0]++;
+                break;
+            case PeakPollingRate::Normal:
+                statistics.ratePolls[1]++;
+                break;
+            case PeakPollingRate::Idle:
+                statistics.ratePolls[2]++;
+                break;
+            default:
+                break;
+        }
+        nextPoll = now + interval;
+    }
+
+    cout << "Simulated " << seconds << " s with " << settings.sessionCount << " sessions: " << statistics.events << " events, "
+        << statistics.creations << " creations (" << statistics.repeatedCreations << " repeated notifications filtered), "
+        << statistics.expirations << " expirations." << endl;
+    cout << statistics.polls << " polls (" << statistics.ratePolls[0] << " fast, " << statistics.ratePolls[1] << " normal, "
+        << statistics.ratePolls[2] << " idle), " << statistics.steps << " meter steps." << endl;
+
+    // The churn replaces every expired session: the index and the filter must hold exactly the live sessions, and every doubled creation
+    // must have been filtered.
+    bool consistent = sessions.Size() == settings.sessionCount &&
+        creationFilter.Size() == settings.sessionCount &&
+        statistics.repeatedCreations == statistics.creations &&
+        statistics.creations == settings.sessionCount + statistics.expirations;
+    if (!consistent)
+    {
+        cerr << "Inconsistent state: " << sessions.Size() << " indexed sessions, " << creationFilter.Size() << " filtered sessions." << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include "pch.h"
+#include "AudioEndpointContext.h"
+
+#include "AudioSessionStates.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace winrt;
+
+
+namespace Audio
+{
+    AudioEndpointContext::AudioEndpointContext(IMMDevice* device, const GUID& eventContextId, SessionCreatedHandler&& sessionCreated) :
+        eventContextId{ eventContextId },
+        device{ device },
+        sessionCreated{ move(sessionCreated) }
+    {
+        LPWSTR deviceIdString = nullptr;
+        check_hresult(device->GetId(&deviceIdString));
+        deviceId = deviceIdString;
+        CoTaskMemFree(deviceIdString);
+
+        check_hresult(device->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, NULL, (void**)&audioSessionManager));
+    }
+
+    bool AudioEndpointContext::Register()
+    {
+        if (!isRegistered)
+        {
+            isRegistered = SUCCEEDED(audioSessionManager->RegisterSessionNotification(this));
+        }
+        return isRegistered;
+    }
+
+    bool AudioEndpointContext::Unregister()
+    {
+        if (isRegistered && SUCCEEDED(audioSessionManager->UnregisterSessionNotification(this)))
+        {
+            isRegistered = false;
+        }
+        return !isRegistered;
+    }
+
+    void AudioEndpointContext::GetSessions(vector<AudioSession*>& sessions)
+    {
+        sessionCreationFilter->Clear();
+
+        unordered_set<wstring> liveInstanceIds{};
+        ReconcileSessions(liveInstanceIds, sessions);
+    }
+
+    void AudioEndpointContext::ReconcileSessions(unordered_set<wstring>& liveInstanceIds, vector<AudioSession*>& sessions)
+    {
+        TRACE_SPAN(L"AudioEndpointContext::ReconcileSessions");
+
+        // The enumerator is a snapshot taken at its creation.
+        IAudioSessionEnumeratorPtr audioSessionEnumerator{ nullptr };
+        check_hresult(audioSessionManager->GetSessionEnumerator(&audioSessionEnumerator));
+        int sessionCount = 0;
+        check_hresult(audioSessionEnumerator->GetCount(&sessionCount));
+        for (int i = 0; i < sessionCount; i++)
+        {
+            IAudioSessionControlPtr control;
+            IAudioSessionControl2Ptr control2{ nullptr };
+            if (FAILED(audioSessionEnumerator->GetSession(i, &control)) ||
+                FAILED(control->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&control2)))
+            {
+                continue;
+            }
+
+            try
+            {
+                // Live sessions are left untouched, only the identifier is read.
+                wstring instanceId = GetInstanceId(control2);
+                if (liveInstanceIds.erase(instanceId) > 0)
+                {
+                    continue;
+                }
+
+                if (AudioSession* session = CreateSession(control2, instanceId))
+                {
+                    sessions.push_back(session);
+                }
+            }
+            catch (const hresult_error& ex)
+            {
+                OutputDebugHString(L"AudioEndpointContext::ReconcileSessions failed to create audio session : " + ex.message());
+            }
+        }
+    }
+
+    void AudioEndpointContext::ForgetSession(const wstring& instanceId)
+    {
+        sessionCreationFilter->Remove(instanceId);
+    }
+
+    bool AudioEndpointContext::OwnsSession(const wstring& instanceId)
+    {
+        return sessionCreationFilter->Contains(instanceId);
+    }
+
+    wstring AudioEndpointContext::GetInstanceId(IAudioSessionControl2* control)
+    {
+        LPWSTR instanceIdString = nullptr;
+        check_hresult(control->GetSessionInstanceIdentifier(&instanceIdString));
+        wstring instanceId{ instanceIdString };
+        CoTaskMemFree(instanceIdString);
+        return instanceId;
+    }
+
+
+    #pragma region IUnknown
+    IFACEMETHODIMP_(ULONG) AudioEndpointContext::AddRef()
+    {
+        return ++refCount;
+    }
+
+    IFACEMETHODIMP_(ULONG) AudioEndpointContext::Release()
+    {
+        const uint32_t remaining = --refCount;
+
+        if (remaining == 0)
+        {
+            delete this;
+        }
+
+        return remaining;
+    }
+
+    IFACEMETHODIMP AudioEndpointContext::QueryInterface(REFIID riid, VOID** ppvInterface)
+    {
+        if (riid == IID_IUnknown)
+        {
+            *ppvInterface = static_cast<IUnknown*>(static_cast<IAudioSessionNotification*>(this));
+            AddRef();
+        }
+        else if (riid == __uuidof(IAudioSessionNotification))
+        {
+            *ppvInterface = static_cast<IAudioSessionNotification*>(this);
+            AddRef();
+        }
+        else
+        {
+            *ppvInterface = NULL;
+            return E_POINTER;
+        }
+        return S_OK;
+    }
+    #pragma endregion
+
+
+    AudioSession* AudioEndpointContext::CreateSession(IAudioSessionControl2* control, const wstring& instanceId)
+    {
+        if (!sessionCreationFilter->Accept(instanceId))
+        {
+            return nullptr;
+        }
+
+        AudioSession* session = nullptr;
+        try
+        {
+            session = new AudioSession(control, eventContextId, deviceId);
+        }
+        catch (...)
+        {
+            sessionCreationFilter->Remove(instanceId);
+            throw;
+        }
+
+        session->StateChanged([filter = sessionCreationFilter, instanceId](const winrt::guid&, const uint32_t& state)
+        {
+            // OnStateChanged forwards the system state, OnSessionDisconnected raises AudioSessionStates::Expired.
+            if (state == static_cast<uint32_t>(::AudioSessionState::AudioSessionStateExpired) || state == static_cast<uint32_t>(AudioSessionStates::Expired))
+            {
+                filter->Remove(instanceId);
+            }
+        });
+        return session;
+    }
+
+    STDMETHODIMP AudioEndpointContext::OnSessionCreated(IAudioSessionControl* NewSession)
+    {
+        IAudioSessionControl2Ptr control2{ nullptr };
+        if (FAILED(NewSession->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&control2)))
+        {
+            return S_OK;
+        }
+
+        try
+        {
+            // Windows sends OnSessionCreated event when disabling audio enhancements. The IAudioSessionControl received is not usable, making any calls to it's functions or properties fail.
+            // Creations can also be notified more than once, repeated notifications are recognized by the session instance identifier.
+            AudioSession* newAudioSession = CreateSession(control2, GetInstanceId(control2));
+            if (!newAudioSession)
+            {
+                OutputDebugString(L"Ignoring repeated OnSessionCreated event.");
+                return S_OK;
+            }
+
+            OutputDebugHString(L"New session created " + newAudioSession->Name());
+            sessionCreated(newAudioSession);
+        }
+        catch (const hresult_error& ex)
+        {
+            OutputDebugHString(L"AudioEndpointContext::OnSessionCreated failed to create audio session : " + ex.message());
+        }
+
+        return S_OK;
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <unordered_set>
+#include <vector>
+#include "IComEventImplementation.h"
+#include "AudioSession.h"
+#include "NotificationFilters.h"
+
+namespace Audio
+{
+    /**
+     * @brief Audio endpoint (render or capture device) and the audio sessions playing on it: session manager, session creation
+     * notifications and set of known sessions. Sessions are metered individually, the endpoint meter of the default device is read by
+     * MainAudioEndpoint.
+    */
+    class AudioEndpointContext : public IComEventImplementation, private IAudioSessionNotification
+    {
+    public:
+        using SessionCreatedHandler = std::function<void(AudioSession*)>;
+
+        /**
+         * @brief Default constructor, activates the session manager of the device. Can be called from any MTA thread, not from an
+         * IMMNotificationClient callback.
+         * @param device Device of the endpoint
+         * @param eventContextId GUID given to the audio sessions to ignore their own audio events
+         * @param sessionCreated Called on the notification thread for each session created on the endpoint, once registered
+        */
+        AudioEndpointContext(IMMDevice* device, const GUID& eventContextId, SessionCreatedHandler&& sessionCreated);
+
+        inline std::wstring_view DeviceId() const
+        {
+            return deviceId;
+        };
+
+        // IUnknown
+        IFACEMETHODIMP_(ULONG) AddRef();
+        IFACEMETHODIMP_(ULONG) Release();
+        IFACEMETHODIMP QueryInterface(REFIID riid, VOID** ppvInterface);
+
+        bool Register();
+        bool Unregister();
+
+        /**
+         * @brief Enumerates the sessions of the endpoint. The enumerated sessions replace the known sessions.
+         * @param sessions Receives the new audio sessions
+        */
+        void GetSessions(std::vector<AudioSession*>& sessions);
+        /**
+         * @brief Enumerates the sessions of the endpoint and creates the sessions that are neither live nor known.
+         * @param liveInstanceIds Instance identifiers of the live sessions, the enumerated ones are removed from the set
+         * @param sessions Receives the new audio sessions
+        */
+        void ReconcileSessions(std::unordered_set<std::wstring>& liveInstanceIds, std::vector<AudioSession*>& sessions);
+        /**
+         * @brief Forgets a session that is gone, a later session with the same identifier is created again.
+        */
+        void ForgetSession(const std::wstring& instanceId);
+        /**
+         * @brief Checks if a session has been created by this endpoint and has not been forgotten since.
+        */
+        bool OwnsSession(const std::wstring& instanceId);
+
+        static std::wstring GetInstanceId(IAudioSessionControl2* control);
+
+    private:
+        ::winrt::impl::atomic_ref_count refCount{ 1 };
+        GUID eventContextId;
+        std::wstring deviceId{};
+        IMMDevicePtr device{ nullptr };
+        IAudioSessionManager2Ptr audioSessionManager{ nullptr };
+        // Shared with the expiry handlers of the sessions, which can outlive the context.
+        std::shared_ptr<SessionCreationFilter> sessionCreationFilter{ std::make_shared<SessionCreationFilter>() };
+        SessionCreatedHandler sessionCreated;
+        bool isRegistered = false;
+
+        /**
+         * @brief Creates an AudioSession for a session control, unless a session with the same instance identifier already exists. The
+         * identifier is forgotten when the session expires.
+         * @param control Session control
+         * @param instanceId Instance identifier of the session (see GetInstanceId)
+         * @return New session, nullptr if the session is already known
+        */
+        AudioSession* CreateSession(IAudioSessionControl2* control, const std::wstring& instanceId);
+
+        STDMETHOD(OnSessionCreated)(IAudioSessionControl* NewSession);
+    };
+}
@@ -0,0 +1,362 @@
+#include "pch.h"
+#include "AudioMeteringEngine.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace winrt;
+
+
+namespace Audio
+{
+    static inline chrono::milliseconds SteadyClockNow()
+    {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch());
+    }
+
+    #pragma region PeakSnapshot
+    void PeakSnapshot::Clear()
+    {
+        ids.clear();
+        left.clear();
+        right.clear();
+        leftHold.clear();
+        rightHold.clear();
+        channelCounts.clear();
+        channels.clear();
+        timestamps.clear();
+        activity.clear();
+    }
+
+    void PeakSnapshot::Reserve(const size_t& capacity)
+    {
+        ids.reserve(capacity);
+        left.reserve(capacity);
+        right.reserve(capacity);
+        leftHold.reserve(capacity);
+        rightHold.reserve(capacity);
+        channelCounts.reserve(capacity);
+        channels.reserve(capacity * MaxMeteringChannels);
+        timestamps.reserve(capacity);
+        activity.reserve(capacity);
+    }
+
+    void PeakSnapshot::Push(const GUID& id, const ChannelPeaks& levels, const ChannelPeaks& holds, const PeakHistoryStatistics& statistics, const int64_t& timestamp)
+    {
+        pair<float, float> stereo = levels.Stereo();
+        pair<float, float> stereoHold = holds.Stereo();
+
+        ids.push_back(id);
+        left.push_back(stereo.first);
+        right.push_back(stereo.second);
+        leftHold.push_back(stereoHold.first);
+        rightHold.push_back(stereoHold.second);
+        channelCounts.push_back(static_cast<uint8_t>(levels.count));
+        channels.insert(channels.end(), levels.values.begin(), levels.values.end());
+        timestamps.push_back(timestamp);
+        activity.push_back(statistics);
+    }
+    #pragma endregion
+
+
+    AudioMeteringEngine::AudioMeteringEngine(const PeakPollingSettings& settings, const MeterBallisticsSettings& ballisticsSettings) :
+        scheduler{ settings },
+        ballistics{ ballisticsSettings }
+    {
+    }
+
+    AudioMeteringEngine::~AudioMeteringEngine()
+    {
+        Stop();
+        ClearSessions();
+    }
+
+
+    void AudioMeteringEngine::AddSession(AudioSession* audioSession)
+    {
+        if (!audioSession) return;
+
+        unique_lock lock{ sessionsMutex };
+        for (AudioSession* session : sessions)
+        {
+            if (session == audioSession)
+            {
+                return;
+            }
+        }
+
+        audioSession->AddRef();
+        sessions.push_back(audioSession);
+    }
+
+    void AudioMeteringEngine::RemoveSession(const GUID& id)
+    {
+        AudioSession* removed = nullptr;
+
+        {
+            unique_lock lock{ sessionsMutex };
+            for (size_t i = 0; i < sessions.size(); i++)
+            {
+                if (sessions[i]->Id() == id)
+                {
+                    removed = sessions[i];
+                    sessions.erase(sessions.begin() + i);
+                    break;
+                }
+            }
+        }
+
+        // Release outside of the lock, the release might destroy the session.
+        if (removed)
+        {
+            removed->Release();
+        }
+    }
+
+    void AudioMeteringEngine::ClearSessions()
+    {
+        vector<AudioSession*> removed{};
+
+        {
+            unique_lock lock{ sessionsMutex };
+            removed.swap(sessions);
+        }
+
+        for (AudioSession* session : removed)
+        {
+            session->Release();
+        }
+    }
+
+    void AudioMeteringEngine::Start()
+    {
+        if (running.exchange(true))
+        {
+            return;
+        }
+
+        meteringThread = new thread(&AudioMeteringEngine::ThreadFunction, this);
+    }
+
+    void AudioMeteringEngine::Stop()
+    {
+        if (!running.exchange(false))
+        {
+            return;
+        }
+
+        {
+            unique_lock lock{ wakeMutex };
+            wakeCondition.notify_all();
+        }
+
+        if (meteringThread)
+        {
+            meteringThread->join();
+            delete meteringThread;
+            meteringThread = nullptr;
+        }
+        pollingInterval.store(0);
+    }
+
+    void AudioMeteringEngine::Wake()
+    {
+        unique_lock lock{ wakeMutex };
+        wakeRequested = true;
+        // Publish a non zero interval right away so that the UI timer does not stop before the metering thread wakes up.
+        pollingInterval.store(scheduler.Settings().normalInterval.count());
+        wakeCondition.notify_all();
+    }
+
+    void AudioMeteringEngine::Configure(const PeakPollingSettings& settings, const MeterBallisticsSettings& ballisticsSettings)
+    {
+        bool restart = IsRunning();
+        Stop();
+
+        scheduler = PeakPollingScheduler(settings);
+        ballistics = MeterBallistics(ballisticsSettings);
+
+        if (restart)
+        {
+            Start();
+        }
+    }
+
+    const PeakSnapshot& AudioMeteringEngine::AcquireSnapshot()
+    {
+        if (middleSnapshot.load(memory_order_relaxed) & SnapshotDirtyFlag)
+        {
+            frontSnapshot = middleSnapshot.exchange(frontSnapshot, memory_order_acq_rel) & SnapshotIndexMask;
+        }
+        return snapshots[frontSnapshot];
+    }
+
+
+    void AudioMeteringEngine::ThreadFunction()
+    {
+        // Audio endpoint and session interfaces are free threaded, the metering thread lives in the MTA so the meters are not marshalled through the UI thread.
+        bool uninitialize = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+        vector<AudioSession*> polledSessions{};
+        scheduler.Wake(SteadyClockNow());
+        while (running.load())
+        {
+            chrono::milliseconds interval = Poll(polledSessions);
+            pollingInterval.store(interval.count());
+
+            unique_lock lock{ wakeMutex };
+            auto predicate = [this]()
+            {
+                return !running.load() || wakeRequested;
+            };
+
+            if (interval.count() == 0)
+            {
+                // No session is active, sleep until a session becomes active.
+                wakeCondition.wait(lock, predicate);
+            }
+            else
+            {
+                wakeCondition.wait_for(lock, interval, predicate);
+            }
+
+            if (wakeRequested)
+            {
+                wakeRequested = false;
+                scheduler.Wake(SteadyClockNow());
+            }
+        }
+
+        meters.clear();
+        lastPoll = chrono::milliseconds(0);
+
+        if (uninitialize)
+        {
+            CoUninitialize();
+        }
+    }
+
+    chrono::milliseconds AudioMeteringEngine::Poll(vector<AudioSession*>& polledSessions)
+    {
+        // Take a reference on each session so that the lock is not held during the COM calls.
+        {
+            unique_lock lock{ sessionsMutex };
+            polledSessions.assign(sessions.begin(), sessions.end());
+            for (AudioSession* session : polledSessions)
+            {
+                session->AddRef();
+            }
+        }
+
+        PeakSnapshot& snapshot = snapshots[backSnapshot];
+        snapshot.Clear();
+        snapshot.Reserve(polledSessions.size());
+
+        // Ballistics advance by the real time elapsed since the last poll, the polling interval changes with the scheduler rate.
+        chrono::milliseconds now = SteadyClockNow();
+        chrono::milliseconds elapsed = lastPoll.count() == 0 ? scheduler.Settings().normalInterval : now - lastPoll;
+        elapsed = clamp(elapsed, chrono::milliseconds(1), chrono::milliseconds(1000));
+        lastPoll = now;
+        ballistics.Prepare(elapsed);
+
+        const uint32_t settledLevel = MeterBallistics::ToFixed(scheduler.Settings().movementThreshold);
+        uint32_t meteredCount = 0;
+        float maxLevel = 0.f;
+        for (AudioSession* session : polledSessions)
+        {
+            GUID id = session->Id();
+            bool active = session->IsActive();
+            auto it = meters.find(id);
+
+            // Histories are allocated once per session, then only written in place.
+            SessionHistory& history = histories[id];
+            history.lastPoll = sequence + 1;
+
+            // Inactive sessions always report silence, they are skipped once their meter has fallen back to 0.
+            if (!active && it == meters.end())
+            {
+                session->Release();
+                continue;
+            }
+
+            ChannelPeaks peaks{};
+            if (active)
+            {
+                try
+                {
+                    peaks = session->GetChannelPeaks();
+                }
+                catch (const hresult_error&)
+                {
+                    // The session might have expired between the copy and the call, report silence.
+                }
+            }
+            session->Release();
+
+            if (active)
+            {
+                // Raw peaks, the history must not depend on the display ballistics.
+                history.history.Record(peaks.Max(), now);
+            }
+
+            SessionMeter& meter = it == meters.end() ? meters[id] : it->second;
+            meter.lastPoll = sequence + 1;
+            if (active && peaks.count != 0 && peaks.count != meter.count)
+            {
+                // Channel layout changed, restart the meter.
+                meter = SessionMeter();
+                meter.count = peaks.count;
+                meter.lastPoll = sequence + 1;
+            }
+
+            ChannelPeaks levels{};
+            ChannelPeaks holds{};
+            levels.count = holds.count = meter.count;
+            bool settled = true;
+            for (uint32_t i = 0; i < meter.count; i++)
+            {
+                MeterChannelState& state = meter.channels[i];
+                ballistics.Step(state, peaks.values[i]);
+
+                levels.values[i] = MeterBallistics::ToFloat(state.level);
+                holds.values[i] = MeterBallistics::ToFloat(state.hold);
+                settled = settled && state.level <= settledLevel && state.hold <= settledLevel;
+            }
+
+            float level = levels.Max();
+            float hold = holds.Max();
+            level = hold > level ? hold : level;
+            maxLevel = level > maxLevel ? level : maxLevel;
+
+            if (!active && settled)
+            {
+                // Publish silence one last time so that the meter ends at 0.
+                snapshot.Push(id, ChannelPeaks(), ChannelPeaks(), history.history.Statistics(), now.count());
+                meters.erase(id);
+                continue;
+            }
+
+            snapshot.Push(id, levels, holds, history.history.Statistics(), now.count());
+            meteredCount++;
+        }
+        polledSessions.clear();
+
+        // Drop the meters of the sessions removed from the engine.
+        erase_if(meters, [this](const auto& entry)
+        {
+            return entry.second.lastPoll != sequence + 1;
+        });
+        erase_if(histories, [this](const auto& entry)
+        {
+            return entry.second.lastPoll != sequence + 1;
+        });
+
+        snapshot.sequence = ++sequence;
+        backSnapshot = middleSnapshot.exchange(backSnapshot | SnapshotDirtyFlag, memory_order_acq_rel) & SnapshotIndexMask;
+
+        // Sessions whose meter is still falling count as active, polling stops once every meter has settled.
+        float maxDelta = fabsf(maxLevel - lastMaxLevel);
+        lastMaxLevel = maxLevel;
+        return scheduler.Update(meteredCount, maxLevel, maxDelta, now);
+    }
+}
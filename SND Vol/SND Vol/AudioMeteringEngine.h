@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "AudioSession.h"
+#include "ChannelPeaks.h"
+#include "GuidHash.h"
+#include "MeterBallistics.h"
+#include "PeakHistory.h"
+#include "PeakPollingScheduler.h"
+
+namespace Audio
+{
+    /**
+     * @brief Struct-of-arrays snapshot of the meter values of the metered audio sessions. Index i of every array describes the same session.
+     * Values are the smoothed display levels produced by the meter ballistics, not the instantaneous peaks.
+    */
+    struct PeakSnapshot
+    {
+        std::vector<GUID> ids{};
+        std::vector<float> left{};
+        std::vector<float> right{};
+        std::vector<float> leftHold{};
+        std::vector<float> rightHold{};
+        /**
+         * @brief Number of metered channels of each session.
+        */
+        std::vector<uint8_t> channelCounts{};
+        /**
+         * @brief Per channel levels, MaxMeteringChannels entries per session.
+        */
+        std::vector<float> channels{};
+        /**
+         * @brief Time at which each session has been polled, in steady clock milliseconds.
+        */
+        std::vector<int64_t> timestamps{};
+        /**
+         * @brief Activity statistics of each session, derived from its peak history.
+        */
+        std::vector<PeakHistoryStatistics> activity{};
+        /**
+         * @brief Incremented each time the metering thread publishes a snapshot.
+        */
+        uint64_t sequence = 0;
+
+        inline size_t Size() const
+        {
+            return ids.size();
+        };
+
+        /**
+         * @brief Gets the per channel peak values of a session.
+         * @param index Index of the session in the snapshot
+         * @return Span of the metered channels peak values
+        */
+        inline std::span<const float> Channels(const size_t& index) const
+        {
+            return std::span<const float>(channels.data() + index * MaxMeteringChannels, channelCounts[index]);
+        };
+
+        void Clear();
+        void Reserve(const size_t& capacity);
+        void Push(const GUID& id, const ChannelPeaks& levels, const ChannelPeaks& holds, const PeakHistoryStatistics& statistics, const int64_t& timestamp);
+    };
+
+
+    class AudioMeteringEngine
+    {
+    public:
+        /**
+         * @brief Default constructor.
+         * @param settings Polling intervals used by the engine scheduler
+         * @param ballisticsSettings Attack, release and peak-hold times of the meters
+        */
+        AudioMeteringEngine(const PeakPollingSettings& settings, const MeterBallisticsSettings& ballisticsSettings);
+        ~AudioMeteringEngine();
+
+        /**
+         * @brief Checks if the metering thread is running.
+         * @return True if the metering thread is polling the audio sessions
+        */
+        inline bool IsRunning() const
+        {
+            return running.load();
+        };
+
+        /**
+         * @brief Gets the interval currently chosen by the polling scheduler.
+         * @return Interval between two polls, 0 if polling is stopped because no session is active
+        */
+        inline std::chrono::milliseconds PollingInterval() const
+        {
+            return std::chrono::milliseconds(pollingInterval.load());
+        };
+
+        /**
+         * @brief Adds an audio session to the metered sessions. The engine keeps a reference on the session until it is removed.
+         * @param audioSession Audio session to meter
+        */
+        void AddSession(AudioSession* audioSession);
+        /**
+         * @brief Removes an audio session from the metered sessions and releases the reference held by the engine.
+         * @param id Id of the audio session
+        */
+        void RemoveSession(const GUID& id);
+        /**
+         * @brief Removes every audio session from the metered sessions.
+        */
+        void ClearSessions();
+        /**
+         * @brief Starts the metering thread.
+        */
+        void Start();
+        /**
+         * @brief Stops the metering thread and waits for it to exit.
+        */
+        void Stop();
+        /**
+         * @brief Resumes polling at the normal rate, to be called when a session becomes active or is added.
+        */
+        void Wake();
+        /**
+         * @brief Changes the polling and ballistics settings, restarting the metering thread if it is running.
+         * @param settings Polling intervals and thresholds
+         * @param ballisticsSettings Attack, release and peak-hold times of the meters
+        */
+        void Configure(const PeakPollingSettings& settings, const MeterBallisticsSettings& ballisticsSettings);
+        /**
+         * @brief Gets the last snapshot published by the metering thread. Only one thread (the UI thread) must read snapshots.
+         * @return The most recent peak snapshot, valid until the next call
+        */
+        const PeakSnapshot& AcquireSnapshot();
+
+    private:
+        static constexpr uint8_t SnapshotIndexMask = 0x3;
+        static constexpr uint8_t SnapshotDirtyFlag = 0x4;
+
+        /**
+         * @brief Ballistics state of the channels of a session.
+        */
+        struct SessionMeter
+        {
+            MeterChannelState channels[MaxMeteringChannels]{};
+            uint32_t count = 0;
+            uint64_t lastPoll = 0;
+        };
+
+        /**
+         * @brief Peak history of a session, kept for as long as the session is registered in the engine.
+        */
+        struct SessionHistory
+        {
+            PeakHistory history{};
+            uint64_t lastPoll = 0;
+        };
+
+        PeakPollingScheduler scheduler;
+        MeterBallistics ballistics;
+        std::atomic<int64_t> pollingInterval = 0;
+        std::mutex sessionsMutex{};
+        std::vector<AudioSession*> sessions{};
+        std::thread* meteringThread = nullptr;
+        std::atomic_bool running = false;
+        std::mutex wakeMutex{};
+        std::condition_variable wakeCondition{};
+        bool wakeRequested = false;
+        // The writer publishes by swapping its back buffer with the middle one, the reader swaps its front buffer with the middle one when the dirty flag is set.
+        // Neither side ever waits for the other.
+        PeakSnapshot snapshots[3]{};
+        std::atomic<uint8_t> middleSnapshot = 1;
+        uint8_t backSnapshot = 0;
+        uint8_t frontSnapshot = 2;
+        uint64_t sequence = 0;
+        // Metering thread only. Sessions that are inactive and whose meter has settled have no entry.
+        std::unordered_map<GUID, SessionMeter, GuidHash> meters{};
+        // Metering thread only, survives the thread restarts.
+        std::unordered_map<GUID, SessionHistory, GuidHash> histories{};
+        std::chrono::milliseconds lastPoll{ 0 };
+        float lastMaxLevel = 0.f;
+
+        void ThreadFunction();
+        /**
+         * @brief Polls the active sessions, advances the meters ballistics and publishes a snapshot.
+         * @return Interval until the next poll, 0 if no session is active and every meter has settled
+        */
+        std::chrono::milliseconds Poll(std::vector<AudioSession*>& polledSessions);
+    };
+}
@@ -5,8 +5,10 @@
 #include <appmodel.h>
 #include "AudioSessionStates.h"
 #include "ManifestApplicationNode.h"
+#include "IconCache.h"
 #include "IconHelper.h"
 #include "ProcessInfo.h"
+#include "Trace.h"
 
 using namespace winrt;
 using namespace std;
@@ -14,8 +16,9 @@ using namespace std;
 
 namespace Audio
 {
-    AudioSession::AudioSession(IAudioSessionControl2* audioSessionControl, GUID eventContextId) :
+    AudioSession::AudioSession(IAudioSessionControl2* audioSessionControl, GUID eventContextId, const wstring& endpointId) :
         eventContextId{ eventContextId },
+        endpointId{ endpointId },
         sessionName{ L"" },
         audioSessionControl{ audioSessionControl }
     {
@@ -23,10 +26,15 @@ namespace Audio
         check_hresult(audioSessionControl->GetGroupingParam(&groupingParam));
         check_hresult(audioSessionControl->GetProcessId(&processPID));
 
+        LPWSTR instanceIdString = nullptr;
+        check_hresult(audioSessionControl->GetSessionInstanceIdentifier(&instanceIdString));
+        instanceId = instanceIdString;
+        CoTaskMemFree(instanceIdString);
+
         if (audioSessionControl->IsSystemSoundsSession() == S_OK)
         {
-            winrt::Windows::ApplicationModel::Resources::ResourceLoader loader{};
-            sessionName = loader.GetString(L"SystemAudioSessionName");
+            static const hstring systemSessionName = winrt::Windows::ApplicationModel::Resources::ResourceLoader().GetString(L"SystemAudioSessionName");
+            sessionName = systemSessionName;
             isSystemSoundSession = true;
         }
         else
@@ -40,28 +48,25 @@ namespace Audio
             }
         }
 
-        if (processPID > 0 && !isSystemSoundSession)
-        {
-            LPWSTR iconPathLPWSTR = nullptr;
-
-            System::ProcessInfo processInfo{ processPID };
-
-            sessionName = !processInfo.Name().empty() ? processInfo.Name() : processInfo.Manifest().DisplayName();
-            processPath = processInfo.ExecutablePath();
-        }
-
+        // Process metadata is resolved later by ResolveMetadata, sessions without a process have nothing to resolve.
+        metadataResolved = processPID == 0 || isSystemSoundSession;
 
         AudioSessionState state{};
         if (SUCCEEDED(audioSessionControl->GetState(&state)))
         {
-            isSessionActive = state == AudioSessionState::AudioSessionStateActive;
+            sessionState = state;
         }
 
         check_hresult(audioSessionControl->QueryInterface(_uuidof(ISimpleAudioVolume), (void**)&simpleAudioVolume));
-        if (FAILED(simpleAudioVolume->GetMute((BOOL*)&muted)))
+        float currentVolume = 0.f;
+        check_hresult(simpleAudioVolume->GetMasterVolume(&currentVolume));
+        volume = currentVolume;
+        BOOL currentMute = FALSE;
+        if (FAILED(simpleAudioVolume->GetMute(&currentMute)))
         {
             OutputDebugHString(L"Audio session '" + sessionName + L"' > Failed to get session state. Default (unmuted) assumed.");
         }
+        muted = currentMute != FALSE;
         if (FAILED(audioSessionControl->QueryInterface(__uuidof(IAudioMeterInformation), (void**)&audioMeter)))
         {
             OutputDebugHString(L"Audio session '" + sessionName + L"' > Failed to get audio meter info. Peak values will be blank.");
@@ -92,35 +97,162 @@ namespace Audio
 
     void AudioSession::Muted(const bool& isMuted)
     {
-        simpleAudioVolume->SetMute(isMuted, &eventContextId);
+        if (SUCCEEDED(simpleAudioVolume->SetMute(isMuted, &eventContextId)))
+        {
+            muted = isMuted;
+        }
     }
 
     hstring AudioSession::Name()
     {
-        return sessionName;
+        unique_lock lock{ metadataMutex };
+        return hstring(sessionName);
+    }
+
+    wstring AudioSession::ProcessPath()
+    {
+        unique_lock lock{ metadataMutex };
+        return processPath;
+    }
+
+    wstring AudioSession::LogoPath()
+    {
+        unique_lock lock{ metadataMutex };
+        return logoPath;
+    }
+
+    shared_ptr<const ::Imaging::IconPixels> AudioSession::TakeLogoPixels()
+    {
+        unique_lock lock{ metadataMutex };
+        return move(logoPixels);
     }
 
     void AudioSession::Volume(float const& desiredVolume)
     {
         check_hresult(simpleAudioVolume->SetMasterVolume(desiredVolume, &eventContextId));
+        volume = desiredVolume;
     }
 
     float AudioSession::Volume() const
     {
-        float volume = 0.0f;
-        check_hresult(simpleAudioVolume->GetMasterVolume(&volume));
-        return volume;
+        return volume.load();
     }
 
     AudioSessionState AudioSession::State() const
     {
-        AudioSessionState state{};
-        check_hresult(audioSessionControl->GetState(&state));
-        return state;
+        return sessionState.load();
     }
     #pragma endregion
 
 
+    void AudioSession::ResolveMetadata()
+    {
+        if (metadataResolved.load())
+        {
+            return;
+        }
+
+        System::ProcessMetadata metadata{};
+        try
+        {
+            metadata = QueryProcessMetadata(processPID);
+        }
+        catch (const hresult_error& error)
+        {
+            // Protected or already exited process, the session keeps its display name.
+            OutputDebugHString(L"Audio session '" + Name() + L"' > Failed to resolve process metadata: " + error.message());
+        }
+        ApplyMetadata(metadata);
+    }
+
+    void AudioSession::ApplyMetadata(const System::ProcessMetadata& metadata, const shared_ptr<const ::Imaging::IconPixels>& decodedLogo)
+    {
+        if (metadataResolved.exchange(true))
+        {
+            return;
+        }
+
+        bool nameChanged = false;
+        {
+            unique_lock lock{ metadataMutex };
+            if (!metadata.name.empty() && metadata.name != sessionName)
+            {
+                sessionName = metadata.name;
+                nameChanged = true;
+            }
+            processPath = metadata.executablePath;
+            logoPath = metadata.logo;
+            logoPixels = decodedLogo;
+        }
+
+        if (nameChanged)
+        {
+            e_stateChanged(id, static_cast<uint32_t>(AudioSessionStates::DisplayNameChanged));
+        }
+        if (!metadata.logo.empty())
+        {
+            e_stateChanged(id, static_cast<uint32_t>(AudioSessionStates::IconChanged));
+        }
+    }
+
+    System::ProcessMetadata AudioSession::QueryProcessMetadata(const DWORD& processId)
+    {
+        System::ProcessInfo processInfo{ processId };
+
+        System::ProcessMetadata metadata{};
+        metadata.name = !processInfo.Name().empty() ? wstring(processInfo.Name()) : processInfo.Manifest().DisplayName();
+        metadata.executablePath = processInfo.ExecutablePath();
+        metadata.logo = processInfo.Manifest().Logo();
+        if (metadata.logo.empty() && !metadata.executablePath.empty())
+        {
+            // Win32 applications have no manifest logo, the icon of the executable is used instead.
+            metadata.logo = ::Imaging::IconCache::Current().GetIconPath(metadata.executablePath);
+        }
+        return metadata;
+    }
+
+
+    bool AudioSession::Resync()
+    {
+        TRACE_SPAN(L"AudioSession::Resync", id, processPID);
+        float currentVolume = 0.f;
+        BOOL currentMute = FALSE;
+        ::AudioSessionState currentState{};
+        if (FAILED(simpleAudioVolume->GetMasterVolume(&currentVolume)) ||
+            FAILED(simpleAudioVolume->GetMute(&currentMute)) ||
+            FAILED(audioSessionControl->GetState(&currentState)))
+        {
+            return false;
+        }
+
+        bool drifted = false;
+        if (volume.exchange(currentVolume) != currentVolume)
+        {
+            drifted = true;
+            e_volumeChanged(id, currentVolume);
+        }
+
+        bool isMuted = currentMute != FALSE;
+        if (muted.exchange(isMuted) != isMuted)
+        {
+            drifted = true;
+            e_stateChanged(id, isMuted ? static_cast<uint32_t>(AudioSessionStates::Muted) : static_cast<uint32_t>(AudioSessionStates::Unmuted));
+        }
+
+        if (sessionState.exchange(currentState) != currentState)
+        {
+            drifted = true;
+            e_stateChanged(id, static_cast<uint32_t>(currentState));
+        }
+
+        if (drifted)
+        {
+            OutputDebugHString(L"Audio session '" + Name() + L"' > Cached state resynchronized.");
+        }
+        return drifted;
+    }
+
+
     #pragma region Events
     winrt::event_token AudioSession::StateChanged(winrt::Windows::Foundation::TypedEventHandler<winrt::guid, uint32_t> const& handler)
     {
@@ -146,12 +278,19 @@ namespace Audio
 
     bool AudioSession::SetMute(bool const& state)
     {
-        return SUCCEEDED(simpleAudioVolume->SetMute(state, nullptr));
+        if (SUCCEEDED(simpleAudioVolume->SetMute(state, nullptr)))
+        {
+            muted = state;
+            return true;
+        }
+        return false;
     }
 
-    void AudioSession::SetVolume(const float& volume)
+    void AudioSession::SetVolume(const float& desiredVolume)
     {
-        check_hresult(simpleAudioVolume->SetMasterVolume(volume, nullptr));
+        TRACE_SPAN(L"AudioSession::SetVolume", id, processPID);
+        check_hresult(simpleAudioVolume->SetMasterVolume(desiredVolume, nullptr));
+        volume = desiredVolume;
     }
 
     float AudioSession::GetPeak() const
@@ -163,25 +302,25 @@ namespace Audio
 
     pair<float, float> Audio::AudioSession::GetChannelsPeak() const
     {
-        // TODO: Channel count
-        if (isSessionActive)
-        {
-            pair<float, float> peaks{};
+        return GetChannelPeaks().Stereo();
+    }
 
+    ChannelPeaks AudioSession::GetChannelPeaks() const
+    {
+        // Also covers GetChannelsPeak, the metering engine calls this directly.
+        TRACE_SPAN(L"AudioSession::GetChannelPeaks", id, processPID);
+        ChannelPeaks peaks{};
+
+        if (IsActive())
+        {
             UINT meteringChannelCount = 0;
-            if (SUCCEEDED(audioMeter->GetMeteringChannelCount(&meteringChannelCount)) && meteringChannelCount == 2)
+            if (SUCCEEDED(audioMeter->GetMeteringChannelCount(&meteringChannelCount)) && meteringChannelCount > 0)
             {
-                float channelsPeak[2]{ 0 };
-                check_hresult(audioMeter->GetChannelsPeakValues(2, channelsPeak));
-                peaks.first = channelsPeak[0];
-                peaks.second = channelsPeak[1];
+                check_hresult(ReadChannelPeaks(audioMeter, meteringChannelCount, peaks));
             }
-            return peaks;
-        }
-        else
-        {
-            return { 0.f, 0.f };
         }
+
+        return peaks;
     }
 
     bool AudioSession::Register()
@@ -244,23 +383,25 @@ namespace Audio
 
     STDMETHODIMP AudioSession::OnDisplayNameChanged(LPCWSTR NewDisplayName, LPCGUID)
     {
-        OutputDebugHString(sessionName + L" > Display name changed : " + to_hstring(NewDisplayName));
+        OutputDebugHString(Name() + L" > Display name changed : " + to_hstring(NewDisplayName));
         e_stateChanged(id, static_cast<uint32_t>(AudioSessionStates::DisplayNameChanged));
         return S_OK;
     }
 
     STDMETHODIMP AudioSession::OnIconPathChanged(LPCWSTR NewIconPath, LPCGUID)
     {
-        OutputDebugHString(sessionName + L" > Icon path changed : " + to_hstring(NewIconPath));
+        OutputDebugHString(Name() + L" > Icon path changed : " + to_hstring(NewIconPath));
         e_stateChanged(id, static_cast<uint32_t>(AudioSessionStates::IconChanged));
         return S_OK;
     }
 
     STDMETHODIMP AudioSession::OnSimpleVolumeChanged(float NewVolume, BOOL NewMute, LPCGUID EventContext)
     {
+        // The cached state follows every change, including the ones made with our own event context.
+        volume = NewVolume;
+        muted = NewMute != FALSE;
         if (*EventContext != eventContextId)
         {
-            muted = NewMute;
             e_volumeChanged(id, NewVolume);
             e_stateChanged(id, muted ? static_cast<uint32_t>(AudioSessionStates::Muted) : static_cast<uint32_t>(AudioSessionStates::Unmuted));
         }
@@ -269,7 +410,7 @@ namespace Audio
 
     STDMETHODIMP AudioSession::OnStateChanged(::AudioSessionState NewState)
     {
-        isSessionActive = NewState == AudioSessionState::AudioSessionStateActive;
+        sessionState = NewState;
         e_stateChanged(id, static_cast<uint32_t>(NewState)); // Cast to uint32_t to cross ABI without more code.
         return S_OK;
     }
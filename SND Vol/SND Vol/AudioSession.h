@@ -1,13 +1,23 @@
 #pragma once
 
+#include <memory>
+#include "ChannelPeaks.h"
 #include "IComEventImplementation.h"
+#include "IconHelper.h"
+#include "ProcessMetadataCache.h"
 
 namespace Audio
 {
     class AudioSession : private IAudioSessionEvents, public IComEventImplementation
     {
     public:
-        AudioSession(IAudioSessionControl2* audioSessionControl, GUID eventContextId);
+        /**
+         * @brief Default constructor.
+         * @param audioSessionControl Session control
+         * @param eventContextId Event context of the changes made by the application
+         * @param endpointId Identifier of the endpoint device of the session, empty for sessions not enumerated from an endpoint
+        */
+        AudioSession(IAudioSessionControl2* audioSessionControl, GUID eventContextId, const std::wstring& endpointId = std::wstring());
 
         /**
          * @brief Grouping parameter for the audio session.
@@ -25,7 +35,15 @@ namespace Audio
         */
         GUID Id();
         /**
-         * @brief Checks if the audio session is muted or not.
+         * @brief Checks if the audio session is playing audio, without querying the session control.
+         * @return True if the last known state of the session is AudioSessionStateActive
+        */
+        inline bool IsActive() const
+        {
+            return sessionState.load() == ::AudioSessionState::AudioSessionStateActive;
+        };
+        /**
+         * @brief Checks if the audio session is muted or not, from the cached state.
          * @return True if the session is muted.
         */
         bool Muted();
@@ -36,16 +54,17 @@ namespace Audio
         void Muted(const bool& isMuted);
         /**
          * @brief Gets the name of the session. Can be the display name or the name of the executable associated with the audio session's PID.
+         * The display name is used until ResolveMetadata has completed.
          * @return The name of the session
         */
         winrt::hstring Name();
         /**
-         * @brief State of the session (active, inactive, expired).
+         * @brief State of the session (active, inactive, expired), from the cached state.
          * @return AudioSessionState
         */
         AudioSessionState State() const;
         /**
-         * @brief Sets the volume of the session.
+         * @brief Gets the volume of the session, from the cached state.
          * @return The volume of the session
         */
         float Volume() const;
@@ -60,10 +79,68 @@ namespace Audio
             return processPID;
         }
 
-        inline wstring_view ProcessPath()
+        /**
+         * @brief Session instance identifier, unique to the session among the sessions of the system.
+        */
+        inline std::wstring_view InstanceId() const
+        {
+            return instanceId;
+        };
+
+        /**
+         * @brief Identifier of the endpoint device the session plays to (or records from).
+        */
+        inline std::wstring_view EndpointId() const
         {
+            return endpointId;
+        };
 
-        }
+        /**
+         * @brief Path of the executable of the session's process, empty until ResolveMetadata has completed.
+        */
+        std::wstring ProcessPath();
+        /**
+         * @brief Path of the logo declared by the package manifest of the session's process, empty until ResolveMetadata has completed or if the
+         * process is not packaged.
+        */
+        std::wstring LogoPath();
+        /**
+         * @brief Takes the pixels of the logo decoded for the icon atlas by the metadata resolver. The pixels are handed over once.
+         * @return Pixels, null if the logo has not been decoded
+        */
+        std::shared_ptr<const ::Imaging::IconPixels> TakeLogoPixels();
+        /**
+         * @brief True once ResolveMetadata has run (successfully or not).
+        */
+        inline bool MetadataResolved() const
+        {
+            return metadataResolved.load();
+        };
+        /**
+         * @brief Resolves the metadata of the session's process (name, executable path and logo). Expensive (opens the process and reads its
+         * package manifest), called once per session away from the UI thread. Raises StateChanged with DisplayNameChanged and IconChanged when
+         * the metadata changed.
+        */
+        void ResolveMetadata();
+        /**
+         * @brief Applies metadata resolved for the process of the session, by ResolveMetadata or for another session of the same process (see
+         * SessionMetadataResolver). Raises StateChanged like ResolveMetadata. Does nothing if the metadata has already been resolved.
+         * @param metadata Metadata of the process, empty fields are ignored
+         * @param decodedLogo Pixels of the logo of the process, if already decoded
+        */
+        void ApplyMetadata(const System::ProcessMetadata& metadata, const std::shared_ptr<const ::Imaging::IconPixels>& decodedLogo = nullptr);
+        /**
+         * @brief Queries the metadata of a process: name, executable path and logo (package logo, or icon of the executable from the icon cache).
+         * @param processId Id of the process
+         * @return Metadata. Throws if the process cannot be opened
+        */
+        static System::ProcessMetadata QueryProcessMetadata(const DWORD& processId);
+        /**
+         * @brief Reads the volume, mute and state of the session from the audio service and corrects the cached copies. Corrections are raised
+         * like the notifications they replace (VolumeChanged, StateChanged).
+         * @return True if the cached state had drifted
+        */
+        bool Resync();
 
         /**
          * @brief State changed event subscriber.
@@ -107,10 +184,15 @@ namespace Audio
         */
         float GetPeak() const;
         /**
-         * @brief Gets the normalized peak PCM values for the channels in this audio session.
+         * @brief Gets the normalized peak PCM values for the channels in this audio session, downmixed to stereo.
          * @return pair of float between 0 and 1
         */
         std::pair<float, float> GetChannelsPeak() const;
+        /**
+         * @brief Gets the normalized peak PCM values of every channel in this audio session, up to MaxMeteringChannels.
+         * @return Channel peaks, empty if the session is inactive
+        */
+        ChannelPeaks GetChannelPeaks() const;
 
         // IUnknown
         IFACEMETHODIMP_(ULONG) AddRef();
@@ -126,12 +208,20 @@ namespace Audio
         GUID id;
         bool isRegistered = false;
         bool isSystemSoundSession = false;
-        bool muted;
         DWORD processPID = 0;
         ::winrt::impl::atomic_ref_count refCount{ 1 };
+        std::wstring instanceId{};
+        std::wstring endpointId{};
+        std::mutex metadataMutex{};
         std::wstring sessionName{};
-        std::wstring processPath;
-        bool isSessionActive = false;
+        std::wstring processPath{};
+        std::wstring logoPath{};
+        std::shared_ptr<const ::Imaging::IconPixels> logoPixels{};
+        std::atomic_bool metadataResolved = false;
+        // Cached state, kept up to date by the session notifications and the setters, corrected by Resync.
+        std::atomic<float> volume = 0.f;
+        std::atomic_bool muted = false;
+        std::atomic<::AudioSessionState> sessionState = ::AudioSessionState::AudioSessionStateInactive;
 
         winrt::event<winrt::Windows::Foundation::TypedEventHandler<winrt::guid, float>> e_volumeChanged{};
         winrt::event<winrt::Windows::Foundation::TypedEventHandler<winrt::guid, uint32_t>> e_stateChanged{};
@@ -147,12 +237,12 @@ namespace Audio
         STDMETHOD(OnSessionDisconnected)(AudioSessionDisconnectReason DisconnectReason);
         STDMETHOD(OnChannelVolumeChanged)(DWORD /*ChannelCount*/, float /*NewChannelVolumeArray*/[], DWORD /*ChangedChannel*/, LPCGUID /*EventContext*/) 
         { 
-            OutputDebugHString(sessionName + L" : Channel volume changed.");
+            OutputDebugHString(Name() + L" : Channel volume changed.");
             return S_OK;
         };
         STDMETHOD(OnGroupingParamChanged)(LPCGUID /*NewGroupingParam*/, LPCGUID /*EventContext*/) 
         { 
-            OutputDebugHString(sessionName + L" : Grouping param changed.");
+            OutputDebugHString(Name() + L" : Grouping param changed.");
             return S_OK; 
         };
     };
@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "AudioSessionGroup.h"
+
+using namespace std;
+using namespace winrt;
+
+
+namespace Audio
+{
+    AudioSessionGroup::AudioSessionGroup(const wstring& endpointId, const GUID& groupingParam) :
+        endpointId{ endpointId },
+        groupingParam{ groupingParam }
+    {
+    }
+
+    AudioSessionGroup::~AudioSessionGroup()
+    {
+        for (AudioSession* session : members)
+        {
+            session->Release();
+        }
+    }
+
+
+    bool AudioSessionGroup::Add(AudioSession* session)
+    {
+        for (AudioSession* member : members)
+        {
+            if (member == session)
+            {
+                return false;
+            }
+        }
+
+        session->AddRef();
+        members.push_back(session);
+        return true;
+    }
+
+    bool AudioSessionGroup::Remove(const GUID& sessionId)
+    {
+        for (size_t i = 0; i < members.size(); i++)
+        {
+            if (members[i]->Id() == sessionId)
+            {
+                AudioSession* session = members[i];
+                members.erase(members.begin() + i);
+                session->Release();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool AudioSessionGroup::IsActive() const
+    {
+        for (AudioSession* member : members)
+        {
+            if (member->IsActive())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool AudioSessionGroup::Muted() const
+    {
+        for (AudioSession* member : members)
+        {
+            if (!member->Muted())
+            {
+                return false;
+            }
+        }
+        return !members.empty();
+    }
+
+    float AudioSessionGroup::Volume() const
+    {
+        float volume = 0.f;
+        for (AudioSession* member : members)
+        {
+            float memberVolume = member->Volume();
+            volume = memberVolume > volume ? memberVolume : volume;
+        }
+        return volume;
+    }
+
+    void AudioSessionGroup::SetMute(const bool& mute)
+    {
+        for (AudioSession* member : members)
+        {
+            member->Muted(mute);
+        }
+    }
+
+
+    AudioSessionGroupIndex::~AudioSessionGroupIndex()
+    {
+        Clear();
+    }
+
+    AudioSessionGroup* AudioSessionGroupIndex::Add(AudioSession* session)
+    {
+        GroupKey key{ wstring(session->EndpointId()), session->GroupingParam() };
+        AudioSessionGroup*& group = groups[key];
+        if (!group)
+        {
+            group = new AudioSessionGroup(key.endpointId, key.groupingParam);
+        }
+        group->Add(session);
+        return group;
+    }
+
+    AudioSessionGroup* AudioSessionGroupIndex::Remove(AudioSession* session)
+    {
+        auto it = groups.find(GroupKey{ wstring(session->EndpointId()), session->GroupingParam() });
+        if (it == groups.end())
+        {
+            return nullptr;
+        }
+
+        AudioSessionGroup* group = it->second;
+        group->Remove(session->Id());
+        if (group->Size() == 0)
+        {
+            groups.erase(it);
+            delete group;
+            return nullptr;
+        }
+        return group;
+    }
+
+    AudioSessionGroup* AudioSessionGroupIndex::Find(const wstring_view& endpointId, const GUID& groupingParam) const
+    {
+        auto it = groups.find(GroupKey{ wstring(endpointId), groupingParam });
+        return it != groups.end() ? it->second : nullptr;
+    }
+
+    void AudioSessionGroupIndex::Clear()
+    {
+        for (auto& [key, group] : groups)
+        {
+            delete group;
+        }
+        groups.clear();
+    }
+}
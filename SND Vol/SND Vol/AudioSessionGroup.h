@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AudioSession.h"
+#include "GuidHash.h"
+
+namespace Audio
+{
+    /**
+     * @brief Audio sessions of an endpoint sharing a grouping parameter (browsers and conferencing apps create one session per tab/call),
+     * controlled as one: a single slider, mute state and meter. Volumes are written to every member through the volume writer and the meter
+     * combines the peaks of the members polled by the metering engine. Sessions of the same application on other endpoints (a microphone
+     * capture next to the playback) are in other groups.
+     * Not thread safe, owned by the thread indexing the sessions (UI thread).
+    */
+    class AudioSessionGroup
+    {
+    public:
+        AudioSessionGroup(const std::wstring& endpointId, const GUID& groupingParam);
+        ~AudioSessionGroup();
+
+        inline std::wstring_view EndpointId() const
+        {
+            return endpointId;
+        };
+
+        inline GUID GroupingParam() const
+        {
+            return groupingParam;
+        };
+
+        /**
+         * @brief Member sessions, in the order they joined the group.
+        */
+        inline const std::vector<AudioSession*>& Members() const
+        {
+            return members;
+        };
+
+        inline size_t Size() const
+        {
+            return members.size();
+        };
+
+        /**
+         * @brief Adds a session to the group, the group keeps a reference on it.
+         * @return False if the session is already a member
+        */
+        bool Add(AudioSession* session);
+        /**
+         * @brief Removes a session from the group and releases it.
+         * @param sessionId Id of the session
+         * @return False if the session is not a member
+        */
+        bool Remove(const GUID& sessionId);
+
+        /**
+         * @brief True if any member is active.
+        */
+        bool IsActive() const;
+        /**
+         * @brief True if every member is muted.
+        */
+        bool Muted() const;
+        /**
+         * @brief Loudest member volume, from the cached session volumes.
+        */
+        float Volume() const;
+        /**
+         * @brief Mutes or unmutes every member, with their own event context.
+         * @param mute True to mute
+        */
+        void SetMute(const bool& mute);
+
+    private:
+        std::wstring endpointId{};
+        GUID groupingParam;
+        std::vector<AudioSession*> members{};
+    };
+
+
+    /**
+     * @brief (Endpoint, grouping parameter) -> session group. Groups are created with their first member and deleted with their last.
+     * Not thread safe, owned by the thread indexing the sessions (UI thread).
+    */
+    class AudioSessionGroupIndex
+    {
+    public:
+        ~AudioSessionGroupIndex();
+
+        /**
+         * @brief Adds a session to the group of its endpoint and grouping parameter.
+         * @return Group of the session
+        */
+        AudioSessionGroup* Add(AudioSession* session);
+        /**
+         * @brief Removes a session from its group, deleting the group if it was its last member.
+         * @return Group of the session, nullptr if the group has been deleted (or the session was not indexed)
+        */
+        AudioSessionGroup* Remove(AudioSession* session);
+        /**
+         * @brief Finds the group of a grouping parameter on an endpoint.
+         * @return Group, nullptr if no indexed session of the endpoint has this grouping parameter
+        */
+        AudioSessionGroup* Find(const std::wstring_view& endpointId, const GUID& groupingParam) const;
+        void Clear();
+
+        inline size_t Size() const
+        {
+            return groups.size();
+        };
+
+    private:
+        struct GroupKey
+        {
+            std::wstring endpointId{};
+            GUID groupingParam{};
+
+            inline bool operator==(const GroupKey& other) const
+            {
+                return groupingParam == other.groupingParam && endpointId == other.endpointId;
+            };
+        };
+
+        struct GroupKeyHash
+        {
+            inline size_t operator()(const GroupKey& key) const noexcept
+            {
+                return GuidHash()(key.groupingParam) ^ (std::hash<std::wstring>()(key.endpointId) * 0x9e3779b97f4a7c15ull);
+            };
+        };
+
+        std::unordered_map<GroupKey, AudioSessionGroup*, GroupKeyHash> groups{};
+    };
+}
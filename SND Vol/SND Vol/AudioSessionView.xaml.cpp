@@ -4,6 +4,8 @@
 #include "AudioSessionView.g.cpp"
 #endif
 
+#include "CompositionMeters.h"
+
 #include <math.h>
 #include <limits>
 
@@ -36,20 +38,7 @@ namespace winrt::SND_Vol::implementation
     AudioSessionView::AudioSessionView(winrt::hstring const& header, double const& volume, const winrt::hstring& logoPath) :
         AudioSessionView(header, volume)
     {
-        try
-        {
-            BitmapImage imageSource{ Uri(logoPath) };
-
-            Image image{};
-            image.Stretch(Stretch::Uniform);
-            image.Source(imageSource);
-
-            AudioSessionAppLogo().Content(image);
-        }
-        catch (const hresult_error& err)
-        {
-            OutputDebugHString(err.message());
-        }
+        SetLogo(logoPath);
     }
 
 
@@ -75,6 +64,28 @@ namespace winrt::SND_Vol::implementation
         return AudioSessionAppLogo();
     }
 
+    bool AudioSessionView::ChannelMetersEnabled()
+    {
+        return channelMetersEnabled;
+    }
+
+    void AudioSessionView::ChannelMetersEnabled(bool const& value)
+    {
+        channelMetersEnabled = value;
+
+        VolumePeakBorderLeft().Visibility(value ? Visibility::Collapsed : Visibility::Visible);
+        VolumePeakBorderRight().Visibility(value ? Visibility::Collapsed : Visibility::Visible);
+        PeakHoldBorderLeft().Visibility(value ? Visibility::Collapsed : Visibility::Visible);
+        PeakHoldBorderRight().Visibility(value ? Visibility::Collapsed : Visibility::Visible);
+        ChannelMetersPanel().Visibility(value ? Visibility::Visible : Visibility::Collapsed);
+
+        if (!value)
+        {
+            ChannelMetersPanel().Children().Clear();
+            channelMeterTransforms.clear();
+        }
+    }
+
     double AudioSessionView::Volume()
     {
         return _volume;
@@ -207,6 +218,48 @@ namespace winrt::SND_Vol::implementation
         }
     }
 
+    void AudioSessionView::SetLogo(const winrt::hstring& logoPath)
+    {
+        try
+        {
+            BitmapImage imageSource{ Uri(logoPath) };
+
+            Image image{};
+            image.Stretch(Stretch::Uniform);
+            image.Source(imageSource);
+
+            AudioSessionAppLogo().Content(image);
+            // The logo can be resolved after the view has been loaded, UserControl_Loaded will not switch the state anymore.
+            if (IsLoaded())
+            {
+                VisualStateManager::GoToState(*this, L"UsingLogo", true);
+            }
+        }
+        catch (const hresult_error& err)
+        {
+            OutputDebugHString(err.message());
+        }
+    }
+
+    void AudioSessionView::SetLogoBrush(const Brush& brush, const double& size)
+    {
+        // The brush is shared with the other views showing the same logo (icon atlas cell), the rectangle is scaled to the logo area.
+        winrt::Microsoft::UI::Xaml::Shapes::Rectangle rectangle{};
+        rectangle.Width(size);
+        rectangle.Height(size);
+        rectangle.Fill(brush);
+
+        Viewbox viewbox{};
+        viewbox.Stretch(Stretch::Uniform);
+        viewbox.Child(rectangle);
+
+        AudioSessionAppLogo().Content(viewbox);
+        if (IsLoaded())
+        {
+            VisualStateManager::GoToState(*this, L"UsingLogo", true);
+        }
+    }
+
     void AudioSessionView::SetPeak(float peak)
     {
         SetPeak(peak, peak);
@@ -214,21 +267,110 @@ namespace winrt::SND_Vol::implementation
 
     void AudioSessionView::SetPeak(const float& left, const float& right)
     {
-        float isVerticalFloat = static_cast<float>(isVertical);
-        LeftPeakAnimation().To(static_cast<double>(left * isVerticalFloat));
-        RightPeakAnimation().To(static_cast<double>(right * isVerticalFloat));
-
-        TopVolumeAnimation().To(static_cast<double>(left * !isVerticalFloat));
-        BottomVolumeAnimation().To(static_cast<double>(right * !isVerticalFloat));
+        // Composition meters read their values from the shared property set, nothing to do.
+        if (compositionMeters)
+        {
+            return;
+        }
 
+        // Values are already smoothed by the meter ballistics, set them directly instead of animating to them.
         if (isVertical)
         {
-            VerticalPeakStoryboard().Begin();
+            BorderClippingLeftCompositeTransform().ScaleY(static_cast<double>(left));
+            BorderClippingRightCompositeTransform().ScaleY(static_cast<double>(right));
         }
         else
         {
-            HorizontalPeakStoryboard().Begin();
+            BorderTopClippingCompositeTransform().ScaleX(static_cast<double>(left));
+            BorderBottomClippingCompositeTransform().ScaleX(static_cast<double>(right));
+        }
+    }
+
+    void AudioSessionView::SetPeakHold(const float& left, const float& right)
+    {
+        // Peak-hold markers are only shown on the vertical stereo meter.
+        if (!isVertical || channelMetersEnabled || compositionMeters)
+        {
+            return;
         }
+
+        double height = VolumePeakBorderLeft().ActualHeight() - PeakHoldBorderLeft().ActualHeight();
+        PeakHoldLeftTranslateTransform().Y(-static_cast<double>(left) * height);
+        PeakHoldRightTranslateTransform().Y(-static_cast<double>(right) * height);
+        PeakHoldBorderLeft().Opacity(left > 0.f ? 1. : 0.);
+        PeakHoldBorderRight().Opacity(right > 0.f ? 1. : 0.);
+    }
+
+    void AudioSessionView::SetChannelPeaks(const float& left, const float& right, winrt::array_view<float const> const& channels)
+    {
+        // The horizontal layout only has room for the stereo meter.
+        if (!channelMetersEnabled || !isVertical || channels.size() == 0)
+        {
+            SetPeak(left, right);
+            return;
+        }
+
+        if (channelMeterTransforms.size() != channels.size())
+        {
+            ChannelMetersPanel().Children().Clear();
+            channelMeterTransforms.clear();
+
+            for (uint32_t i = 0; i < channels.size(); i++)
+            {
+                ScaleTransform transform{};
+                transform.ScaleY(0);
+
+                Border bar{};
+                bar.Width(3);
+                bar.CornerRadius(Microsoft::UI::Xaml::CornerRadius{ 1.5, 1.5, 1.5, 1.5 });
+                bar.VerticalAlignment(VerticalAlignment::Stretch);
+                bar.Background(VolumePeakBorderLeft().Background());
+                bar.Opacity(VolumePeakBorderLeft().Opacity());
+                bar.RenderTransformOrigin(Point(0.5f, 1.f));
+                bar.RenderTransform(transform);
+
+                ChannelMetersPanel().Children().Append(bar);
+                channelMeterTransforms.push_back(transform);
+            }
+        }
+
+        for (uint32_t i = 0; i < channels.size(); i++)
+        {
+            channelMeterTransforms[i].ScaleY(static_cast<double>(channels[i]));
+        }
+    }
+
+    void AudioSessionView::UseCompositionMeters(winrt::Microsoft::UI::Composition::CompositionPropertySet const& meters, winrt::hstring const& key)
+    {
+        using namespace ::Rendering;
+
+        compositionMeters = true;
+
+        CompositionMeters::BindLevel(VolumePeakBorderLeft(), meters, key, L"X", MeterOrientation::Vertical);
+        CompositionMeters::BindLevel(VolumePeakBorderRight(), meters, key, L"Y", MeterOrientation::Vertical);
+        CompositionMeters::BindLevel(VolumePeakBorderTop(), meters, key, L"X", MeterOrientation::Horizontal);
+        CompositionMeters::BindLevel(VolumePeakBorderBottom(), meters, key, L"Y", MeterOrientation::Horizontal);
+        CompositionMeters::BindHold(PeakHoldBorderLeft(), VolumePeakBorderLeft(), meters, key, L"Z", -5.f);
+        CompositionMeters::BindHold(PeakHoldBorderRight(), VolumePeakBorderRight(), meters, key, L"W", 7.f);
+
+        // The horizontal borders are collapsed in the vertical layout (and vice versa), keep the length of each border up to date.
+        auto verticalSizeChanged = [](IInspectable const& sender, SizeChangedEventArgs const& e)
+        {
+            CompositionMeters::SetLength(sender.as<UIElement>(), e.NewSize().Height);
+        };
+        auto horizontalSizeChanged = [](IInspectable const& sender, SizeChangedEventArgs const& e)
+        {
+            CompositionMeters::SetLength(sender.as<UIElement>(), e.NewSize().Width);
+        };
+        VolumePeakBorderLeft().SizeChanged(verticalSizeChanged);
+        VolumePeakBorderRight().SizeChanged(verticalSizeChanged);
+        VolumePeakBorderTop().SizeChanged(horizontalSizeChanged);
+        VolumePeakBorderBottom().SizeChanged(horizontalSizeChanged);
+
+        CompositionMeters::SetLength(VolumePeakBorderLeft(), static_cast<float>(VolumePeakBorderLeft().ActualHeight()));
+        CompositionMeters::SetLength(VolumePeakBorderRight(), static_cast<float>(VolumePeakBorderRight().ActualHeight()));
+        CompositionMeters::SetLength(VolumePeakBorderTop(), static_cast<float>(VolumePeakBorderTop().ActualWidth()));
+        CompositionMeters::SetLength(VolumePeakBorderBottom(), static_cast<float>(VolumePeakBorderBottom().ActualWidth()));
     }
 
     Windows::Foundation::IAsyncAction AudioSessionView::SetImageSource(IStream* stream)
@@ -278,6 +420,12 @@ namespace winrt::SND_Vol::implementation
 
     void AudioSessionView::Grid_SizeChanged(IInspectable const&, SizeChangedEventArgs const&)
     {
+        // The XAML clips have been replaced by composition clips.
+        if (compositionMeters)
+        {
+            return;
+        }
+
         // For vertical layout.
         Rect borderClippingLeftRect = Rect(0, 0, VolumePeakBorderLeft().ActualWidth(), VolumePeakBorderLeft().ActualHeight());
         BorderClippingLeft().Rect(borderClippingLeftRect);
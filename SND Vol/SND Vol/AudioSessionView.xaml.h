@@ -26,6 +26,8 @@ namespace winrt::SND_Vol::implementation
         winrt::Microsoft::UI::Xaml::Controls::Orientation Orientation();
         void Orientation(const winrt::Microsoft::UI::Xaml::Controls::Orientation& value);
         winrt::Microsoft::UI::Xaml::Controls::ContentPresenter Logo();
+        bool ChannelMetersEnabled();
+        void ChannelMetersEnabled(bool const& value);
 
         winrt::event_token PropertyChanged(Microsoft::UI::Xaml::Data::PropertyChangedEventHandler const& value);
         void PropertyChanged(winrt::event_token const& token);
@@ -37,8 +39,13 @@ namespace winrt::SND_Vol::implementation
         void Hidden(winrt::event_token const& token);
 
         void SetState(const winrt::SND_Vol::AudioSessionState& state);
+        void SetLogo(const winrt::hstring& logoPath);
+        void SetLogoBrush(const winrt::Microsoft::UI::Xaml::Media::Brush& brush, const double& size);
         void SetPeak(float peak);
         void SetPeak(const float& peak1, const float& peak2);
+        void SetChannelPeaks(const float& left, const float& right, winrt::array_view<float const> const& channels);
+        void SetPeakHold(const float& left, const float& right);
+        void UseCompositionMeters(winrt::Microsoft::UI::Composition::CompositionPropertySet const& meters, winrt::hstring const& key);
         Windows::Foundation::IAsyncAction SetImageSource(IStream* stream);
 
         void Slider_ValueChanged(winrt::Windows::Foundation::IInspectable const&, winrt::Microsoft::UI::Xaml::Controls::Primitives::RangeBaseValueChangedEventArgs const& e);
@@ -61,6 +68,9 @@ namespace winrt::SND_Vol::implementation
         bool active = false;
         bool isLocked = false;
         bool isVertical = true;
+        bool channelMetersEnabled = false;
+        bool compositionMeters = false;
+        std::vector<winrt::Microsoft::UI::Xaml::Media::ScaleTransform> channelMeterTransforms{};
 
         winrt::event<Microsoft::UI::Xaml::Data::PropertyChangedEventHandler> e_propertyChanged;
         winrt::event<winrt::Windows::Foundation::TypedEventHandler<winrt::SND_Vol::AudioSessionView, Microsoft::UI::Xaml::Controls::Primitives::RangeBaseValueChangedEventArgs>>
@@ -30,6 +30,7 @@ namespace winrt::SND_Vol::implementation
     void AudioSessionsSettingsPage::Page_Loaded(IInspectable const&, RoutedEventArgs const& e)
     {
         ShowInactiveAudioSessionsToggleSwitch().IsOn(unbox_value_or(ApplicationData::Current().LocalSettings().Values().TryLookup(L"ShowInactiveSessionsOnStartup"), true));
+        ShowChannelMetersToggleSwitch().IsOn(unbox_value_or(ApplicationData::Current().LocalSettings().Values().TryLookup(L"ShowChannelMeters"), false));
     }
 
     void AudioSessionsSettingsPage::DeleteInactiveSessionsToggleSwitch_Toggled(IInspectable const&, RoutedEventArgs const&)
@@ -43,6 +44,11 @@ namespace winrt::SND_Vol::implementation
         ApplicationData::Current().LocalSettings().Values().Insert(L"ShowInactiveSessionsOnStartup", box_value(ShowInactiveAudioSessionsToggleSwitch().IsOn()));
     }
 
+    void AudioSessionsSettingsPage::ShowChannelMetersToggleSwitch_Toggled(IInspectable const&, RoutedEventArgs const&)
+    {
+        ApplicationData::Current().LocalSettings().Values().Insert(L"ShowChannelMeters", box_value(ShowChannelMetersToggleSwitch().IsOn()));
+    }
+
     void AudioSessionsSettingsPage::LimitNewSessionsLevelToggleSwitch_Toggled(IInspectable const&, RoutedEventArgs const&)
     {
         ApplicationData::Current().LocalSettings().Values().Insert(L"NewSessionsVolumeLimit", box_value(MaxVolumeSlider().Value()));
@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "ChannelPeaks.h"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define CHANNEL_PEAKS_SSE
+#elif defined(_M_ARM64)
+#include <arm64_neon.h>
+#define CHANNEL_PEAKS_NEON
+#endif
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+
+namespace Audio
+{
+    // Channels sent to the left and right sides of the downmix, bit i is channel i. Indexed by channel count, layouts follow the default
+    // WAVEFORMATEXTENSIBLE channel masks: mono, stereo, 3.0, quad, 5.0, 5.1, 6.1 and 7.1.
+    static constexpr uint8_t LeftChannels[MaxMeteringChannels + 1] = { 0x00, 0x01, 0x01, 0x05, 0x05, 0x0d, 0x15, 0x35, 0x55 };
+    static constexpr uint8_t RightChannels[MaxMeteringChannels + 1] = { 0x00, 0x01, 0x02, 0x06, 0x0a, 0x16, 0x26, 0x56, 0xa6 };
+
+
+#if defined(CHANNEL_PEAKS_SSE)
+    static inline __m128 LaneMask(const uint8_t& channels, const __m128i& laneBits)
+    {
+        __m128i bits = _mm_and_si128(_mm_set1_epi32(channels), laneBits);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(bits, laneBits));
+    }
+
+    static inline float HorizontalMax(__m128 value)
+    {
+        value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+        value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(value);
+    }
+#elif defined(CHANNEL_PEAKS_NEON)
+    static inline float32x4_t Masked(const float32x4_t& value, const uint8_t& channels, const uint32x4_t& laneBits)
+    {
+        uint32x4_t mask = vtstq_u32(vdupq_n_u32(channels), laneBits);
+        return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(value), mask));
+    }
+#endif
+
+
+    float ChannelPeaks::Max() const
+    {
+#if defined(CHANNEL_PEAKS_SSE)
+        __m128 low = _mm_load_ps(values.data());
+        __m128 high = _mm_load_ps(values.data() + 4);
+        return HorizontalMax(_mm_max_ps(low, high));
+#elif defined(CHANNEL_PEAKS_NEON)
+        return vmaxvq_f32(vmaxq_f32(vld1q_f32(values.data()), vld1q_f32(values.data() + 4)));
+#else
+        float max = 0.f;
+        for (const float& value : values)
+        {
+            max = value > max ? value : max;
+        }
+        return max;
+#endif
+    }
+
+    pair<float, float> ChannelPeaks::Stereo() const
+    {
+        const uint32_t layout = count > MaxMeteringChannels ? MaxMeteringChannels : count;
+        const uint8_t leftChannels = LeftChannels[layout];
+        const uint8_t rightChannels = RightChannels[layout];
+
+        // Peaks are never negative, masking a lane to 0 removes it from the max.
+#if defined(CHANNEL_PEAKS_SSE)
+        const __m128i lowLaneBits = _mm_setr_epi32(0x01, 0x02, 0x04, 0x08);
+        const __m128i highLaneBits = _mm_setr_epi32(0x10, 0x20, 0x40, 0x80);
+        __m128 low = _mm_load_ps(values.data());
+        __m128 high = _mm_load_ps(values.data() + 4);
+
+        __m128 left = _mm_max_ps(
+            _mm_and_ps(low, LaneMask(leftChannels, lowLaneBits)),
+            _mm_and_ps(high, LaneMask(leftChannels, highLaneBits))
+        );
+        __m128 right = _mm_max_ps(
+            _mm_and_ps(low, LaneMask(rightChannels, lowLaneBits)),
+            _mm_and_ps(high, LaneMask(rightChannels, highLaneBits))
+        );
+        return { HorizontalMax(left), HorizontalMax(right) };
+#elif defined(CHANNEL_PEAKS_NEON)
+        const uint32_t lowBits[4] = { 0x01, 0x02, 0x04, 0x08 };
+        const uint32_t highBits[4] = { 0x10, 0x20, 0x40, 0x80 };
+        const uint32x4_t lowLaneBits = vld1q_u32(lowBits);
+        const uint32x4_t highLaneBits = vld1q_u32(highBits);
+        float32x4_t low = vld1q_f32(values.data());
+        float32x4_t high = vld1q_f32(values.data() + 4);
+
+        float32x4_t left = vmaxq_f32(Masked(low, leftChannels, lowLaneBits), Masked(high, leftChannels, highLaneBits));
+        float32x4_t right = vmaxq_f32(Masked(low, rightChannels, lowLaneBits), Masked(high, rightChannels, highLaneBits));
+        return { vmaxvq_f32(left), vmaxvq_f32(right) };
+#else
+        pair<float, float> peaks{};
+        for (uint32_t i = 0; i < MaxMeteringChannels; i++)
+        {
+            if ((leftChannels >> i) & 1)
+            {
+                peaks.first = values[i] > peaks.first ? values[i] : peaks.first;
+            }
+            if ((rightChannels >> i) & 1)
+            {
+                peaks.second = values[i] > peaks.second ? values[i] : peaks.second;
+            }
+        }
+        return peaks;
+#endif
+    }
+
+
+    HRESULT ReadChannelPeaks(IAudioMeterInformation* audioMeter, const uint32_t& channelCount, ChannelPeaks& peaks)
+    {
+        peaks = ChannelPeaks();
+        if (channelCount == 0)
+        {
+            return S_OK;
+        }
+
+        if (channelCount <= MaxMeteringChannels)
+        {
+            HRESULT hr = audioMeter->GetChannelsPeakValues(channelCount, peaks.values.data());
+            peaks.count = SUCCEEDED(hr) ? channelCount : 0;
+            return hr;
+        }
+
+        // GetChannelsPeakValues fails unless it is given the exact channel count.
+        vector<float> channelsPeak(channelCount, 0.f);
+        HRESULT hr = audioMeter->GetChannelsPeakValues(channelCount, channelsPeak.data());
+        if (SUCCEEDED(hr))
+        {
+            copy_n(channelsPeak.begin(), MaxMeteringChannels, peaks.values.begin());
+            peaks.count = MaxMeteringChannels;
+        }
+        return hr;
+    }
+}
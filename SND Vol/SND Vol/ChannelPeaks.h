@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <stdint.h>
+#include <utility>
+
+namespace Audio
+{
+    /**
+     * @brief Maximum number of channels metered per audio session or endpoint (7.1).
+    */
+    constexpr uint32_t MaxMeteringChannels = 8;
+
+    /**
+     * @brief Fixed capacity peak values for up to MaxMeteringChannels channels, in the WAVEFORMATEXTENSIBLE speaker order.
+    */
+    struct ChannelPeaks
+    {
+        /**
+         * @brief Peak values, entries past count are always 0.
+        */
+        alignas(16) std::array<float, MaxMeteringChannels> values{};
+        uint32_t count = 0;
+
+        /**
+         * @brief Gets the peak values of the metered channels.
+         * @return Span of count peak values ∈ [0, 1]
+        */
+        inline std::span<const float> Channels() const
+        {
+            return std::span<const float>(values.data(), count);
+        };
+
+        /**
+         * @brief Gets the loudest channel peak.
+         * @return Peak value ∈ [0, 1]
+        */
+        float Max() const;
+        /**
+         * @brief Downmixes the channel peaks to a stereo pair, front center is sent to both sides and LFE is ignored.
+         * @return Left and right peak values ∈ [0, 1]
+        */
+        std::pair<float, float> Stereo() const;
+    };
+
+    /**
+     * @brief Reads the channel peaks of an audio meter. Layouts wider than MaxMeteringChannels are truncated.
+     * @param audioMeter Audio meter of a session or an endpoint
+     * @param channelCount Metering channel count reported by the audio meter
+     * @param peaks Receives the channel peaks
+     * @return HRESULT of IAudioMeterInformation::GetChannelsPeakValues
+    */
+    HRESULT ReadChannelPeaks(IAudioMeterInformation* audioMeter, const uint32_t& channelCount, ChannelPeaks& peaks);
+}
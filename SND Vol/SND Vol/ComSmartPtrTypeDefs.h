@@ -7,6 +7,10 @@ _COM_SMARTPTR_TYPEDEF(IStream, __uuidof(IStream));
 _COM_SMARTPTR_TYPEDEF(IMMDevice, __uuidof(IMMDevice));
 // IMMDeviceEnumeratorPtr
 _COM_SMARTPTR_TYPEDEF(IMMDeviceEnumerator, __uuidof(IMMDeviceEnumerator));
+// IMMDeviceCollectionPtr
+_COM_SMARTPTR_TYPEDEF(IMMDeviceCollection, __uuidof(IMMDeviceCollection));
+// IMMEndpointPtr
+_COM_SMARTPTR_TYPEDEF(IMMEndpoint, __uuidof(IMMEndpoint));
 // IAudioSessionManager2Ptr
 _COM_SMARTPTR_TYPEDEF(IAudioSessionManager2, __uuidof(IAudioSessionManager2));
 // IAudioSessionManager2Ptr
@@ -0,0 +1,101 @@
+#include "pch.h"
+#include "CompositionMeters.h"
+
+#include <winrt/Microsoft.UI.Xaml.Hosting.h>
+
+using namespace winrt;
+using namespace winrt::Microsoft::UI::Composition;
+using namespace winrt::Microsoft::UI::Xaml;
+using namespace winrt::Microsoft::UI::Xaml::Hosting;
+using namespace winrt::Windows::Foundation::Numerics;
+
+
+namespace Rendering
+{
+    CompositionMeters::CompositionMeters(Compositor const& compositor) :
+        values{ compositor.CreatePropertySet() }
+    {
+    }
+
+
+    hstring CompositionMeters::CreateKey()
+    {
+        hstring key{};
+        if (!releasedKeys.empty())
+        {
+            key = releasedKeys.back();
+            releasedKeys.pop_back();
+        }
+        else
+        {
+            key = L"m" + to_hstring(nextKey++);
+        }
+
+        // Expressions fail to resolve properties that do not exist yet, the entry is created before any binding.
+        values.InsertVector4(key, float4::zero());
+        return key;
+    }
+
+    void CompositionMeters::ReleaseKey(const hstring& key)
+    {
+        if (!key.empty())
+        {
+            values.InsertVector4(key, float4::zero());
+            releasedKeys.push_back(key);
+        }
+    }
+
+    void CompositionMeters::Set(const hstring& key, const float4& meterValues)
+    {
+        values.InsertVector4(key, meterValues);
+    }
+
+
+    void CompositionMeters::BindLevel(UIElement const& element, CompositionPropertySet const& meters, const hstring& key, const wchar_t* component, const MeterOrientation& orientation)
+    {
+        element.Clip(nullptr);
+
+        Visual visual = ElementCompositionPreview::GetElementVisual(element);
+        Compositor compositor = visual.Compositor();
+        // The handoff visual size is not kept up to date by XAML, the length is stored in the visual properties on size changed.
+        visual.Properties().InsertScalar(L"Length", 0.f);
+
+        InsetClip clip = compositor.CreateInsetClip();
+        visual.Clip(clip);
+
+        ExpressionAnimation animation = compositor.CreateExpressionAnimation(
+            L"layout.Length * (1 - Clamp(meters." + key + L"." + component + L", 0, 1))"
+        );
+        animation.SetReferenceParameter(L"meters", meters);
+        animation.SetReferenceParameter(L"layout", visual.Properties());
+
+        clip.StartAnimation(orientation == MeterOrientation::Vertical ? L"TopInset" : L"RightInset", animation);
+    }
+
+    void CompositionMeters::BindHold(UIElement const& marker, UIElement const& levelElement, CompositionPropertySet const& meters, const hstring& key, const wchar_t* component, const float& translationX)
+    {
+        Visual levelVisual = ElementCompositionPreview::GetElementVisual(levelElement);
+        Compositor compositor = levelVisual.Compositor();
+        float markerHeight = static_cast<float>(marker.as<FrameworkElement>().Height());
+
+        hstring value = L"meters." + key + L"." + component;
+
+        ExpressionAnimation translation = compositor.CreateExpressionAnimation(
+            L"Vector3(" + to_hstring(translationX) + L", -Max(layout.Length - " + to_hstring(markerHeight) + L", 0) * Clamp(" + value + L", 0, 1), 0)"
+        );
+        translation.SetReferenceParameter(L"meters", meters);
+        translation.SetReferenceParameter(L"layout", levelVisual.Properties());
+        translation.Target(L"Translation");
+        marker.StartAnimation(translation);
+
+        ExpressionAnimation opacity = compositor.CreateExpressionAnimation(value + L" > 0 ? 1 : 0");
+        opacity.SetReferenceParameter(L"meters", meters);
+        opacity.Target(L"Opacity");
+        marker.StartAnimation(opacity);
+    }
+
+    void CompositionMeters::SetLength(UIElement const& element, const float& length)
+    {
+        ElementCompositionPreview::GetElementVisual(element).Properties().InsertScalar(L"Length", length);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <winrt/Windows.Foundation.Numerics.h>
+
+namespace Rendering
+{
+    enum class MeterOrientation
+    {
+        /**
+         * @brief The meter fills from the bottom.
+        */
+        Vertical,
+        /**
+         * @brief The meter fills from the left.
+        */
+        Horizontal
+    };
+
+    /**
+     * @brief Composition property set shared by every meter of a window. Each meter owns a Vector4 entry (X: left, Y: right,
+     * Z: left peak-hold, W: right peak-hold) and its visuals are driven by expression animations reading the entry, updating a meter
+     * is a single property write instead of a storyboard restart.
+    */
+    class CompositionMeters
+    {
+    public:
+        CompositionMeters() = default;
+        /**
+         * @brief Default constructor.
+         * @param compositor Compositor of the window hosting the meters
+        */
+        CompositionMeters(winrt::Microsoft::UI::Composition::Compositor const& compositor);
+
+        inline explicit operator bool() const
+        {
+            return static_cast<bool>(values);
+        };
+
+        inline winrt::Microsoft::UI::Composition::CompositionPropertySet Values() const
+        {
+            return values;
+        };
+
+        /**
+         * @brief Allocates an entry in the property set, reusing released entries.
+         * @return Name of the entry, initialized to 0
+        */
+        winrt::hstring CreateKey();
+        /**
+         * @brief Releases an entry so that it can be reused by another meter.
+         * @param key Name of the entry
+        */
+        void ReleaseKey(const winrt::hstring& key);
+        /**
+         * @brief Sets the values of a meter.
+         * @param key Name of the entry
+         * @param meterValues Left, right, left peak-hold and right peak-hold values ∈ [0, 1]
+        */
+        void Set(const winrt::hstring& key, const winrt::Windows::Foundation::Numerics::float4& meterValues);
+
+        /**
+         * @brief Clips an element with an inset clip driven by a component of a meter entry. The XAML clip of the element is removed.
+         * @param element Element filled by the meter
+         * @param meters Property set of the meters
+         * @param key Name of the entry
+         * @param component Component of the entry (X, Y, Z or W)
+         * @param orientation Direction in which the meter fills
+        */
+        static void BindLevel(
+            winrt::Microsoft::UI::Xaml::UIElement const& element,
+            winrt::Microsoft::UI::Composition::CompositionPropertySet const& meters,
+            const winrt::hstring& key,
+            const wchar_t* component,
+            const MeterOrientation& orientation
+        );
+        /**
+         * @brief Moves a vertical peak-hold marker along a level element with an expression animation on its translation.
+         * @param marker Peak-hold marker, aligned to the bottom of the level element
+         * @param levelElement Element the marker moves along, previously bound with BindLevel
+         * @param meters Property set of the meters
+         * @param key Name of the entry
+         * @param component Component of the entry (X, Y, Z or W)
+         * @param translationX Horizontal translation of the marker
+        */
+        static void BindHold(
+            winrt::Microsoft::UI::Xaml::UIElement const& marker,
+            winrt::Microsoft::UI::Xaml::UIElement const& levelElement,
+            winrt::Microsoft::UI::Composition::CompositionPropertySet const& meters,
+            const winrt::hstring& key,
+            const wchar_t* component,
+            const float& translationX
+        );
+        /**
+         * @brief Updates the length read by the expressions of an element bound with BindLevel, to be called when the element is resized.
+         * @param element Element filled by the meter
+         * @param length Height of a vertical meter, width of a horizontal one
+        */
+        static void SetLength(winrt::Microsoft::UI::Xaml::UIElement const& element, const float& length);
+
+    private:
+        winrt::Microsoft::UI::Composition::CompositionPropertySet values{ nullptr };
+        std::vector<winrt::hstring> releasedKeys{};
+        uint32_t nextKey = 0;
+    };
+}
@@ -0,0 +1,230 @@
+#include "pch.h"
+#include "FrameClock.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace winrt::Microsoft::UI::Dispatching;
+
+
+namespace System
+{
+	FrameClock& FrameClock::GetForCurrentThread()
+	{
+		thread_local FrameClock instance{};
+		return instance;
+	}
+
+
+	uint32_t FrameClock::Register(const FrameClockPriority& priority, Callback&& callback)
+	{
+		if (!timer)
+		{
+			timer = DispatcherQueue::GetForCurrentThread().CreateTimer();
+			timer.IsRepeating(false);
+			timer.Tick([this](auto, auto)
+			{
+				Dispatch();
+			});
+		}
+
+		Entry entry{};
+		entry.token = nextToken++;
+		entry.priority = priority;
+		entry.callback = std::move(callback);
+
+		uint32_t token = entry.token;
+		if (dispatching)
+		{
+			pendingEntries.push_back(std::move(entry));
+		}
+		else
+		{
+			Insert(std::move(entry));
+		}
+		return token;
+	}
+
+	void FrameClock::Unregister(const uint32_t& token)
+	{
+		if (Entry* entry = Find(token))
+		{
+			// The entry might be the one being dispatched, it is erased once the dispatch is over.
+			entry->removed = true;
+			entry->running = false;
+
+			if (!dispatching)
+			{
+				erase_if(entries, [](const Entry& entry) { return entry.removed; });
+				Schedule();
+			}
+		}
+	}
+
+	void FrameClock::Start(const uint32_t& token, const chrono::milliseconds& period)
+	{
+		if (Entry* entry = Find(token))
+		{
+			entry->period = period;
+			entry->lastRun = chrono::steady_clock::now();
+			entry->due = entry->lastRun + period;
+			entry->running = true;
+			Schedule();
+		}
+	}
+
+	void FrameClock::Stop(const uint32_t& token)
+	{
+		if (Entry* entry = Find(token))
+		{
+			entry->running = false;
+			Schedule();
+		}
+	}
+
+	bool FrameClock::IsRunning(const uint32_t& token) const
+	{
+		const Entry* entry = Find(token);
+		return entry && entry->running;
+	}
+
+	chrono::milliseconds FrameClock::Period(const uint32_t& token) const
+	{
+		const Entry* entry = Find(token);
+		return entry ? entry->period : chrono::milliseconds(0);
+	}
+
+	void FrameClock::Period(const uint32_t& token, const chrono::milliseconds& period)
+	{
+		Entry* entry = Find(token);
+		if (entry && entry->period != period)
+		{
+			entry->period = period;
+			entry->due = entry->lastRun + period;
+			Schedule();
+		}
+	}
+
+
+	FrameClock::Entry* FrameClock::Find(const uint32_t& token)
+	{
+		return const_cast<Entry*>(static_cast<const FrameClock*>(this)->Find(token));
+	}
+
+	const FrameClock::Entry* FrameClock::Find(const uint32_t& token) const
+	{
+		if (token == 0)
+		{
+			return nullptr;
+		}
+
+		for (const vector<Entry>* list : { &entries, &pendingEntries })
+		{
+			for (const Entry& entry : *list)
+			{
+				if (entry.token == token && !entry.removed)
+				{
+					return &entry;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	void FrameClock::Insert(Entry&& entry)
+	{
+		auto position = upper_bound(entries.begin(), entries.end(), entry.priority, [](const FrameClockPriority& priority, const Entry& other)
+		{
+			return priority < other.priority;
+		});
+		entries.insert(position, std::move(entry));
+	}
+
+	void FrameClock::Dispatch()
+	{
+		dispatching = true;
+
+		chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+		// Callbacks due before the middle of the next frame run now, the next tick would be too late for them anyway.
+		chrono::steady_clock::time_point frameEnd = frameStart + FrameInterval / 2;
+
+		// New entries are queued in pendingEntries during the dispatch, the vector is not reallocated by the callbacks.
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			Entry& entry = entries[i];
+			if (!entry.running || entry.removed || entry.due > frameEnd)
+			{
+				continue;
+			}
+
+			if (entry.priority == FrameClockPriority::Low && chrono::steady_clock::now() - frameStart > FrameInterval)
+			{
+				// Frame budget spent, retry on the next frame.
+				entry.due = frameStart + FrameInterval;
+				continue;
+			}
+
+			entry.lastRun = frameStart;
+			// Skip missed periods instead of running the callback several times in a row.
+			entry.due += entry.period;
+			if (entry.due <= frameStart)
+			{
+				entry.due = frameStart + entry.period;
+			}
+
+			try
+			{
+				entry.callback();
+			}
+			catch (const winrt::hresult_error& error)
+			{
+				OutputDebugHString(L"Frame clock callback failed: " + error.message());
+			}
+		}
+
+		dispatching = false;
+
+		erase_if(entries, [](const Entry& entry) { return entry.removed; });
+		for (Entry& entry : pendingEntries)
+		{
+			if (!entry.removed)
+			{
+				Insert(std::move(entry));
+			}
+		}
+		pendingEntries.clear();
+
+		Schedule();
+	}
+
+	void FrameClock::Schedule()
+	{
+		// Dispatch reschedules once every callback has run.
+		if (dispatching || !timer)
+		{
+			return;
+		}
+
+		bool any = false;
+		chrono::steady_clock::time_point due = chrono::steady_clock::time_point::max();
+		for (const Entry& entry : entries)
+		{
+			if (entry.running && entry.due < due)
+			{
+				due = entry.due;
+				any = true;
+			}
+		}
+
+		if (!any)
+		{
+			// Nothing to run, the UI thread is not woken up anymore.
+			timer.Stop();
+			return;
+		}
+
+		chrono::milliseconds delay = chrono::duration_cast<chrono::milliseconds>(due - chrono::steady_clock::now());
+		timer.Interval(delay.count() > 0 ? delay : chrono::milliseconds(1));
+		timer.Start();
+	}
+}
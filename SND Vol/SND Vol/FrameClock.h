@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+namespace System
+{
+	enum class FrameClockPriority : uint8_t
+	{
+		/**
+		 * @brief Runs first in the frame (meters).
+		*/
+		High = 0,
+		Normal = 1,
+		/**
+		 * @brief Deferred to the next frame when the frame budget has already been spent.
+		*/
+		Low = 2
+	};
+
+	/**
+	 * @brief Single timer driving every periodic piece of work of a UI thread. Callbacks due in the same frame run in a single
+	 * dispatch, ordered by priority, and the timer is stopped when no callback is running.
+	*/
+	class FrameClock
+	{
+	public:
+		using Callback = std::function<void()>;
+
+		static constexpr std::chrono::milliseconds FrameInterval{ 16 };
+
+		/**
+		 * @brief Copy constructor.
+		*/
+		FrameClock(const FrameClock& other) = delete;
+
+		/**
+		 * @brief Gets the frame clock of the calling thread, the thread must have a DispatcherQueue.
+		*/
+		static FrameClock& GetForCurrentThread();
+
+		/**
+		 * @brief Registers a callback. The callback does not run until started.
+		 * @param priority Order of the callback in the frame
+		 * @param callback Callback, called on the clock thread
+		 * @return Token identifying the callback, never 0
+		*/
+		uint32_t Register(const FrameClockPriority& priority, Callback&& callback);
+		/**
+		 * @brief Unregisters a callback. Can be called from any callback, including the one being unregistered.
+		 * @param token Token returned by Register, 0 is ignored
+		*/
+		void Unregister(const uint32_t& token);
+		/**
+		 * @brief Starts or restarts a callback, it first runs one period from now.
+		 * @param token Token returned by Register
+		 * @param period Period of the callback
+		*/
+		void Start(const uint32_t& token, const std::chrono::milliseconds& period);
+		/**
+		 * @brief Stops a callback, it stays registered.
+		 * @param token Token returned by Register
+		*/
+		void Stop(const uint32_t& token);
+		bool IsRunning(const uint32_t& token) const;
+		std::chrono::milliseconds Period(const uint32_t& token) const;
+		/**
+		 * @brief Changes the period of a running callback without resetting its phase: the next run is one new period after the last run.
+		 * @param token Token returned by Register
+		 * @param period New period
+		*/
+		void Period(const uint32_t& token, const std::chrono::milliseconds& period);
+
+		/**
+		 * @brief Copy operator.
+		*/
+		FrameClock& operator=(const FrameClock& other) = delete;
+
+	private:
+		struct Entry
+		{
+			uint32_t token = 0;
+			FrameClockPriority priority = FrameClockPriority::Normal;
+			Callback callback{};
+			std::chrono::milliseconds period{};
+			std::chrono::steady_clock::time_point lastRun{};
+			std::chrono::steady_clock::time_point due{};
+			bool running = false;
+			bool removed = false;
+		};
+
+		winrt::Microsoft::UI::Dispatching::DispatcherQueueTimer timer{ nullptr };
+		/**
+		 * @brief Entries sorted by priority, then by registration order.
+		*/
+		std::vector<Entry> entries{};
+		/**
+		 * @brief Entries registered while dispatching, inserted once the dispatch is over.
+		*/
+		std::vector<Entry> pendingEntries{};
+		uint32_t nextToken = 1;
+		bool dispatching = false;
+
+		/**
+		 * @brief Default constructor.
+		*/
+		FrameClock() = default;
+
+		Entry* Find(const uint32_t& token);
+		const Entry* Find(const uint32_t& token) const;
+		void Insert(Entry&& entry);
+		void Dispatch();
+		void Schedule();
+	};
+}
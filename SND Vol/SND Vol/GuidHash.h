@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstring>
+#include <stdint.h>
+
+/**
+ * @brief Hash function object for GUIDs, used to key unordered containers by session/grouping ids.
+*/
+struct GuidHash
+{
+    inline size_t operator()(const GUID& guid) const noexcept
+    {
+        uint64_t halves[2]{};
+        memcpy(halves, &guid, sizeof(GUID));
+        // Session ids are generated by UuidCreate, the bits are already well distributed.
+        return static_cast<size_t>(halves[0] ^ (halves[1] * 0x9e3779b97f4a7c15ull));
+    }
+};
@@ -0,0 +1,287 @@
+#include "pch.h"
+#include "IconAtlas.h"
+
+#include <robuffer.h>
+#include "IconCache.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace winrt;
+using namespace winrt::Microsoft::UI::Xaml::Media;
+using namespace winrt::Microsoft::UI::Xaml::Media::Imaging;
+
+
+namespace Imaging
+{
+	uint32_t IconAtlas::CellPixelsAt(const double& rasterizationScale)
+	{
+		return static_cast<uint32_t>(ceil(CellSize * (rasterizationScale > 0. ? rasterizationScale : 1.)));
+	}
+
+	void IconAtlas::Scale(const double& rasterizationScale, const vector<IconPixels>& logos)
+	{
+		double newScale = rasterizationScale > 0. ? rasterizationScale : 1.;
+		if (newScale == scale)
+		{
+			return;
+		}
+
+		scale = newScale;
+		cellPixels = CellPixelsAt(scale);
+		pages.clear();
+
+		unordered_map<wstring, const IconPixels*> decodedLogos{};
+		for (const IconPixels& logo : logos)
+		{
+			if (logo.size == cellPixels && logo.pixels.size() == static_cast<size_t>(cellPixels) * cellPixels * 4)
+			{
+				decodedLogos.insert({ logo.path, &logo });
+			}
+		}
+
+		// The brushes are kept, the views using them get the logos at the new resolution without being updated.
+		for (auto& [path, entry] : entries)
+		{
+			try
+			{
+				const uint8_t* pixels = nullptr;
+				auto decodedLogo = decodedLogos.find(path);
+				if (decodedLogo != decodedLogos.end())
+				{
+					pixels = decodedLogo->second->pixels.data();
+				}
+				else
+				{
+					// Acquired while the logos were decoded for the new scale.
+					IconCache::Current().CopyIconPixels(path, cellPixels, decodeBuffer);
+					pixels = decodeBuffer.data();
+				}
+
+				AllocateCell(entry.page, entry.cell);
+				pages[entry.page].cells[entry.cell] = path;
+				WriteCell(entry.page, entry.cell, pixels, cellPixels * 4);
+				BindBrush(entry);
+			}
+			catch (const hresult_error& error)
+			{
+				OutputDebugHString(L"Icon atlas: failed to decode '" + hstring(path) + L"'. " + error.message());
+				entry.brush.ImageSource(nullptr);
+				entry.page = SIZE_MAX;
+			}
+		}
+
+		for (Page& page : pages)
+		{
+			page.bitmap.Invalidate();
+		}
+	}
+
+	Brush IconAtlas::Acquire(const wstring& path)
+	{
+		auto it = entries.find(path);
+		if (it != entries.end())
+		{
+			it->second.references++;
+			return it->second.brush;
+		}
+
+		// Logo not decoded beforehand (session resolved without the metadata resolver, or decoded for another scale).
+		TRACE_SPAN(L"IconAtlas::Acquire", GUID{}, 0);
+		try
+		{
+			IconCache::Current().CopyIconPixels(path, cellPixels, decodeBuffer);
+		}
+		catch (const hresult_error& error)
+		{
+			OutputDebugHString(L"Icon atlas: failed to decode '" + hstring(path) + L"'. " + error.message());
+			return nullptr;
+		}
+
+		return Insert(path, decodeBuffer.data());
+	}
+
+	Brush IconAtlas::Acquire(const IconPixels& icon)
+	{
+		if (icon.size != cellPixels || icon.pixels.size() != static_cast<size_t>(cellPixels) * cellPixels * 4)
+		{
+			// Decoded for another display scale.
+			return Acquire(icon.path);
+		}
+
+		auto it = entries.find(icon.path);
+		if (it != entries.end())
+		{
+			it->second.references++;
+			return it->second.brush;
+		}
+
+		return Insert(icon.path, icon.pixels.data());
+	}
+
+	void IconAtlas::Release(const wstring& path)
+	{
+		auto it = entries.find(path);
+		if (it == entries.end() || --it->second.references > 0)
+		{
+			return;
+		}
+
+		Entry& entry = it->second;
+		if (entry.page < pages.size())
+		{
+			pages[entry.page].cells[entry.cell].clear();
+			pages[entry.page].used--;
+		}
+		entries.erase(it);
+
+		Compact();
+	}
+
+	vector<wstring> IconAtlas::Paths() const
+	{
+		vector<wstring> paths{};
+		paths.reserve(entries.size());
+		for (const auto& [path, entry] : entries)
+		{
+			paths.push_back(path);
+		}
+		return paths;
+	}
+
+	IconAtlasStatistics IconAtlas::Statistics() const
+	{
+		IconAtlasStatistics statistics{};
+		statistics.entries = entries.size();
+		statistics.pages = pages.size();
+		statistics.cellSize = cellPixels;
+		statistics.bytes = pages.size() * PageColumns * PageRows * cellPixels * cellPixels * 4;
+		return statistics;
+	}
+
+
+	Brush IconAtlas::Insert(const wstring& path, const uint8_t* pixels)
+	{
+		Entry entry{};
+		entry.references = 1;
+		AllocateCell(entry.page, entry.cell);
+		pages[entry.page].cells[entry.cell] = path;
+		WriteCell(entry.page, entry.cell, pixels, cellPixels * 4);
+		pages[entry.page].bitmap.Invalidate();
+
+		entry.brush = ImageBrush();
+		entry.brush.Stretch(Stretch::None);
+		entry.brush.AlignmentX(AlignmentX::Left);
+		entry.brush.AlignmentY(AlignmentY::Top);
+		entry.brush.Transform(CompositeTransform());
+		BindBrush(entry);
+
+		Brush brush = entry.brush;
+		entries.insert({ path, move(entry) });
+		return brush;
+	}
+
+	void IconAtlas::AllocateCell(size_t& page, uint32_t& cell)
+	{
+		for (size_t i = 0; i < pages.size(); i++)
+		{
+			if (pages[i].used == PageColumns * PageRows)
+			{
+				continue;
+			}
+
+			for (uint32_t j = 0; j < pages[i].cells.size(); j++)
+			{
+				if (pages[i].cells[j].empty())
+				{
+					page = i;
+					cell = j;
+					pages[i].used++;
+					return;
+				}
+			}
+		}
+
+		Page newPage{};
+		newPage.bitmap = WriteableBitmap(static_cast<int32_t>(PageColumns * cellPixels), static_cast<int32_t>(PageRows * cellPixels));
+		check_hresult(newPage.bitmap.PixelBuffer().as<::Windows::Storage::Streams::IBufferByteAccess>()->Buffer(&newPage.pixels));
+		newPage.cells.resize(PageColumns * PageRows);
+		newPage.used = 1;
+		pages.push_back(move(newPage));
+
+		page = pages.size() - 1;
+		cell = 0;
+	}
+
+	void IconAtlas::WriteCell(const size_t& page, const uint32_t& cell, const uint8_t* pixels, const uint32_t& stride)
+	{
+		uint32_t pageStride = PageColumns * cellPixels * 4;
+		uint8_t* destination = pages[page].pixels + static_cast<size_t>(cell / PageColumns) * cellPixels * pageStride + static_cast<size_t>(cell % PageColumns) * cellPixels * 4;
+		for (uint32_t row = 0; row < cellPixels; row++)
+		{
+			memcpy(destination + static_cast<size_t>(row) * pageStride, pixels + static_cast<size_t>(row) * stride, static_cast<size_t>(cellPixels) * 4);
+		}
+	}
+
+	void IconAtlas::BindBrush(Entry& entry)
+	{
+		entry.brush.ImageSource(pages[entry.page].bitmap);
+
+		// The bitmap is laid out at one effective pixel per pixel, scaling it down by the display scale maps each pixel to a physical pixel and
+		// a cell to CellSize effective pixels.
+		CompositeTransform transform = entry.brush.Transform().as<CompositeTransform>();
+		transform.ScaleX(1. / scale);
+		transform.ScaleY(1. / scale);
+		transform.TranslateX(-static_cast<double>((entry.cell % PageColumns) * cellPixels) / scale);
+		transform.TranslateY(-static_cast<double>((entry.cell / PageColumns) * cellPixels) / scale);
+	}
+
+	void IconAtlas::Compact()
+	{
+		while (!pages.empty())
+		{
+			size_t last = pages.size() - 1;
+			uint32_t freeCells = 0;
+			for (size_t i = 0; i < last; i++)
+			{
+				freeCells += PageColumns * PageRows - pages[i].used;
+			}
+			if (last > 0 && pages[last].used > freeCells)
+			{
+				return;
+			}
+			if (last == 0 && pages[last].used > 0)
+			{
+				return;
+			}
+
+			// Every logo of the last page fits in the other pages, AllocateCell does not reach the last page.
+			vector<bool> invalidated(last, false);
+			uint32_t pageStride = PageColumns * cellPixels * 4;
+			for (uint32_t cell = 0; cell < pages[last].cells.size(); cell++)
+			{
+				if (pages[last].cells[cell].empty())
+				{
+					continue;
+				}
+
+				Entry& entry = entries.at(pages[last].cells[cell]);
+				AllocateCell(entry.page, entry.cell);
+				pages[entry.page].cells[entry.cell] = pages[last].cells[cell];
+
+				const uint8_t* source = pages[last].pixels + static_cast<size_t>(cell / PageColumns) * cellPixels * pageStride + static_cast<size_t>(cell % PageColumns) * cellPixels * 4;
+				WriteCell(entry.page, entry.cell, source, pageStride);
+				BindBrush(entry);
+				invalidated[entry.page] = true;
+			}
+
+			for (size_t i = 0; i < last; i++)
+			{
+				if (invalidated[i])
+				{
+					pages[i].bitmap.Invalidate();
+				}
+			}
+			pages.pop_back();
+		}
+	}
+}
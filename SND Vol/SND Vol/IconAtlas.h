@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "IconHelper.h"
+
+namespace Imaging
+{
+	struct IconAtlasStatistics
+	{
+		size_t entries = 0;
+		size_t pages = 0;
+		uint32_t cellSize = 0;
+		/**
+		 * @brief Memory used by the pages, in bytes.
+		*/
+		size_t bytes = 0;
+	};
+
+	/**
+	 * @brief Packs the logos of the audio session views into a few shared WriteableBitmap pages, decoded once at the display scale. Each logo
+	 * is painted by one ImageBrush showing its cell of a page, shared by every view using the logo. Entries are reference counted, and the
+	 * last page is emptied into the free cells of the others when logos are released. UI thread only, the logos are decoded beforehand on
+	 * worker threads (IconPixels, see IconCache::CopyIconPixels) and only copied to the pages.
+	*/
+	class IconAtlas
+	{
+	public:
+		/**
+		 * @brief Size of a cell in effective pixels, at least the height of the logo in the session views.
+		*/
+		static constexpr double CellSize = 36.;
+		static constexpr uint32_t PageColumns = 8;
+		static constexpr uint32_t PageRows = 4;
+
+		/**
+		 * @brief Width and height of a cell, in physical pixels.
+		*/
+		inline uint32_t CellPixels() const
+		{
+			return cellPixels;
+		};
+		/**
+		 * @brief Width and height of a cell at a rasterization scale, in physical pixels.
+		*/
+		static uint32_t CellPixelsAt(const double& rasterizationScale);
+
+		/**
+		 * @brief Sets the rasterization scale of the display. When it changes, the pages are rebuilt at the new size from the given pixels.
+		 * @param rasterizationScale Scale of the display
+		 * @param logos Logos of the atlas (Paths) decoded at CellPixelsAt(rasterizationScale). Logos missing from them are decoded again
+		*/
+		void Scale(const double& rasterizationScale, const std::vector<IconPixels>& logos = {});
+		/**
+		 * @brief Gets the brush painting a logo, decoding the logo into a free cell if it is not in the atlas yet. Adds a reference to the entry.
+		 * @param path Path of the logo
+		 * @return Brush painting the logo in a CellSize x CellSize area. Null if the logo could not be decoded
+		*/
+		winrt::Microsoft::UI::Xaml::Media::Brush Acquire(const std::wstring& path);
+		/**
+		 * @brief Gets the brush painting a logo already decoded away from the UI thread, copying the pixels into a free cell if the logo is not
+		 * in the atlas yet. Adds a reference to the entry.
+		 * @param icon Pixels of the logo, keyed by its path. Decoded again from the path if they are not CellPixels wide
+		 * @return Brush painting the logo in a CellSize x CellSize area
+		*/
+		winrt::Microsoft::UI::Xaml::Media::Brush Acquire(const IconPixels& icon);
+		/**
+		 * @brief Releases a reference to a logo. The cell of a logo without references is freed and the pages are compacted.
+		*/
+		void Release(const std::wstring& path);
+		/**
+		 * @brief Paths of the logos in the atlas.
+		*/
+		std::vector<std::wstring> Paths() const;
+		IconAtlasStatistics Statistics() const;
+
+	private:
+		struct Page
+		{
+			winrt::Microsoft::UI::Xaml::Media::Imaging::WriteableBitmap bitmap{ nullptr };
+			uint8_t* pixels = nullptr;
+			/**
+			 * @brief Path of the logo in each cell, empty for free cells.
+			*/
+			std::vector<std::wstring> cells{};
+			uint32_t used = 0;
+		};
+
+		struct Entry
+		{
+			size_t page = 0;
+			uint32_t cell = 0;
+			uint32_t references = 0;
+			winrt::Microsoft::UI::Xaml::Media::ImageBrush brush{ nullptr };
+		};
+
+		double scale = 1.;
+		uint32_t cellPixels = static_cast<uint32_t>(CellSize);
+		std::vector<Page> pages{};
+		std::unordered_map<std::wstring, Entry> entries{};
+		std::vector<uint8_t> decodeBuffer{};
+
+		/**
+		 * @brief Adds an entry for a logo, with one reference, and copies its pixels (CellPixels x CellPixels, tightly packed) to a free cell.
+		*/
+		winrt::Microsoft::UI::Xaml::Media::Brush Insert(const std::wstring& path, const uint8_t* pixels);
+		/**
+		 * @brief Finds a free cell, adding a page if every page is full.
+		*/
+		void AllocateCell(size_t& page, uint32_t& cell);
+		/**
+		 * @brief Writes pixels (CellPixels x CellPixels, tightly packed) to a cell.
+		*/
+		void WriteCell(const size_t& page, const uint32_t& cell, const uint8_t* pixels, const uint32_t& stride);
+		/**
+		 * @brief Points the brush of an entry to its cell.
+		*/
+		void BindBrush(Entry& entry);
+		/**
+		 * @brief Moves the logos of the last page to the free cells of the other pages and drops it, while they fit.
+		*/
+		void Compact();
+	};
+}
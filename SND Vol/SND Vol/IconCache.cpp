@@ -0,0 +1,365 @@
+#include "pch.h"
+#include "IconCache.h"
+
+#include <cwctype>
+#include "IconHelper.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace winrt;
+
+
+namespace Imaging
+{
+	IconCache& IconCache::Current()
+	{
+		static IconCache cache{};
+		return cache;
+	}
+
+	IconCache::~IconCache()
+	{
+		{
+			unique_lock lock{ pendingMutex };
+			writerRunning = false;
+		}
+		pendingCondition.notify_all();
+
+		// The writer empties the queue before exiting.
+		if (writerThread)
+		{
+			writerThread->join();
+			delete writerThread;
+			writerThread = nullptr;
+		}
+
+		CloseIndex();
+	}
+
+
+	wstring IconCache::GetIconPath(const wstring& modulePath, const int32_t& iconIndex, const uint32_t& iconSize)
+	{
+		TRACE_SPAN(L"IconCache::GetIconPath", GUID{}, 0);
+
+		WIN32_FILE_ATTRIBUTE_DATA attributes{};
+		if (modulePath.empty() || !GetFileAttributesEx(modulePath.c_str(), GetFileExInfoStandard, &attributes))
+		{
+			return wstring();
+		}
+
+		uint64_t lastWriteTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+		uint64_t fileSize = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		uint64_t keyHash = HashKey(modulePath, iconIndex, iconSize);
+
+		{
+			unique_lock lock{ indexMutex };
+			if (!opened)
+			{
+				opened = true;
+				if (!OpenIndex())
+				{
+					OutputDebugHString(L"Icon cache: failed to map the index, icons will be extracted on each request.");
+				}
+			}
+
+			IndexRecord* record = FindRecord(keyHash);
+			if (record && record->keyHash == keyHash &&
+				record->lastWriteTime == lastWriteTime && record->fileSize == fileSize &&
+				record->iconIndex == iconIndex && record->iconSize == iconSize)
+			{
+				hits.fetch_add(1, memory_order_relaxed);
+				return IconFilePath(keyHash);
+			}
+		}
+
+		wstring filePath = IconFilePath(keyHash);
+		if (folderPath.empty())
+		{
+			return wstring();
+		}
+
+		{
+			unique_lock lock{ pendingMutex };
+			if (pendingIcons.contains(filePath))
+			{
+				// Extracted by another request, the pixels are read from the pending icon until its file is written.
+				hits.fetch_add(1, memory_order_relaxed);
+				return filePath;
+			}
+		}
+
+		// Extracted without holding the locks, threads missing the same icon each extract it and the first one queues it.
+		HICON icon = nullptr;
+		{
+			TRACE_SPAN(L"IconCache::ExtractIcon", GUID{}, 0);
+			if (SHDefExtractIcon(modulePath.c_str(), iconIndex, 0, &icon, nullptr, iconSize) != S_OK || !icon)
+			{
+				return wstring();
+			}
+		}
+		extractions.fetch_add(1, memory_order_relaxed);
+
+		bool queued = false;
+		{
+			unique_lock lock{ pendingMutex };
+			if (writerRunning && !pendingIcons.contains(filePath))
+			{
+				pendingIcons.insert({ filePath, PendingIcon{ icon, modulePath, keyHash, lastWriteTime, fileSize, iconIndex, iconSize } });
+				writeQueue.push_back(filePath);
+				if (!writerThread)
+				{
+					writerThread = new thread(&IconCache::WriterFunction, this);
+				}
+				queued = true;
+			}
+		}
+
+		if (queued)
+		{
+			pendingCondition.notify_one();
+		}
+		else
+		{
+			DestroyIcon(icon);
+		}
+		return filePath;
+	}
+
+	void IconCache::CopyIconPixels(const wstring& filePath, const uint32_t& size, vector<uint8_t>& pixels)
+	{
+		IconHelper iconHelper{};
+		{
+			// The lock keeps the writer from destroying the icon while it is read.
+			unique_lock lock{ pendingMutex };
+			auto it = pendingIcons.find(filePath);
+			if (it != pendingIcons.end())
+			{
+				iconHelper.CopyPixelsFromHICON(it->second.icon, size, pixels);
+				return;
+			}
+		}
+
+		iconHelper.CopyPixelsFromFile(filePath, size, pixels);
+	}
+
+
+	bool IconCache::OpenIndex()
+	{
+		try
+		{
+			folderPath = (filesystem::path(Windows::Storage::ApplicationData::Current().LocalFolder().Path().c_str()) / L"Icons").wstring();
+		}
+		catch (const hresult_error& error)
+		{
+			OutputDebugHString(L"Icon cache: no local folder. " + error.message());
+			return false;
+		}
+
+		if (!CreateDirectory(folderPath.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+		{
+			folderPath.clear();
+			return false;
+		}
+
+		wstring indexPath = (filesystem::path(folderPath) / L"index.bin").wstring();
+		indexFile = CreateFile(indexPath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (indexFile == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		constexpr uint64_t indexSize = sizeof(IndexHeader) + static_cast<uint64_t>(IndexCapacity) * sizeof(IndexRecord);
+		LARGE_INTEGER fileSize{};
+		bool reset = !GetFileSizeEx(indexFile, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) != indexSize;
+
+		// The mapping extends the file to the size of the index, new pages are zeroed (empty slots).
+		indexMapping = CreateFileMapping(indexFile, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(indexSize), nullptr);
+		if (!indexMapping)
+		{
+			CloseIndex();
+			return false;
+		}
+
+		void* view = MapViewOfFile(indexMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(indexSize));
+		if (!view)
+		{
+			CloseIndex();
+			return false;
+		}
+
+		header = static_cast<IndexHeader*>(view);
+		records = reinterpret_cast<IndexRecord*>(static_cast<char*>(view) + sizeof(IndexHeader));
+
+		if (reset || header->magic != IndexMagic || header->version != IndexVersion || header->capacity != IndexCapacity)
+		{
+			// New, truncated or older index: the PNG files left in the folder are overwritten as the icons are extracted again.
+			memset(view, 0, static_cast<size_t>(indexSize));
+			header->magic = IndexMagic;
+			header->version = IndexVersion;
+			header->capacity = IndexCapacity;
+		}
+
+		return true;
+	}
+
+	void IconCache::CloseIndex()
+	{
+		if (header)
+		{
+			FlushViewOfFile(header, 0);
+			UnmapViewOfFile(header);
+			header = nullptr;
+			records = nullptr;
+		}
+		if (indexMapping)
+		{
+			CloseHandle(indexMapping);
+			indexMapping = nullptr;
+		}
+		if (indexFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(indexFile);
+			indexFile = INVALID_HANDLE_VALUE;
+		}
+	}
+
+	IconCache::IndexRecord* IconCache::FindRecord(const uint64_t& keyHash)
+	{
+		if (!records)
+		{
+			return nullptr;
+		}
+
+		// Linear probing. Records are never removed (a changed module overwrites its record), so probing stops at the first empty slot.
+		uint32_t start = static_cast<uint32_t>(keyHash % IndexCapacity);
+		for (uint32_t i = 0; i < IndexCapacity; i++)
+		{
+			IndexRecord& record = records[(start + i) % IndexCapacity];
+			if (record.keyHash == keyHash)
+			{
+				return &record;
+			}
+			if (record.keyHash == 0)
+			{
+				// Keeps probe sequences short, the remaining icons are extracted on each request.
+				return header->count < IndexCapacity / 4 * 3 ? &record : nullptr;
+			}
+		}
+		return nullptr;
+	}
+
+	wstring IconCache::IconFilePath(const uint64_t& keyHash) const
+	{
+		wchar_t fileName[24]{};
+		swprintf_s(fileName, L"%016llx.png", static_cast<unsigned long long>(keyHash));
+		return (filesystem::path(folderPath) / fileName).wstring();
+	}
+
+
+	void IconCache::WriterFunction()
+	{
+		// WIC encoder.
+		bool uninitialize = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+		while (true)
+		{
+			PendingIcon pendingIcon{};
+			wstring filePath{};
+			{
+				unique_lock lock{ pendingMutex };
+				pendingCondition.wait(lock, [this]()
+				{
+					return !writerRunning || !writeQueue.empty();
+				});
+
+				if (writeQueue.empty())
+				{
+					break;
+				}
+
+				filePath = move(writeQueue.front());
+				writeQueue.pop_front();
+				// Copied, the entry stays in pendingIcons (and the icon alive) while the file is written.
+				pendingIcon = pendingIcons.at(filePath);
+			}
+
+			if (WriteIconToFile(pendingIcon.icon, pendingIcon.modulePath, filePath))
+			{
+				unique_lock lock{ indexMutex };
+				IndexRecord* record = FindRecord(pendingIcon.keyHash);
+				if (record)
+				{
+					if (record->keyHash == 0)
+					{
+						header->count++;
+					}
+					record->lastWriteTime = pendingIcon.lastWriteTime;
+					record->fileSize = pendingIcon.fileSize;
+					record->iconIndex = pendingIcon.iconIndex;
+					record->iconSize = pendingIcon.iconSize;
+					record->keyHash = pendingIcon.keyHash;
+				}
+			}
+
+			{
+				unique_lock lock{ pendingMutex };
+				pendingIcons.erase(filePath);
+			}
+			DestroyIcon(pendingIcon.icon);
+		}
+
+		if (uninitialize)
+		{
+			CoUninitialize();
+		}
+	}
+
+
+	uint64_t IconCache::HashKey(const wstring& modulePath, const int32_t& iconIndex, const uint32_t& iconSize)
+	{
+		// FNV-1a over the case folded path, the index and the size.
+		uint64_t hash = 0xcbf29ce484222325ull;
+		auto add = [&hash](const uint64_t& value, const size_t& bytes)
+		{
+			for (size_t i = 0; i < bytes; i++)
+			{
+				hash ^= (value >> (i * 8)) & 0xff;
+				hash *= 0x100000001b3ull;
+			}
+		};
+
+		for (const wchar_t& c : modulePath)
+		{
+			add(static_cast<uint64_t>(towlower(c)), sizeof(wchar_t));
+		}
+		add(static_cast<uint32_t>(iconIndex), sizeof(iconIndex));
+		add(iconSize, sizeof(iconSize));
+
+		// 0 marks empty slots.
+		return hash != 0 ? hash : 1;
+	}
+
+	bool IconCache::WriteIconToFile(const HICON& icon, const wstring& modulePath, const wstring& filePath)
+	{
+		TRACE_SPAN(L"IconCache::WriteIconToFile", GUID{}, 0);
+
+		bool success = false;
+		wstring temporaryPath = filePath + L"." + to_wstring(GetCurrentThreadId()) + L".tmp";
+		try
+		{
+			IconHelper iconHelper{};
+			iconHelper.WriteHICONToFile(icon, temporaryPath);
+			success = MoveFileEx(temporaryPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+		}
+		catch (const hresult_error& error)
+		{
+			OutputDebugHString(L"Icon cache: failed to write icon of '" + hstring(modulePath) + L"'. " + error.message());
+		}
+
+		if (!success)
+		{
+			DeleteFile(temporaryPath.c_str());
+		}
+		return success;
+	}
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Imaging
+{
+	/**
+	 * @brief Cache of icons extracted from executables, stored as PNG files in the application local folder. Icons are keyed by module path,
+	 * icon index, icon size and module last write time, the index of the cached icons is a memory mapped open addressing table so that known
+	 * icons are found without opening or decoding any file. Extracted icons are written to their PNG file by a writer thread, until then their
+	 * pixels are read from the extracted icon (CopyIconPixels). Thread safe.
+	*/
+	class IconCache
+	{
+	public:
+		/**
+		 * @brief Size of the icons extracted for audio session views, in pixels.
+		*/
+		static constexpr uint32_t DefaultIconSize = 64;
+
+		static IconCache& Current();
+
+		~IconCache();
+
+		/**
+		 * @brief Gets the PNG file of an icon, extracting the icon the first time it is requested or when the module changed. The file of an
+		 * icon just extracted is written in the background, see CopyIconPixels.
+		 * @param modulePath Path of the executable or DLL containing the icon
+		 * @param iconIndex Index of the icon in the module
+		 * @param iconSize Width and height of the icon, in pixels
+		 * @return Path of the PNG file, empty if the module has no icon
+		*/
+		std::wstring GetIconPath(const std::wstring& modulePath, const int32_t& iconIndex = 0, const uint32_t& iconSize = DefaultIconSize);
+		/**
+		 * @brief Decodes an image to a square, see IconHelper::CopyPixelsFromFile. The pixels of an icon whose PNG file is still waiting to be
+		 * written are converted straight from the extracted icon.
+		 * @param filePath Path of the image, returned by GetIconPath or any other image (package logos)
+		 * @param size Width and height of the pixels
+		 * @param pixels Receives the pixels. Throws if the image cannot be decoded
+		*/
+		void CopyIconPixels(const std::wstring& filePath, const uint32_t& size, std::vector<uint8_t>& pixels);
+
+		inline uint64_t Hits() const
+		{
+			return hits.load(std::memory_order_relaxed);
+		};
+
+		inline uint64_t Extractions() const
+		{
+			return extractions.load(std::memory_order_relaxed);
+		};
+
+	private:
+		struct IndexHeader
+		{
+			uint32_t magic = 0;
+			uint32_t version = 0;
+			uint32_t capacity = 0;
+			uint32_t count = 0;
+		};
+
+		/**
+		 * @brief Slot of the index. A key hash of 0 marks an empty slot.
+		*/
+		struct IndexRecord
+		{
+			uint64_t keyHash = 0;
+			uint64_t lastWriteTime = 0;
+			uint64_t fileSize = 0;
+			int32_t iconIndex = 0;
+			uint32_t iconSize = 0;
+		};
+
+		/**
+		 * @brief Icon extracted and waiting for its PNG file to be written.
+		*/
+		struct PendingIcon
+		{
+			HICON icon = nullptr;
+			std::wstring modulePath{};
+			uint64_t keyHash = 0;
+			uint64_t lastWriteTime = 0;
+			uint64_t fileSize = 0;
+			int32_t iconIndex = 0;
+			uint32_t iconSize = 0;
+		};
+
+		static constexpr uint32_t IndexMagic = 0x49435653; // "SVCI"
+		static constexpr uint32_t IndexVersion = 1;
+		static constexpr uint32_t IndexCapacity = 1024;
+
+		std::mutex indexMutex{};
+		std::wstring folderPath{};
+		HANDLE indexFile = INVALID_HANDLE_VALUE;
+		HANDLE indexMapping = nullptr;
+		IndexHeader* header = nullptr;
+		IndexRecord* records = nullptr;
+		bool opened = false;
+		std::atomic<uint64_t> hits = 0;
+		std::atomic<uint64_t> extractions = 0;
+		std::thread* writerThread = nullptr;
+		std::mutex pendingMutex{};
+		std::condition_variable pendingCondition{};
+		/**
+		 * @brief File path -> icon waiting to be written. Icons are destroyed under pendingMutex once their file has been written.
+		*/
+		std::unordered_map<std::wstring, PendingIcon> pendingIcons{};
+		/**
+		 * @brief File paths of the pending icons, in extraction order.
+		*/
+		std::deque<std::wstring> writeQueue{};
+		bool writerRunning = true;
+
+		/**
+		 * @brief Maps the index file, creating or resetting it when it does not exist or is not valid. Caller holds indexMutex.
+		 * @return False if the index could not be mapped, icons are then extracted on every request
+		*/
+		bool OpenIndex();
+		void CloseIndex();
+		/**
+		 * @brief Finds the slot of a key, or the empty slot it would be inserted in. Caller holds indexMutex.
+		 * @return Slot, null if the key is not in the index and the index is full
+		*/
+		IndexRecord* FindRecord(const uint64_t& keyHash);
+		std::wstring IconFilePath(const uint64_t& keyHash) const;
+
+		/**
+		 * @brief Writes the pending icons to their PNG file and adds them to the index. Started with the first extraction.
+		*/
+		void WriterFunction();
+
+		static uint64_t HashKey(const std::wstring& modulePath, const int32_t& iconIndex, const uint32_t& iconSize);
+		/**
+		 * @brief Writes an icon to a PNG file, through a temporary file so that readers never see a partial file.
+		 * @return True if the file has been written
+		*/
+		static bool WriteIconToFile(const HICON& icon, const std::wstring& modulePath, const std::wstring& filePath);
+	};
+}
@@ -13,11 +13,8 @@ namespace Imaging
 {
 	void IconHelper::WriteHICONToFile(const HICON& hIcon, const std::filesystem::path& filePath)
 	{
-		// Create factory.
 		com_ptr<IWICImagingFactory> wicImagingFactory{};
-		check_hresult(
-			CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicImagingFactory))
-		);
+		wicImagingFactory.copy_from(ImagingFactory());
 
 		// Get bitmap and bitmap source from HICON.
 		com_ptr<IWICBitmap> wicBitmap{};
@@ -121,11 +118,8 @@ namespace Imaging
 
 	IStream* IconHelper::ExtractStreamFromHICON(const HICON& hIcon)
 	{
-		// Create factory.
 		com_ptr<IWICImagingFactory> wicImagingFactory{};
-		check_hresult(
-			CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicImagingFactory))
-		);
+		wicImagingFactory.copy_from(ImagingFactory());
 
 		// Get bitmap and bitmap source from HICON.
 		com_ptr<IWICBitmap> wicBitmap{};
@@ -138,6 +132,113 @@ namespace Imaging
 		return bitmapStream;
 	}
 
+	void IconHelper::CopyPixelsFromHICON(const HICON& hIcon, const uint32_t& size, vector<uint8_t>& pixels)
+	{
+		IWICImagingFactory* imagingFactory = ImagingFactory();
+
+		com_ptr<IWICBitmap> wicBitmap{};
+		check_hresult(imagingFactory->CreateBitmapFromHICON(hIcon, wicBitmap.put()));
+
+		CopyScaledPixels(imagingFactory, wicBitmap.get(), size, pixels);
+	}
+
+	void IconHelper::CopyPixelsFromFile(const wstring& filePath, const uint32_t& size, vector<uint8_t>& pixels)
+	{
+		IWICImagingFactory* imagingFactory = ImagingFactory();
+
+		com_ptr<IWICBitmapDecoder> decoder{};
+		check_hresult(imagingFactory->CreateDecoderFromFilename(filePath.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.put()));
+		com_ptr<IWICBitmapFrameDecode> frame{};
+		check_hresult(decoder->GetFrame(0, frame.put()));
+
+		CopyScaledPixels(imagingFactory, frame.get(), size, pixels);
+	}
+
+	wstring IconHelper::BenchmarkHICONConversion(const HICON& hIcon, const uint32_t& iterations)
+	{
+		uint32_t width = 0, height = 0;
+		vector<uint8_t> pixels{};
+
+		// Previous path: factory per call, BMP encoded to an HGLOBAL stream, then decoded again by the consumer.
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			com_ptr<IWICImagingFactory> wicImagingFactory{};
+			check_hresult(
+				CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicImagingFactory))
+			);
+			com_ptr<IWICBitmap> wicBitmap{};
+			check_hresult(wicImagingFactory->CreateBitmapFromHICON(hIcon, wicBitmap.put()));
+
+			com_ptr<IStream> bitmapStream{};
+			bitmapStream.attach(GetBitmapSourceStream(wicImagingFactory.get(), wicBitmap.get(), GUID_ContainerFormatBmp));
+
+			com_ptr<IWICBitmapDecoder> decoder{};
+			check_hresult(wicImagingFactory->CreateDecoderFromStream(bitmapStream.get(), nullptr, WICDecodeMetadataCacheOnDemand, decoder.put()));
+			com_ptr<IWICBitmapFrameDecode> frame{};
+			check_hresult(decoder->GetFrame(0, frame.put()));
+			check_hresult(frame->GetSize(&width, &height));
+			pixels.resize(static_cast<size_t>(width) * height * 4);
+			check_hresult(frame->CopyPixels(nullptr, width * 4, static_cast<uint32_t>(pixels.size()), pixels.data()));
+		}
+		double roundTripSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		// Direct path: thread factory, pixels converted and scaled by WIC into the buffer handed to the icon atlas.
+		start = chrono::steady_clock::now();
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			CopyPixelsFromHICON(hIcon, width, pixels);
+		}
+		double directSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		auto iconsPerSecond = [&iterations](const double& seconds)
+		{
+			return seconds > 0. ? static_cast<uint64_t>(static_cast<double>(iterations) / seconds) : 0ull;
+		};
+		return L"HICON conversion (" + to_wstring(width) + L"x" + to_wstring(height) + L", " + to_wstring(iterations) + L" icons): BMP round trip " +
+			to_wstring(iconsPerSecond(roundTripSeconds)) + L" icons/s, direct pixels " + to_wstring(iconsPerSecond(directSeconds)) + L" icons/s";
+	}
+
+
+	IWICImagingFactory* IconHelper::ImagingFactory()
+	{
+		// WIC factories are free threaded, one per thread still avoids any contention and the CoCreateInstance on each conversion.
+		thread_local com_ptr<IWICImagingFactory> imagingFactory{};
+		if (!imagingFactory)
+		{
+			check_hresult(
+				CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(imagingFactory.put()))
+			);
+		}
+		return imagingFactory.get();
+	}
+
+	void IconHelper::CopyScaledPixels(IWICImagingFactory* imagingFactory, IWICBitmapSource* bitmapSource, const uint32_t& size, vector<uint8_t>& pixels)
+	{
+		uint32_t width = 0, height = 0;
+		check_hresult(bitmapSource->GetSize(&width, &height));
+		check_bool(width > 0 && height > 0);
+
+		// Uniform fit, the longest side takes the whole square.
+		uint32_t scaledWidth = width >= height ? size : static_cast<uint32_t>(static_cast<uint64_t>(size) * width / height);
+		uint32_t scaledHeight = height >= width ? size : static_cast<uint32_t>(static_cast<uint64_t>(size) * height / width);
+		scaledWidth = scaledWidth > 0 ? scaledWidth : 1;
+		scaledHeight = scaledHeight > 0 ? scaledHeight : 1;
+
+		com_ptr<IWICBitmapScaler> scaler{};
+		check_hresult(imagingFactory->CreateBitmapScaler(scaler.put()));
+		check_hresult(scaler->Initialize(bitmapSource, scaledWidth, scaledHeight, WICBitmapInterpolationModeHighQualityCubic));
+
+		com_ptr<IWICBitmapSource> convertedSource{};
+		convertedSource.attach(ConvertBitmapPixelFormat(imagingFactory, scaler.get(), GUID_WICPixelFormat32bppPBGRA, WICBitmapDitherTypeNone));
+
+		pixels.assign(static_cast<size_t>(size) * size * 4, 0);
+		size_t offset = (static_cast<size_t>(size - scaledHeight) / 2 * size + (size - scaledWidth) / 2) * 4;
+		check_hresult(
+			convertedSource->CopyPixels(nullptr, size * 4, static_cast<uint32_t>(pixels.size() - offset), pixels.data() + offset)
+		);
+	}
+
 
 	void IconHelper::SaveImage(IWICImagingFactory* imagingFactory, IWICBitmapSource* bitmapSource, const GUID& containerFormatGUID, IStream* hIconStream)
 	{
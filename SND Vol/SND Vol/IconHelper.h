@@ -1,8 +1,29 @@
 #pragma once
+#include <string>
+#include <vector>
 #include <wincodec.h>
 
 namespace Imaging
 {
+	/**
+	 * @brief Square image decoded as premultiplied BGRA8 away from the UI thread, ready to be copied to the icon atlas.
+	*/
+	struct IconPixels
+	{
+		/**
+		 * @brief Path of the image, key of the image in the icon atlas.
+		*/
+		std::wstring path{};
+		/**
+		 * @brief Width and height, in pixels.
+		*/
+		uint32_t size = 0;
+		/**
+		 * @brief size * size * 4 bytes, rows are tightly packed.
+		*/
+		std::vector<uint8_t> pixels{};
+	};
+
 	class IconHelper
 	{
 	public:
@@ -14,10 +35,42 @@ namespace Imaging
 		void WriteHICONToFile(const HICON& hIcon, const std::filesystem::path& filePath);
 		HICON LoadIconFromPath(const std::wstring_view& resourcePath);
 		IStream* ExtractStreamFromHICON(const HICON& hIcon);
+		/**
+		 * @brief Converts the given HICON to premultiplied BGRA8, scaled to fit a square and centered in it. The pixels are converted and
+		 * scaled by WIC straight into the buffer, without encoding them to an intermediate stream.
+		 * @param hIcon HICON representing the bitmap/image
+		 * @param size Width and height of the square, in pixels
+		 * @param pixels Receives the pixels, size * size * 4 bytes, rows are tightly packed
+		*/
+		void CopyPixelsFromHICON(const HICON& hIcon, const uint32_t& size, std::vector<uint8_t>& pixels);
+		/**
+		 * @brief Decodes an image file as premultiplied BGRA8, scaled to fit a square and centered in it.
+		 * @param filePath Path of the image
+		 * @param size Width and height of the square, in pixels
+		 * @param pixels Receives the pixels, size * size * 4 bytes, rows are tightly packed
+		*/
+		void CopyPixelsFromFile(const std::wstring& filePath, const uint32_t& size, std::vector<uint8_t>& pixels);
+		/**
+		 * @brief Measures how many icons per second are converted by the BMP encode/decode round trip (new factory, encode, decode), and by
+		 * CopyPixelsFromHICON.
+		 * @param hIcon Icon to convert
+		 * @param iterations Conversions per path
+		 * @return Report
+		*/
+		std::wstring BenchmarkHICONConversion(const HICON& hIcon, const uint32_t& iterations);
 
 	private:
 		const double upscaleRatio = 1.5;
 
+		/**
+		 * @brief WIC factory of the calling thread, created on first use and kept for the lifetime of the thread.
+		*/
+		static IWICImagingFactory* ImagingFactory();
+		/**
+		 * @brief Scales a bitmap source to fit a square and copies it, centered, as premultiplied BGRA8.
+		*/
+		void CopyScaledPixels(IWICImagingFactory* imagingFactory, IWICBitmapSource* bitmapSource, const uint32_t& size, std::vector<uint8_t>& pixels);
+
 		void SaveImage(IWICImagingFactory* imagingFactory, IWICBitmapSource* bitmapSource, const GUID& containerFormatGUID, IStream* hIconStream);
 		IStream* GetBitmapSourceStream(IWICImagingFactory* imagingFactory, IWICBitmapSource* bitmapSource, const GUID& containerFormatGUID);
 		void AddFrameToWICBitmap(IWICImagingFactory* imagingFactory, IWICBitmapSource* bitmapSource, IWICBitmapEncoder* bitmapEncoder);
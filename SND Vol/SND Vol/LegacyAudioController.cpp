@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "LegacyAudioController.h"
 
+#include <ppl.h>
+#include "Trace.h"
+
 using namespace std;
 using namespace winrt;
 
@@ -10,16 +13,54 @@ namespace Audio
     LegacyAudioController::LegacyAudioController(GUID const& guid) :
         audioSessionID(guid)
     {
-        IMMDevicePtr pDevice;
+        check_hresult(CoIncrementMTAUsage(&mtaUsageCookie));
 
         // Create the device enumerator.
         check_hresult(CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL, IID_PPV_ARGS(&deviceEnumerator)));
-        // Get the default audio device.
-        check_hresult(deviceEnumerator->GetDefaultAudioEndpoint(eRender, eMultimedia, &pDevice));
-        // Get the session manager.
-        check_hresult(pDevice->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, NULL, (void**)&audioSessionManager));
-        // Get session enumerator
-        check_hresult(audioSessionManager->GetSessionEnumerator(&audioSessionEnumerator));
+
+        // Every active render and capture endpoint.
+        IMMDeviceCollectionPtr deviceCollection{ nullptr };
+        check_hresult(deviceEnumerator->EnumAudioEndpoints(EDataFlow::eAll, DEVICE_STATE_ACTIVE, &deviceCollection));
+        UINT deviceCount = 0;
+        check_hresult(deviceCollection->GetCount(&deviceCount));
+
+        vector<IMMDevicePtr> devices(deviceCount);
+        for (UINT i = 0; i < deviceCount; i++)
+        {
+            check_hresult(deviceCollection->Item(i, &devices[i]));
+        }
+        OpenEndpoints(devices);
+
+        endpointsThread = new thread(&LegacyAudioController::EndpointsThreadFunction, this);
+    }
+
+    LegacyAudioController::~LegacyAudioController()
+    {
+        {
+            unique_lock lock{ deviceChangesMutex };
+            endpointsThreadRunning = false;
+        }
+        deviceChangesCondition.notify_all();
+        if (endpointsThread)
+        {
+            endpointsThread->join();
+            delete endpointsThread;
+            endpointsThread = nullptr;
+        }
+
+        metadataResolver.Stop();
+
+        for (auto& [deviceId, endpoint] : endpoints)
+        {
+            endpoint->Unregister();
+            endpoint->Release();
+        }
+        endpoints.clear();
+
+        if (mtaUsageCookie)
+        {
+            CoDecrementMTAUsage(mtaUsageCookie);
+        }
     }
 
 
@@ -40,16 +81,35 @@ namespace Audio
     {
         if (!isRegistered)
         {
-            isRegistered = 
-                SUCCEEDED(audioSessionManager->RegisterSessionNotification(this)) && 
-                SUCCEEDED(deviceEnumerator->RegisterEndpointNotificationCallback(this));
+            if (FAILED(deviceEnumerator->RegisterEndpointNotificationCallback(this)))
+            {
+                return false;
+            }
+
+            isRegistered = true;
+            for (AudioEndpointContext* endpoint : AcquireEndpoints())
+            {
+                if (!endpoint->Register())
+                {
+                    OutputDebugHString(L"Failed to register audio endpoint '" + hstring(endpoint->DeviceId()) + L"'.");
+                }
+                endpoint->Release();
+            }
         }
         return isRegistered;
     }
 
     bool LegacyAudioController::Unregister()
     {
-        return SUCCEEDED(audioSessionManager->UnregisterSessionNotification(this)) && SUCCEEDED(deviceEnumerator->UnregisterEndpointNotificationCallback(this));
+        isRegistered = false;
+
+        bool unregistered = SUCCEEDED(deviceEnumerator->UnregisterEndpointNotificationCallback(this));
+        for (AudioEndpointContext* endpoint : AcquireEndpoints())
+        {
+            unregistered &= endpoint->Unregister();
+            endpoint->Release();
+        }
+        return unregistered;
     }
 
     #pragma region IUnknown
@@ -74,12 +134,7 @@ namespace Audio
     {
         if (riid == IID_IUnknown)
         {
-            *ppvInterface = static_cast<IUnknown*>(static_cast<IAudioSessionNotification*>(this));
-            AddRef();
-        }
-        else if (riid == __uuidof(IAudioSessionNotification))
-        {
-            *ppvInterface = static_cast<IAudioSessionNotification*>(this);
+            *ppvInterface = static_cast<IUnknown*>(static_cast<IMMNotificationClient*>(this));
             AddRef();
         }
         else if (riid == __uuidof(IMMNotificationClient))
@@ -98,38 +153,84 @@ namespace Audio
 
     vector<AudioSession*>* LegacyAudioController::GetSessions()
     {
+        TRACE_SPAN(L"LegacyAudioController::GetSessions");
         vector<AudioSession*>* sessions = new vector<AudioSession*>();
-        int sessionCount;
-        if (SUCCEEDED(audioSessionEnumerator->GetCount(&sessionCount)))
+        for (AudioEndpointContext* endpoint : AcquireEndpoints())
         {
-            for (int i = 0; i < sessionCount; i++)
+            try
             {
-                IAudioSessionControlPtr control;
-                IAudioSessionControl2* control2 = nullptr;
-
-                if (SUCCEEDED(audioSessionEnumerator->GetSession(i, &control)) &&
-                    SUCCEEDED(control->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&control2)))
-                {
-                    sessions->push_back(new AudioSession(control2, audioSessionID));
-                }
+                endpoint->GetSessions(*sessions);
+            }
+            catch (const hresult_error& ex)
+            {
+                OutputDebugHString(L"Failed to enumerate the sessions of audio endpoint '" + hstring(endpoint->DeviceId()) + L"' : " + ex.message());
             }
+            endpoint->Release();
         }
 
         return sessions;
     }
 
-    AudioSession* LegacyAudioController::NewSession()
+    vector<AudioSession*> LegacyAudioController::ReconcileSessions(unordered_set<wstring>& liveInstanceIds)
     {
-        if (newSessions.empty())
+        TRACE_SPAN(L"LegacyAudioController::ReconcileSessions");
+        vector<AudioSession*> sessions{};
+
+        vector<AudioEndpointContext*> openEndpoints = AcquireEndpoints();
+        vector<AudioEndpointContext*> failedEndpoints{};
+        for (AudioEndpointContext* endpoint : openEndpoints)
         {
-            return nullptr;
+            try
+            {
+                endpoint->ReconcileSessions(liveInstanceIds, sessions);
+            }
+            catch (const hresult_error& ex)
+            {
+                failedEndpoints.push_back(endpoint);
+                OutputDebugHString(L"Failed to enumerate the sessions of audio endpoint '" + hstring(endpoint->DeviceId()) + L"' : " + ex.message());
+            }
         }
-        else
+
+        // A failed enumeration says nothing about the sessions of the endpoint: they are kept as live instead of being reported gone.
+        if (!failedEndpoints.empty())
+        {
+            for (auto it = liveInstanceIds.begin(); it != liveInstanceIds.end();)
+            {
+                bool owned = false;
+                for (AudioEndpointContext* endpoint : failedEndpoints)
+                {
+                    owned = owned || endpoint->OwnsSession(*it);
+                }
+                it = owned ? liveInstanceIds.erase(it) : ++it;
+            }
+        }
+
+        // The caller removes the sessions that are gone, they can be created again.
+        for (AudioEndpointContext* endpoint : openEndpoints)
         {
-            AudioSession* ptr = newSessions.top();
-            newSessions.pop();
-            return ptr;
+            for (const wstring& instanceId : liveInstanceIds)
+            {
+                endpoint->ForgetSession(instanceId);
+            }
+            endpoint->Release();
         }
+
+        return sessions;
+    }
+
+    size_t LegacyAudioController::NewSessions(vector<AudioSession*>& sessions)
+    {
+        return newSessions.Drain(sessions);
+    }
+
+    void LegacyAudioController::ResolveMetadata(const vector<AudioSession*>& sessions)
+    {
+        metadataResolver.Enqueue(sessions);
+    }
+
+    void LegacyAudioController::AddSyntheticSession(IAudioSessionControl2* control)
+    {
+        SessionCreated(new AudioSession(control, audioSessionID));
     }
 
     MainAudioEndpoint* LegacyAudioController::GetMainAudioEndpoint()
@@ -141,66 +242,231 @@ namespace Audio
     }
 
 
-    STDMETHODIMP LegacyAudioController::OnSessionCreated(IAudioSessionControl* NewSession)
+    void LegacyAudioController::OpenEndpoints(const vector<IMMDevicePtr>& devices)
+    {
+        TRACE_SPAN(L"LegacyAudioController::OpenEndpoints");
+
+        // Activating the session manager of an endpoint is a cross-process call that can take a while (Bluetooth devices), the endpoints are
+        // opened in parallel.
+        vector<AudioEndpointContext*> openedEndpoints(devices.size(), nullptr);
+        concurrency::parallel_for(static_cast<size_t>(0), devices.size(), [&](size_t i)
+        {
+            bool uninitialize = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+            try
+            {
+                openedEndpoints[i] = new AudioEndpointContext(devices[i], audioSessionID, [this](AudioSession* session)
+                {
+                    SessionCreated(session);
+                });
+            }
+            catch (const hresult_error& ex)
+            {
+                OutputDebugHString(L"Failed to open audio endpoint : " + ex.message());
+            }
+
+            if (uninitialize)
+            {
+                CoUninitialize();
+            }
+        });
+
+        for (AudioEndpointContext* endpoint : openedEndpoints)
+        {
+            if (endpoint)
+            {
+                AddEndpoint(endpoint);
+            }
+        }
+    }
+
+    bool LegacyAudioController::AddEndpoint(AudioEndpointContext* endpoint)
+    {
+        {
+            unique_lock lock{ endpointsMutex };
+            if (!endpoints.insert({ wstring(endpoint->DeviceId()), endpoint }).second)
+            {
+                lock.unlock();
+                endpoint->Release();
+                return false;
+            }
+        }
+
+        if (isRegistered && !endpoint->Register())
+        {
+            OutputDebugHString(L"Failed to register audio endpoint '" + hstring(endpoint->DeviceId()) + L"'.");
+        }
+        return true;
+    }
+
+    bool LegacyAudioController::AddEndpoint(const wstring& deviceId)
+    {
+        {
+            // OnDeviceAdded and OnDeviceStateChanged can both notify a device, it is only activated once.
+            unique_lock lock{ endpointsMutex };
+            if (endpoints.contains(deviceId))
+            {
+                return false;
+            }
+        }
+
+        IMMDevicePtr device{ nullptr };
+        DWORD state = 0;
+        if (FAILED(deviceEnumerator->GetDevice(deviceId.c_str(), &device)) || FAILED(device->GetState(&state)) || state != DEVICE_STATE_ACTIVE)
+        {
+            return false;
+        }
+
+        return AddEndpoint(new AudioEndpointContext(device, audioSessionID, [this](AudioSession* session)
+        {
+            SessionCreated(session);
+        }));
+    }
+
+    bool LegacyAudioController::RemoveEndpoint(const wstring& deviceId)
+    {
+        AudioEndpointContext* endpoint = nullptr;
+        {
+            unique_lock lock{ endpointsMutex };
+            auto it = endpoints.find(deviceId);
+            if (it == endpoints.end())
+            {
+                return false;
+            }
+            endpoint = it->second;
+            endpoints.erase(it);
+        }
+
+        endpoint->Unregister();
+        endpoint->Release();
+        return true;
+    }
+
+    vector<AudioEndpointContext*> LegacyAudioController::AcquireEndpoints()
+    {
+        unique_lock lock{ endpointsMutex };
+        vector<AudioEndpointContext*> copy{};
+        copy.reserve(endpoints.size());
+        for (auto& [deviceId, endpoint] : endpoints)
+        {
+            endpoint->AddRef();
+            copy.push_back(endpoint);
+        }
+        return copy;
+    }
+
+    void LegacyAudioController::SessionCreated(AudioSession* session)
+    {
+        // Only the first session of a batch wakes the UI up, the following ones are taken with it.
+        if (newSessions.Push(session))
+        {
+            e_sessionAdded(nullptr, nullptr);
+        }
+    }
+
+    void LegacyAudioController::QueueDeviceChange(const wstring& deviceId, const bool& open)
+    {
+        {
+            unique_lock lock{ deviceChangesMutex };
+            deviceChanges[deviceId] = open;
+        }
+        deviceChangesCondition.notify_one();
+    }
+
+    void LegacyAudioController::EndpointsThreadFunction()
     {
-        // HACK: Audio session creation notifications are sent in double. Once we receive one, we will ignore the next. This can cause non doubled events to be ignored.
-        static bool ignoreNotification = false;
+        bool uninitialize = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
 
-        if (!ignoreNotification)
+        while (true)
         {
-            IAudioSessionControl2* control2 = nullptr;
-            if (SUCCEEDED(NewSession->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&control2)))
+            unordered_map<wstring, bool> changes{};
+            {
+                unique_lock lock{ deviceChangesMutex };
+                deviceChangesCondition.wait(lock, [this]()
+                {
+                    return !endpointsThreadRunning || !deviceChanges.empty();
+                });
+
+                if (!endpointsThreadRunning)
+                {
+                    break;
+                }
+                changes.swap(deviceChanges);
+            }
+
+            // Changes notified together (a device removed with its capture and render endpoints) raise EndpointsChanged once.
+            bool changed = false;
+            for (auto& [deviceId, open] : changes)
             {
-                // TODO: Insure thread safety.
                 try
                 {
-                    // Windows sends OnSessionCreated event when disabling audio enhancements. The IAudioSessionControl received is not usable, making any calls to it's functions or properties fail.
-                    auto newAudioSession = new AudioSession(control2, audioSessionID);
-                    OutputDebugHString(L"New session created " + newAudioSession->Name());
-                    newSessions.push(newAudioSession);
-                    e_sessionAdded(nullptr, nullptr);
+                    bool endpointChanged = open ? AddEndpoint(deviceId) : RemoveEndpoint(deviceId);
+                    if (endpointChanged)
+                    {
+                        OutputDebugHString(L"Audio endpoint " + hstring(open ? L"opened" : L"closed") + L" (id: " + hstring(deviceId) + L").");
+                    }
+                    changed |= endpointChanged;
                 }
                 catch (const hresult_error& ex)
                 {
-                    OutputDebugHString(L"LegacyAudioController::OnSessionCreated failed to create audio session : " + ex.message());
+                    OutputDebugHString(L"Failed to " + hstring(open ? L"open" : L"close") + L" audio endpoint '" + hstring(deviceId) + L"' : " + ex.message());
                 }
             }
+
+            if (changed)
+            {
+                e_endpointsChanged(nullptr, nullptr);
+            }
         }
-        else
+
+        if (uninitialize)
         {
-            OutputDebugString(L"Ignoring OnSessionCreated event.");
+            CoUninitialize();
         }
-
-        ignoreNotification = !ignoreNotification;
-        return S_OK;
     }
 
-    STDMETHODIMP LegacyAudioController::OnDefaultDeviceChanged(__in EDataFlow flow, __in ERole /*role*/, __in_opt LPCWSTR pwstrDefaultDeviceId) noexcept
-    {
-        static bool notified = false;
 
-        assert(pwstrDefaultDeviceId != nullptr);
+    STDMETHODIMP LegacyAudioController::OnDefaultDeviceChanged(__in EDataFlow flow, __in ERole role, __in_opt LPCWSTR pwstrDefaultDeviceId) noexcept
+    {
+        // No default device left for this flow and role.
+        if (!pwstrDefaultDeviceId)
+        {
+            return S_OK;
+        }
 
-        wstring_view defaultDeviceId{ pwstrDefaultDeviceId };
-        if (!notified && flow == EDataFlow::eRender && 
-            (currentPwstrDefaultDeviceId.empty() || defaultDeviceId != currentPwstrDefaultDeviceId)
-        )
+        // The main audio endpoint is the multimedia render endpoint. Each role is notified separately, and notifications can be repeated.
+        wstring defaultDeviceId{ pwstrDefaultDeviceId };
+        if (flow == EDataFlow::eRender && role == ERole::eMultimedia &&
+            deviceChangeFilter.Accept(static_cast<uint32_t>(flow), static_cast<uint32_t>(role), defaultDeviceId, chrono::steady_clock::now()))
         {
-            OutputDebugHString(L"Default device changed (id: " + defaultDeviceId + L").");
-            currentPwstrDefaultDeviceId = defaultDeviceId;
+            OutputDebugHString(L"Default device changed (id: " + hstring(defaultDeviceId) + L").");
             e_endpointChanged(nullptr, nullptr);
         }
         else
         {
-            OutputDebugHString(L"Ignored notification : Default device changed (id: " + defaultDeviceId + L").");
+            OutputDebugHString(L"Ignored notification : Default device changed (id: " + hstring(defaultDeviceId) + L").");
         }
 
-        notified = !notified;
         return S_OK;
     }
 
-    STDMETHODIMP LegacyAudioController::OnDeviceStateChanged(__in LPCWSTR /*pwstrDeviceId*/, __in DWORD /*dwNewState*/) noexcept
+
+    STDMETHODIMP LegacyAudioController::OnDeviceStateChanged(__in LPCWSTR pwstrDeviceId, __in DWORD dwNewState) noexcept
+    {
+        // Only recorded, endpoints are opened and closed on the endpoints thread.
+        QueueDeviceChange(wstring(pwstrDeviceId), dwNewState == DEVICE_STATE_ACTIVE);
+        return S_OK;
+    }
+
+    STDMETHODIMP LegacyAudioController::OnDeviceAdded(__in LPCWSTR pwstrDeviceId) noexcept
+    {
+        // Added devices are not necessarily active, inactive devices are opened when OnDeviceStateChanged notifies them active.
+        QueueDeviceChange(wstring(pwstrDeviceId), true);
+        return S_OK;
+    }
+
+    STDMETHODIMP LegacyAudioController::OnDeviceRemoved(__in LPCWSTR pwstrDeviceId) noexcept
     {
+        QueueDeviceChange(wstring(pwstrDeviceId), false);
         return S_OK;
     }
-}
\ No newline at end of file
+}
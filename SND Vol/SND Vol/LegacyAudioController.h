@@ -1,20 +1,28 @@
 #pragma once
 
-#include <stack>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include "IComEventImplementation.h"
+#include "AudioEndpointContext.h"
 #include "AudioSession.h"
 #include "MainAudioEndpoint.h"
+#include "MpscQueue.h"
+#include "NotificationFilters.h"
+#include "SessionMetadataResolver.h"
 
 namespace Audio
 {
-    class LegacyAudioController : public IComEventImplementation, private IAudioSessionNotification, private IMMNotificationClient
+    class LegacyAudioController : public IComEventImplementation, private IMMNotificationClient
     {
     public:
         /// <summary>
-        /// Constructor.
+        /// Constructor. Opens every active render and capture endpoint.
         /// </summary>
         /// <param name="guid">GUID to give audio sessions to ignore audio events</param>
         LegacyAudioController(GUID const& guid);
+        ~LegacyAudioController();
 
         inline winrt::event_token EndpointChanged(const winrt::Windows::Foundation::TypedEventHandler<winrt::Windows::Foundation::IInspectable, winrt::Windows::Foundation::IInspectable>& handler)
         {
@@ -24,6 +32,20 @@ namespace Audio
         {
             return e_endpointChanged.remove(token);
         };
+        /**
+         * @brief Raised on the endpoints thread when endpoints have been opened or closed (device added, removed, enabled or disabled).
+        */
+        inline winrt::event_token EndpointsChanged(const winrt::Windows::Foundation::EventHandler<winrt::Windows::Foundation::IInspectable>& handler)
+        {
+            return e_endpointsChanged.add(handler);
+        };
+        inline void EndpointsChanged(const winrt::event_token& token)
+        {
+            return e_endpointsChanged.remove(token);
+        };
+        /**
+         * @brief Raised when new sessions are waiting in NewSessions. Coalesced: not raised again until the pending sessions have been taken.
+        */
         winrt::event_token SessionAdded(const winrt::Windows::Foundation::EventHandler<winrt::Windows::Foundation::IInspectable>& handler);
         void SessionAdded(const ::winrt::event_token& token);
 
@@ -36,15 +58,42 @@ namespace Audio
         bool Unregister();
 
         /**
-         * @brief Enumerates current audio sessions.
+         * @brief Enumerates current audio sessions of every endpoint.
          * @return Audio sessions currently active
         */
         std::vector<AudioSession*>* GetSessions();
         /**
-         * @brief Newly created sessions. Call in loop to get all the new sessions.
-         * @return 
+         * @brief Enumerates current audio sessions of every endpoint and compares them with the live sessions of the caller. Sessions are
+         * only created for the instance identifiers that are not live (nor already created by a creation notification).
+         * @param liveInstanceIds Instance identifiers of the live sessions. On return, only contains the identifiers of the sessions that are
+         * no longer enumerated. Sessions of an endpoint that failed to enumerate are not reported gone
+         * @return New audio sessions
+        */
+        std::vector<AudioSession*> ReconcileSessions(std::unordered_set<std::wstring>& liveInstanceIds);
+        /**
+         * @brief Takes every newly created session, in creation order. Single consumer.
+         * @param sessions Receives the new sessions
+         * @return Number of new sessions
+        */
+        size_t NewSessions(std::vector<AudioSession*>& sessions);
+        /**
+         * @brief Queues the sessions for process metadata resolution on the resolver workers. Call after subscribing to the sessions StateChanged
+         * event, the resolved name and logo are published through it (DisplayNameChanged, IconChanged).
+         * @param sessions Sessions to resolve
+        */
+        void ResolveMetadata(const std::vector<AudioSession*>& sessions);
+        /**
+         * @brief Sets the size the resolver workers decode the logos of the sessions to, see SessionMetadataResolver::LogoSize.
+        */
+        inline void LogoSize(const uint32_t& size)
+        {
+            metadataResolver.LogoSize(size);
+        };
+        /**
+         * @brief Adds a session that does not come from the audio service, as if it had just been created, and raises SessionAdded.
+         * @param control Session control of the session (synthetic sessions)
         */
-        AudioSession* NewSession();
+        void AddSyntheticSession(IAudioSessionControl2* control);
         /**
          * @brief 
          * @return 
@@ -54,25 +103,70 @@ namespace Audio
     private:
         ::winrt::impl::atomic_ref_count refCount{ 1 };
         GUID audioSessionID;
-        IAudioSessionManager2Ptr audioSessionManager{ nullptr };
+        // Keeps the MTA alive: the endpoints are opened on worker threads.
+        CO_MTA_USAGE_COOKIE mtaUsageCookie = nullptr;
         IMMDeviceEnumeratorPtr deviceEnumerator{ nullptr };
-        IAudioSessionEnumeratorPtr audioSessionEnumerator{ nullptr };
-        std::stack<AudioSession*> newSessions{};
-        bool isRegistered = false;
-        std::wstring currentPwstrDefaultDeviceId{};
+        std::mutex endpointsMutex{};
+        /**
+         * @brief Device id -> endpoint.
+        */
+        std::unordered_map<std::wstring, AudioEndpointContext*> endpoints{};
+        /**
+         * @brief Opens and closes the endpoints notified by the device callbacks: activating a device can be slow, and the MMDevice API does
+         * not allow releasing the last reference of a device or a session manager inside a callback.
+        */
+        std::thread* endpointsThread = nullptr;
+        std::mutex deviceChangesMutex{};
+        std::condition_variable deviceChangesCondition{};
+        /**
+         * @brief Device id -> true to open the endpoint of the device (if it is active), false to close it. The last notification wins.
+        */
+        std::unordered_map<std::wstring, bool> deviceChanges{};
+        bool endpointsThreadRunning = true;
+        System::MpscQueue<AudioSession*> newSessions{};
+        DeviceChangeFilter deviceChangeFilter{};
+        SessionMetadataResolver metadataResolver{};
+        std::atomic_bool isRegistered = false;
 
         winrt::event<winrt::Windows::Foundation::EventHandler<winrt::Windows::Foundation::IInspectable>> e_sessionAdded{};
+        winrt::event<winrt::Windows::Foundation::EventHandler<winrt::Windows::Foundation::IInspectable>> e_endpointsChanged{};
         winrt::event<winrt::Windows::Foundation::TypedEventHandler<winrt::Windows::Foundation::IInspectable, winrt::Windows::Foundation::IInspectable>> e_endpointChanged {};
 
-        STDMETHOD(OnSessionCreated)(IAudioSessionControl* NewSession);
+        /**
+         * @brief Opens endpoints in parallel and adds them.
+         * @param devices Devices of the endpoints
+        */
+        void OpenEndpoints(const std::vector<IMMDevicePtr>& devices);
+        /**
+         * @brief Adds an opened endpoint, registering it if the controller is registered.
+         * @return False if an endpoint with the same device id already exists, the endpoint is then released
+        */
+        bool AddEndpoint(AudioEndpointContext* endpoint);
+        /**
+         * @brief Opens and adds the endpoint of a device if the device is active.
+        */
+        bool AddEndpoint(const std::wstring& deviceId);
+        bool RemoveEndpoint(const std::wstring& deviceId);
+        /**
+         * @brief Copies the open endpoints, each copy holds a reference that the caller releases.
+        */
+        std::vector<AudioEndpointContext*> AcquireEndpoints();
+        void SessionCreated(AudioSession* session);
+        /**
+         * @brief Records a device change for the endpoints thread, called from the device callbacks.
+         * @param deviceId Device id
+         * @param open True to open the endpoint of the device, false to close it
+        */
+        void QueueDeviceChange(const std::wstring& deviceId, const bool& open);
+        void EndpointsThreadFunction();
+
         #pragma region IMMNotificationClient
-        STDMETHODIMP OnDeviceStateChanged(__in LPCWSTR /*pwstrDeviceId*/, __in DWORD /*dwNewState*/) noexcept;
-        STDMETHODIMP OnDefaultDeviceChanged(__in EDataFlow flow, __in  ERole /*role*/, __in_opt LPCWSTR pwstrDefaultDeviceId) noexcept;
+        STDMETHODIMP OnDeviceStateChanged(__in LPCWSTR pwstrDeviceId, __in DWORD dwNewState) noexcept;
+        STDMETHODIMP OnDefaultDeviceChanged(__in EDataFlow flow, __in  ERole role, __in_opt LPCWSTR pwstrDefaultDeviceId) noexcept;
+        STDMETHODIMP OnDeviceAdded(__in LPCWSTR pwstrDeviceId) noexcept;
+        STDMETHODIMP OnDeviceRemoved(__in LPCWSTR pwstrDeviceId) noexcept;
         // Not implemented.
         STDMETHOD(OnPropertyValueChanged)(__in LPCWSTR /*pwstrDeviceId*/, __in const PROPERTYKEY /*key*/) noexcept { return S_OK; };
-        STDMETHOD(OnDeviceAdded)(__in LPCWSTR /*pwstrDeviceId*/) noexcept { return S_OK; };
-        STDMETHOD(OnDeviceRemoved)(__in LPCWSTR /*pwstrDeviceId*/) noexcept { return S_OK; };
         #pragma endregion
     };
 }
-
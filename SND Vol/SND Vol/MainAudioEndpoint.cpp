@@ -3,6 +3,7 @@
 
 #include <Functiondiscoverykeys_devpkey.h>
 #include "LegacyAudioController.h"
+#include "Trace.h"
 
 using namespace winrt;
 
@@ -34,6 +35,7 @@ namespace Audio
 
 	winrt::hstring MainAudioEndpoint::Name() const
 	{
+		TRACE_SPAN(L"MainAudioEndpoint::Name");
 		IPropertyStore* pProps = nullptr;
 		if (SUCCEEDED(device->OpenPropertyStore(STGM_READ, &pProps)))
 		{
@@ -85,10 +87,18 @@ namespace Audio
 
 	std::pair<float, float> MainAudioEndpoint::GetPeaks()
 	{
-		float channelsPeakValues[2]{ 0 };
-		// TODO: Make sure we are giving the correct amount of channels.
-		check_hresult(audioMeterInfo->GetChannelsPeakValues(2, channelsPeakValues));
-		return std::pair<float, float>(channelsPeakValues[0], channelsPeakValues[1]);
+		TRACE_SPAN(L"MainAudioEndpoint::GetPeaks");
+		return GetChannelPeaks().Stereo();
+	}
+
+	ChannelPeaks MainAudioEndpoint::GetChannelPeaks()
+	{
+		UINT channelCount = 0;
+		check_hresult(audioMeterInfo->GetMeteringChannelCount(&channelCount));
+
+		ChannelPeaks peaks{};
+		check_hresult(ReadChannelPeaks(audioMeterInfo, channelCount, peaks));
+		return peaks;
 	}
 
 	bool MainAudioEndpoint::Register()
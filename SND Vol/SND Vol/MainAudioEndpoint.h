@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include "ChannelPeaks.h"
 #include "IComEventImplementation.h"
 
 namespace Audio
@@ -77,7 +78,16 @@ namespace Audio
 		 * @return The current peak PCM value ∈ [0, 1]
 		*/
 		float GetPeak() const;
+		/**
+		 * @brief Gets the current peak PCM values for the audio endpoint, downmixed to stereo.
+		 * @return Left and right peak values ∈ [0, 1]
+		*/
 		std::pair<float, float> GetPeaks();
+		/**
+		 * @brief Gets the current peak PCM value of every channel of the audio endpoint, up to MaxMeteringChannels.
+		 * @return Channel peaks
+		*/
+		ChannelPeaks GetChannelPeaks();
 		/**
 		 * @brief Sets the audio endpoint muted or unmuted.
 		 * @param mute true to mute, false to unmute
@@ -6,13 +6,23 @@
 
 #include "HotKey.h"
 #include "SecondWindow.xaml.h"
+#include "AudioSessionStates.h"
+#include "Trace.h"
 #include <ppl.h>
 #include <ppltasks.h>
+#include "IconCache.h"
 #include "IconHelper.h"
+#include "ProcessMetadataCache.h"
+#include <winrt/Microsoft.UI.Xaml.Hosting.h>
 
 #define USE_TIMER 1
 #define DEACTIVATE_TIMER 0
 #define ENABLE_HOTKEYS 1
+#define BENCHMARK_SESSIONS_INDEX 0
+#define BENCHMARK_ICON_CONVERSION 0
+#define USE_COMPOSITION_METERS 1
+#define MEASURE_METERS_FRAME_TIME 0
+#define TRACE_AUDIO_CALLS 0
 
 using namespace Audio;
 
@@ -34,6 +44,7 @@ using namespace winrt::Windows::ApplicationModel::Core;
 using namespace winrt::Windows::ApplicationModel::Resources;
 using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Foundation::Collections;
+using namespace winrt::Windows::Foundation::Numerics;
 using namespace winrt::Windows::Graphics;
 using namespace winrt::Windows::Storage;
 using namespace winrt::Windows::System;
@@ -49,6 +60,48 @@ namespace winrt::SND_Vol::implementation
 
         InitializeComponent();
         InitializeWindow();
+
+#if USE_COMPOSITION_METERS
+        // Every meter of the window reads its values from a single property set, a meter update is a property write (see UpdatePeakMeters).
+        compositionMeters = ::Rendering::CompositionMeters(
+            winrt::Microsoft::UI::Xaml::Hosting::ElementCompositionPreview::GetElementVisual(SystemVolumeActivityBorderLeft()).Compositor()
+        );
+        mainAudioEndpointMeterKey = compositionMeters.CreateKey();
+        ::Rendering::CompositionMeters::BindLevel(
+            SystemVolumeActivityBorderLeft(), compositionMeters.Values(), mainAudioEndpointMeterKey, L"X", ::Rendering::MeterOrientation::Horizontal
+        );
+        ::Rendering::CompositionMeters::BindLevel(
+            SystemVolumeActivityBorderRight(), compositionMeters.Values(), mainAudioEndpointMeterKey, L"Y", ::Rendering::MeterOrientation::Horizontal
+        );
+#endif // USE_COMPOSITION_METERS
+
+        // Peak meters run on the UI thread frame clock, their periods follow the polling schedulers. The meters run only once loaded.
+        audioSessionsPeakClockToken = frameClock.Register(System::FrameClockPriority::High, [this]()
+        {
+            UpdatePeakMeters();
+        });
+        mainAudioEndpointPeakClockToken = frameClock.Register(System::FrameClockPriority::High, [this]()
+        {
+            UpdateMainAudioEndpointPeakMeter();
+        });
+        // One-shot: sessions created within a frame are added together.
+        newAudioSessionsClockToken = frameClock.Register(System::FrameClockPriority::Normal, [this]()
+        {
+            frameClock.Stop(newAudioSessionsClockToken);
+            AddNewAudioSessions();
+        });
+        // One-shot: session notifications received within a frame are applied together.
+        sessionEventsClockToken = frameClock.Register(System::FrameClockPriority::Normal, [this]()
+        {
+            frameClock.Stop(sessionEventsClockToken);
+            FlushAudioSessionEvents();
+        });
+        // Session volume, mute and state are read from the sessions cached copies, corrected now and then in case a notification was missed.
+        audioSessionsResyncClockToken = frameClock.Register(System::FrameClockPriority::Low, [this]()
+        {
+            ResyncAudioSessions();
+        });
+        frameClock.Start(audioSessionsResyncClockToken, chrono::seconds(10));
         SettingsButtonTeachingTip().Target(SettingsButton());
 
     #ifdef DEBUG
@@ -61,6 +114,27 @@ namespace winrt::SND_Vol::implementation
         });
     #endif // DEBUG
 
+#if TRACE_AUDIO_CALLS
+        // Ctrl+Shift+T writes the spans recorded so far to a Chrome trace file (chrome://tracing, ui.perfetto.dev) in the local folder.
+        System::Trace::Enabled(true);
+        KeyboardAccelerator dumpTraceAccelerator{};
+        dumpTraceAccelerator.Modifiers(VirtualKeyModifiers::Control | VirtualKeyModifiers::Shift);
+        dumpTraceAccelerator.Key(VirtualKey::T);
+        dumpTraceAccelerator.Invoked([this](KeyboardAccelerator const&, KeyboardAcceleratorInvokedEventArgs const& args)
+        {
+            args.Handled(true);
+            try
+            {
+                WindowMessageBar().EnqueueString(L"Trace written to " + hstring(System::Trace::Dump()));
+            }
+            catch (const hresult_error& error)
+            {
+                WindowMessageBar().EnqueueString(error.message());
+            }
+        });
+        Content().KeyboardAccelerators().Append(dumpTraceAccelerator);
+#endif // TRACE_AUDIO_CALLS
+
         if (unbox_value_or(ApplicationData::Current().LocalSettings().Values().TryLookup(L"ShowSplashScreen"), true))
         {
             winrt::Windows::ApplicationModel::PackageId packageId = winrt::Windows::ApplicationModel::Package::Current().Id();
@@ -91,25 +165,63 @@ namespace winrt::SND_Vol::implementation
         loaded = true;
         
 #if USE_TIMER
-        if (!DisableAnimationsIconToggleButton().IsOn())
+        if (DisableAnimationsIconToggleButton().IsOn())
         {
-            if (mainAudioEndpoint)
-            {
-                mainAudioEndpointPeakTimer.Start();
-                VolumeStoryboard().Begin();
-            }
-
-            if (audioSessions.get())
-            {
-                audioSessionsPeakTimer.Start();
-            }
+            SuspendPeakMeters(PeakMetersSuspendReasons::AnimationsDisabled);
         }
+        ResumePeakMeters(PeakMetersSuspendReasons::NotLoaded);
 #endif // USE_TIMER
 
         // Generate size changed event to get correct clipping rectangle size
         SystemVolumeActivityBorder_SizeChanged(nullptr, nullptr);
         Grid_SizeChanged(nullptr, nullptr);
 
+        // Moving the window to a display with another scale, or changing the scale of the display, changes the rasterization scale.
+        if (!xamlRootChangedToken)
+        {
+            xamlRootChangedToken = RootGrid().XamlRoot().Changed({ this, &MainWindow::XamlRoot_Changed });
+        }
+        ScaleIconAtlas(RootGrid().XamlRoot().RasterizationScale());
+
+#if BENCHMARK_SESSIONS_INDEX
+        BenchmarkSessionsIndex();
+#endif // BENCHMARK_SESSIONS_INDEX
+
+#if BENCHMARK_ICON_CONVERSION
+        BenchmarkIconConversion();
+#endif // BENCHMARK_ICON_CONVERSION
+
+#if MEASURE_METERS_FRAME_TIME
+        CompositionTarget::Rendering({ this, &MainWindow::MeasureMetersFrameTime });
+#endif // MEASURE_METERS_FRAME_TIME
+
+#if USE_SYNTHETIC_SESSIONS
+        if (audioController)
+        {
+            syntheticSessions = make_unique<SyntheticSessionBenchmark>(audioController, SyntheticSessionSettings());
+            syntheticSessions->Start();
+
+            syntheticSessionsReportClockToken = frameClock.Register(System::FrameClockPriority::Low, [this]()
+            {
+                OutputDebugHString(syntheticSessions->Report());
+
+                SessionEventStatistics statistics = sessionEvents.Statistics();
+                OutputDebugHString(
+                    L"Session events: " + to_hstring(statistics.recorded) + L" recorded, " + to_hstring(statistics.merged) + L" merged, " +
+                    to_hstring(statistics.dropped) + L" dropped, " + to_hstring(statistics.flushes) + L" flushes, queue depth " +
+                    to_hstring(statistics.pending) + L" (max " + to_hstring(statistics.maxPending) + L")"
+                );
+
+                ::Imaging::IconAtlasStatistics atlasStatistics = iconAtlas.Statistics();
+                OutputDebugHString(
+                    L"Icon atlas: " + to_hstring(atlasStatistics.entries) + L" logos in " + to_hstring(atlasStatistics.pages) + L" pages (" +
+                    to_hstring(atlasStatistics.cellSize) + L" px cells, " + to_hstring(atlasStatistics.bytes / 1024) + L" KiB)"
+                );
+            });
+            frameClock.Start(syntheticSessionsReportClockToken, chrono::seconds(5));
+        }
+#endif // USE_SYNTHETIC_SESSIONS
+
         // Teaching tips
         ApplicationDataContainer teachingTips = ApplicationData::Current().LocalSettings().Containers().TryLookup(L"TeachingTips");
         if (!teachingTips)
@@ -153,22 +265,7 @@ namespace winrt::SND_Vol::implementation
                         {
                             OutputDebugHString(L"Battery saver enabled, disabling animations.");
 
-                            if (mainAudioEndpointPeakTimer.IsRunning())
-                            {
-                                mainAudioEndpointPeakTimer.Stop();
-                                LeftVolumeAnimation().To(0.);
-                                RightVolumeAnimation().To(0.);
-                                VolumeStoryboard().Begin();
-                            }
-
-                            if (audioSessionsPeakTimer.IsRunning())
-                            {
-                                audioSessionsPeakTimer.Stop();
-                                for (auto&& view : audioSessionViews)
-                                {
-                                    view.SetPeak(0, 0);
-                                }
-                            }
+                            SuspendPeakMeters(PeakMetersSuspendReasons::AnimationsDisabled);
 
                             // I18N: Translate battery saver messages.
                             WindowMessageBar().EnqueueString(L"Battery saver enabled, disabling animations.");
@@ -188,15 +285,7 @@ namespace winrt::SND_Vol::implementation
                     {
                         if (DisableAnimationsIconToggleButton().IsOn())
                         {
-                            if (!mainAudioEndpointPeakTimer.IsRunning())
-                            {
-                                mainAudioEndpointPeakTimer.Start();
-                            }
-
-                            if (!audioSessionsPeakTimer.IsRunning())
-                            {
-                                audioSessionsPeakTimer.Start();
-                            }
+                            ResumePeakMeters(PeakMetersSuspendReasons::AnimationsDisabled);
 
                             // I18N: Translate battery saver messages.
                             WindowMessageBar().EnqueueString(L"Battery saver disabled, re-enabling animations.");
@@ -222,15 +311,7 @@ namespace winrt::SND_Vol::implementation
                     {
                         DispatcherQueue().TryEnqueue([this]()
                         {
-                            if (!mainAudioEndpointPeakTimer.IsRunning())
-                            {
-                                mainAudioEndpointPeakTimer.Start();
-                            }
-
-                            if (!audioSessionsPeakTimer.IsRunning())
-                            {
-                                audioSessionsPeakTimer.Start();
-                            }
+                            ResumePeakMeters(PeakMetersSuspendReasons::UserAbsent);
                         });
                     }
                     
@@ -245,22 +326,7 @@ namespace winrt::SND_Vol::implementation
                     {
                         DispatcherQueue().TryEnqueue([this]()
                         {
-                            if (mainAudioEndpointPeakTimer.IsRunning())
-                            {
-                                mainAudioEndpointPeakTimer.Stop();
-                                LeftVolumeAnimation().To(0.);
-                                RightVolumeAnimation().To(0.);
-                                VolumeStoryboard().Begin();
-                            }
-
-                            if (audioSessionsPeakTimer.IsRunning())
-                            {
-                                audioSessionsPeakTimer.Stop();
-                                for (auto&& view : audioSessionViews)
-                                {
-                                    view.SetPeak(0, 0);
-                                }
-                            }
+                            SuspendPeakMeters(PeakMetersSuspendReasons::UserAbsent);
                         });
                     }
                     break;
@@ -330,13 +396,13 @@ namespace winrt::SND_Vol::implementation
     void MainWindow::Window_Activated(IInspectable const&, WindowActivatedEventArgs const&)
     {
         #if DEACTIVATE_TIMER
-        if (args.WindowActivationState() == WindowActivationState::Deactivated && audioSessionsPeakTimer.IsRunning())
+        if (args.WindowActivationState() == WindowActivationState::Deactivated)
         {
-            audioSessionsPeakTimer.Stop();
+            SuspendPeakMeters(PeakMetersSuspendReasons::WindowDeactivated);
         }
-        else if (!audioSessionsPeakTimer.IsRunning())
+        else
         {
-            audioSessionsPeakTimer.Start();
+            ResumePeakMeters(PeakMetersSuspendReasons::WindowDeactivated);
         }
         #endif
     }
@@ -372,29 +438,42 @@ namespace winrt::SND_Vol::implementation
 
     void MainWindow::AudioSessionView_VolumeChanged(AudioSessionView const& sender, RangeBaseValueChangedEventArgs const& args)
     {
-        unique_lock lock{ audioSessionsMutex };
+        AudioSessionSlot* slot = FindSlot(sender.Id());
+        if (!slot || settingViewVolume)
+        {
+            return;
+        }
 
-        for (size_t i = 0; i < audioSessions->size(); i++)
+        // Written by the volume writer: a slider drag does not issue one call to the audio service per value.
+        float volume = static_cast<float>(args.NewValue() / 100.0);
+        if (slot->group && slot->group->Size() > 1)
         {
-            guid id = audioSessions->at(i)->Id();
-            if (id == sender.Id())
+            for (AudioSession* member : slot->group->Members())
             {
-                audioSessions->at(i)->Volume(static_cast<float>(args.NewValue() / 100.0));
+                volumeWriter.Write(member, volume);
             }
         }
+        else
+        {
+            volumeWriter.Write(slot->session, volume);
+        }
     }
 
     void MainWindow::AudioSessionView_VolumeStateChanged(winrt::SND_Vol::AudioSessionView const& sender, bool const& args)
     {
-        unique_lock lock{ audioSessionsMutex };
+        AudioSessionSlot* slot = FindSlot(sender.Id());
+        if (!slot)
+        {
+            return;
+        }
 
-        for (size_t i = 0; i < audioSessions->size(); i++)
+        if (slot->group && slot->group->Size() > 1)
         {
-            guid id = audioSessions->at(i)->Id();
-            if (id == sender.Id())
-            {
-                audioSessions->at(i)->SetMute(args);
-            }
+            slot->group->SetMute(args);
+        }
+        else
+        {
+            slot->session->SetMute(args);
         }
     }
 
@@ -464,14 +543,46 @@ namespace winrt::SND_Vol::implementation
     {
         if (mainAudioEndpoint)
         {
-            mainAudioEndpoint->Volume(static_cast<float>(e.NewValue() / 100.));
+            volumeWriter.Write(mainAudioEndpoint, static_cast<float>(e.NewValue() / 100.), false);
         }
 
         SystemVolumeNumberBlock().Double(e.NewValue());
     }
 
+    void MainWindow::StepMainAudioEndpointVolume(const float& step)
+    {
+        if (!mainAudioEndpoint)
+        {
+            return;
+        }
+
+        try
+        {
+            // Hot key repeats step from the value still waiting to be written, if any.
+            float volume = 0.f;
+            if (!volumeWriter.Pending(mainAudioEndpoint, volume))
+            {
+                volume = mainAudioEndpoint->Volume();
+            }
+            volume += step;
+            volume = volume > 1.f ? 1.f : (volume < 0.f ? 0.f : volume);
+            volumeWriter.Write(mainAudioEndpoint, volume, true);
+        }
+        catch (const hresult_error& error)
+        {
+            OutputDebugHString(L"Failed to step system volume: " + error.message());
+        }
+    }
+
     void MainWindow::SystemVolumeActivityBorder_SizeChanged(IInspectable const&, SizeChangedEventArgs const&)
     {
+        if (compositionMeters)
+        {
+            ::Rendering::CompositionMeters::SetLength(SystemVolumeActivityBorderLeft(), static_cast<float>(SystemVolumeActivityBorderLeft().ActualWidth()));
+            ::Rendering::CompositionMeters::SetLength(SystemVolumeActivityBorderRight(), static_cast<float>(SystemVolumeActivityBorderRight().ActualWidth()));
+            return;
+        }
+
         SystemVolumeActivityBorderClippingRight().Rect(
             Rect(0, 0, static_cast<float>(SystemVolumeActivityBorderRight().ActualWidth()), static_cast<float>(SystemVolumeActivityBorderRight().ActualHeight()))
         );
@@ -647,33 +758,15 @@ namespace winrt::SND_Vol::implementation
 
     void MainWindow::DisableAnimationsIconButton_Click(IconToggleButton const& /*sender*/, RoutedEventArgs const& /*args*/)
     {
-        if (audioSessionsPeakTimer.IsRunning())
+        if (DisableAnimationsIconToggleButton().IsOn())
         {
-            audioSessionsPeakTimer.Stop();
+            SuspendPeakMeters(PeakMetersSuspendReasons::AnimationsDisabled);
         }
         else
         {
-            audioSessionsPeakTimer.Start();
+            ResumePeakMeters(PeakMetersSuspendReasons::AnimationsDisabled);
         }
 
-        if (mainAudioEndpointPeakTimer.IsRunning())
-        {
-            mainAudioEndpointPeakTimer.Stop();
-        }
-        else
-        {
-            mainAudioEndpointPeakTimer.Start();
-        }
-
-
-        LeftVolumeAnimation().To(0.);
-        RightVolumeAnimation().To(0.);
-        VolumeStoryboard().Begin();
-
-        for (auto&& view : audioSessionViews)
-        {
-            view.SetPeak(0, 0);
-        }
         SettingsButtonFlyout().Hide();
     }
 
@@ -717,17 +810,13 @@ namespace winrt::SND_Vol::implementation
 
     void MainWindow::ReloadSessionsIconButton_Click(IconButton const&, RoutedEventArgs const&)
     {
-        if (audioSessionsPeakTimer.IsRunning())
-        {
-            audioSessionsPeakTimer.Stop();
-        }
-        if (mainAudioEndpointPeakTimer.IsRunning())
-        {
-            mainAudioEndpointPeakTimer.Stop();
-        }
+        SuspendPeakMeters(PeakMetersSuspendReasons::Reloading);
+        meteringEngine.ClearSessions();
 
         audioSessionViews.Clear();
         VolumeStoryboard().Stop();
+        // Writes the last requested volumes before the sessions and the endpoint are released, the writer is reused after reloading.
+        volumeWriter.Flush();
 
         // Clean up ComPtr/IUnknown objects
         if (audioController)
@@ -741,6 +830,7 @@ namespace winrt::SND_Vol::implementation
             }
 
             audioController->EndpointChanged(audioControllerEndpointChangedToken);
+            audioController->EndpointsChanged(audioControllerEndpointsChangedToken);
             audioController->SessionAdded(audioControllerSessionAddedToken);
 
             audioController->Unregister();
@@ -750,32 +840,22 @@ namespace winrt::SND_Vol::implementation
         // Unregister VolumeChanged event handler & unregister audio sessions from audio events and release com ptrs.
         {
             unique_lock lock{ audioSessionsMutex };
+            for (AudioSessionSlot& slot : audioSessionSlots)
+            {
+                UnregisterAudioSession(slot);
+            }
             for (size_t i = 0; i < audioSessions->size(); i++)
             {
-                audioSessions->at(i)->VolumeChanged(audioSessionVolumeChanged[audioSessions->at(i)->Id()]);
-                audioSessions->at(i)->StateChanged(audioSessionsStateChanged[audioSessions->at(i)->Id()]);
-                audioSessions->at(i)->Unregister();
                 audioSessions->at(i)->Release();
             }
             audioSessions->clear();
+            ClearAudioSessionsIndex();
         }
 
 
         // Reload content
         LoadContent();
-        if (!DisableAnimationsIconToggleButton().IsOn())
-        {
-            if (mainAudioEndpoint)
-            {
-                mainAudioEndpointPeakTimer.Start();
-                VolumeStoryboard().Begin();
-            }
-
-            if (audioSessions.get())
-            {
-                audioSessionsPeakTimer.Start();
-            }
-        }
+        ResumePeakMeters(PeakMetersSuspendReasons::Reloading);
 
         ResourceLoader loader{};
         WindowMessageBar().EnqueueString(loader.GetString(L"InfoAudioSessionsReloaded"));
@@ -844,6 +924,12 @@ namespace winrt::SND_Vol::implementation
         secondWindow.NavigateTo(xaml_typename<AudioProfilesPage>());
     }
 
+    void MainWindow::XamlRoot_Changed(XamlRoot const& sender, XamlRootChangedEventArgs const&)
+    {
+        // Also raised when the window is resized or hidden, ScaleIconAtlas ignores an unchanged scale.
+        ScaleIconAtlas(sender.RasterizationScale());
+    }
+
     void MainWindow::RootGrid_ActualThemeChanged(FrameworkElement const&, IInspectable const&)
     {
         WindowMessageBar().EnqueueString(L"Actual application theme has changed. Loading new theme right now, all effects will be applied on restart.");
@@ -895,6 +981,7 @@ namespace winrt::SND_Vol::implementation
         nativeWindow->get_WindowHandle(&handle);
         WindowId windowID = GetWindowIdFromWindow(handle);
         appWindow = AppWindow::GetFromWindowId(windowID);
+        ScaleIconAtlas(static_cast<double>(GetDpiForWindow(handle)) / USER_DEFAULT_SCREEN_DPI);
         if (appWindow != nullptr)
         {   
 #ifdef DEBUG
@@ -995,50 +1082,22 @@ namespace winrt::SND_Vol::implementation
 
         volumeUpHotKeyPtr.Fired([this](auto, auto)
         {
-            try
-            {
-                constexpr float stepping = 0.02f;
-                mainAudioEndpoint->SetVolume(mainAudioEndpoint->Volume() + stepping < 1.f ? mainAudioEndpoint->Volume() + stepping : 1.f);
-            }
-            catch (...)
-            {
-            }
+            StepMainAudioEndpointVolume(0.02f);
         });
 
         volumeDownHotKeyPtr.Fired([this](auto, auto)
         {
-            try
-            {
-                constexpr float stepping = 0.02f;
-                mainAudioEndpoint->SetVolume(mainAudioEndpoint->Volume() - stepping > 0.f ? mainAudioEndpoint->Volume() - stepping : 0.f);
-            }
-            catch (...)
-            {
-            }
+            StepMainAudioEndpointVolume(-0.02f);
         });
 
         volumePageUpHotKeyPtr.Fired([this](auto, auto)
         {
-            try
-            {
-                constexpr float stepping = 0.07f;
-                mainAudioEndpoint->SetVolume(mainAudioEndpoint->Volume() + stepping < 1.f ? mainAudioEndpoint->Volume() + stepping : 1.f);
-            }
-            catch (...)
-            {
-            }
+            StepMainAudioEndpointVolume(0.07f);
         });
 
         volumePageDownHotKeyPtr.Fired([this](auto, auto)
         {
-            try
-            {
-                constexpr float stepping = 0.07f;
-                mainAudioEndpoint->SetVolume(mainAudioEndpoint->Volume() - stepping > 0.f ? mainAudioEndpoint->Volume() - stepping : 0.f);
-            }
-            catch (...)
-            {
-            }
+            StepMainAudioEndpointVolume(-0.07f);
         });
 
         muteHotKeyPtr.Fired([this](auto, auto)
@@ -1127,13 +1186,18 @@ namespace winrt::SND_Vol::implementation
         {
             try
             {
+                // Metadata of the applications seen by previous runs, so that their sessions are named without reading version infos or manifests.
+                System::ProcessMetadataCache::Current().Load(System::ProcessMetadataCache::DefaultPath());
+
                 // Create and setup audio interfaces.
                 audioController = new LegacyAudioController(appID);
+                audioController->LogoSize(::Imaging::IconAtlas::CellPixelsAt(logoScale));
 
                 if (audioController->Register())
                 {
                     audioController->SessionAdded({ this, &MainWindow::AudioController_SessionAdded });
                     audioController->EndpointChanged({ this, &MainWindow::AudioController_EndpointChanged });
+                    audioControllerEndpointsChangedToken = audioController->EndpointsChanged({ this, &MainWindow::AudioController_EndpointsChanged });
                 }
                 else
                 {
@@ -1159,6 +1223,10 @@ namespace winrt::SND_Vol::implementation
                     audioSessions = unique_ptr<vector<AudioSession*>>(audioController->GetSessions());
                     for (size_t i = 0; i < audioSessions->size(); i++)
                     {
+                        meteringEngine.AddSession(audioSessions->at(i));
+                        IndexAudioSession(audioSessions->at(i), nullptr);
+                        FindSlot(audioSessions->at(i)->Id())->listIndex = i;
+
                         // Check if the session is active, if not check if the user asked to show inactive sessions on startup.
                         if (audioSessions->at(i)->State() == ::AudioSessionState::AudioSessionStateActive ||
                             unbox_value_or(ApplicationData::Current().LocalSettings().Values().TryLookup(L"ShowInactiveSessionsOnStartup"), false))
@@ -1166,22 +1234,21 @@ namespace winrt::SND_Vol::implementation
                             if (AudioSessionView view = CreateAudioView(audioSessions->at(i)))
                             {
                                 audioSessionViews.Append(view);
+                                IndexAudioSession(audioSessions->at(i), view);
                             }
                         }
                         else // Register to events since we are not adding/creating the view.
                         {
-                            if (audioSessions->at(i)->Register())
-                            {
-                                audioSessionVolumeChanged.insert({ audioSessions->at(i)->Id(), audioSessions->at(i)->VolumeChanged({ this, &MainWindow::AudioSession_VolumeChanged }) });
-                                audioSessionsStateChanged.insert({ audioSessions->at(i)->Id(), audioSessions->at(i)->StateChanged({ this, &MainWindow::AudioSession_StateChanged }) });
-                            }
-                            else
+                            if (!RegisterAudioSession(audioSessions->at(i)))
                             {
                                 OutputDebugHString(L"Failed to register audio session '" + audioSessions->at(i)->Name() + L"'. This session will never be shown.");
                                 WindowMessageBar().EnqueueString(audioSessions->at(i)->Name() + L" : notifications off");
                             }
                         }
                     }
+
+                    // Views are shown with the display names, process names and logos are published when resolved.
+                    audioController->ResolveMetadata(*audioSessions);
                 }
 
                 audioSessions = unique_ptr<vector<AudioSession*>>(audioController->GetSessions());
@@ -1201,35 +1268,6 @@ namespace winrt::SND_Vol::implementation
                 }
 
 
-                // Create and setup peak meters timers
-                audioSessionsPeakTimer = DispatcherQueue().CreateTimer();
-                mainAudioEndpointPeakTimer = DispatcherQueue().CreateTimer();
-
-                audioSessionsPeakTimer.Interval(TimeSpan(std::chrono::milliseconds(100)));
-                audioSessionsPeakTimer.Tick({ this, &MainWindow::UpdatePeakMeters });
-                audioSessionsPeakTimer.Stop();
-
-                mainAudioEndpointPeakTimer.Interval(TimeSpan(std::chrono::milliseconds(100)));
-                mainAudioEndpointPeakTimer.Tick([&](auto, auto)
-                {
-                    if (!loaded)
-                    {
-                        return;
-                    }
-                    
-                    try
-                    {
-                        pair<float, float> peakValues = mainAudioEndpoint->GetPeaks();
-                        LeftVolumeAnimation().To(static_cast<double>(peakValues.first));
-                        RightVolumeAnimation().To(static_cast<double>(peakValues.second));
-                        VolumeStoryboard().Begin();
-                    }
-                    catch (const hresult_error&)
-                    {
-                        // TODO: Handle error.
-                    }
-                });
-
                 MainEndpointNameTextBlock().Text(mainAudioEndpoint->Name());
                 SystemVolumeSlider().Value(static_cast<double>(mainAudioEndpoint->Volume()) * 100.);
                 MuteToggleButton().IsChecked(mainAudioEndpoint->Muted());
@@ -1249,12 +1287,7 @@ namespace winrt::SND_Vol::implementation
 
     AudioSessionView MainWindow::CreateAudioView(AudioSession* audioSession)
     {
-        if (audioSession->Register())
-        {
-            audioSessionVolumeChanged.insert({ audioSession->Id(), audioSession->VolumeChanged({ this, &MainWindow::AudioSession_VolumeChanged }) });
-            audioSessionsStateChanged.insert({ audioSession->Id(), audioSession->StateChanged({ this, &MainWindow::AudioSession_StateChanged }) });
-        }
-        else
+        if (!RegisterAudioSession(audioSession))
         {
             OutputDebugHString(L"Failed to register audio session '" + audioSession->Name() + L"'.");
             WindowMessageBar().EnqueueString(audioSession->Name() + L" notifications off");
@@ -1265,32 +1298,31 @@ namespace winrt::SND_Vol::implementation
 
     AudioSessionView MainWindow::CreateAudioSessionView(AudioSession* audioSession, bool skipDuplicates)
     {
-        // Check for duplicates, multiple audio sessions might be grouped under one by the app/system owning the sessions.
-        //checkForDuplicates = false;
-        if (!skipDuplicates && audioSession->State() != ::AudioSessionState::AudioSessionStateActive)
+        // Multiple audio sessions might be grouped under one by the app/system owning the sessions, a group has a single view controlling
+        // every member.
+        if (!skipDuplicates)
         {
-            unique_lock lock{ audioSessionsMutex };
-
-            uint8_t hitcount = 0u;
-            for (size_t j = 0; j < audioSessions->size(); j++)
+            AudioSessionSlot* slot = FindSlot(audioSession->Id());
+            if (slot && FindViewSlot(*slot))
             {
-                if (audioSessions->at(j)->GroupingParam() == audioSession->GroupingParam())
-                {
-                    if (hitcount > 1)
-                    {
-                        return nullptr;
-                    }
-                    hitcount++;
-                }
+                return nullptr;
             }
         }
 
 
         AudioSessionView view = nullptr;
 
+        // The session joins its group when the view is indexed, the view shows the loudest member of the group.
+        float volume = audioSession->Volume();
+        if (AudioSessionGroup* group = audioSessionGroups.Find(audioSession->EndpointId(), audioSession->GroupingParam()))
+        {
+            float groupVolume = group->Volume();
+            volume = groupVolume > volume ? groupVolume : volume;
+        }
+
         if (audioSession->IsSystemSoundSession())
         {
-            view = AudioSessionView(audioSession->Name(), audioSession->Volume() * 100.0);
+            view = AudioSessionView(audioSession->Name(), volume * 100.0);
 
             FontIcon icon{};
             icon.Glyph(L"\ue770");
@@ -1305,51 +1337,14 @@ namespace winrt::SND_Vol::implementation
         }
         else
         {
-#ifdef DEBUG
-            if (!audioSession->ProcessPath().empty())
-            {
-                ::Imaging::IconHelper iconHelper{};
-                HICON hIcon = iconHelper.LoadIconFromPath(audioSession->ProcessPath());
-
-                using namespace Windows::Storage::Streams;
-                InMemoryRandomAccessStream inMemoryRAS{};
-                Windows::Storage::Streams::DataWriter dataWriter{ inMemoryRAS };
-                dataWriter.UnicodeEncoding(UnicodeEncoding::Utf8);
-
-                unsigned char buffer[2048]{};
-                void* pv = buffer;
-                ULONG cb = 0;
-                ULONG cbRead = 0;
-                while (hIconStream->Read(
-                    pv,
-                    cb,
-                    &cbRead)
-                    )
-                {
-                    dataWriter.WriteBytes(buffer);
-
-                    // Check of EOF.
-                    if (cbRead < cb)
-                    {
-                        break;
-                    }
-                }
-            };
-#else
-            if (audioSession->LogoPath().empty())
-            {
-                view = AudioSessionView(audioSession->Name(), audioSession->Volume() * 100.0);
-            }
-            else
-            {
-                view = AudioSessionView(audioSession->Name(), audioSession->Volume() * 100.0, audioSession->LogoPath());
-            }
-#endif
+            // The logo is taken from the icon atlas once the view is indexed (IndexAudioSession).
+            view = AudioSessionView(audioSession->Name(), volume * 100.0);
         }
 
         view.Id(guid(audioSession->Id()));
         view.Muted(audioSession->Muted());
         view.SetState((AudioSessionState)audioSession->State());
+        view.ChannelMetersEnabled(unbox_value_or(ApplicationData::Current().LocalSettings().Values().TryLookup(L"ShowChannelMeters"), false));
 
         view.VolumeChanged({ this, &MainWindow::AudioSessionView_VolumeChanged });
         view.VolumeStateChanged({ this, &MainWindow::AudioSessionView_VolumeStateChanged });
@@ -1358,18 +1353,17 @@ namespace winrt::SND_Vol::implementation
 #ifdef DEBUG
 
 #else
-            for (auto const& view : audioSessionViews)
+            AudioSessionSlot* slot = FindSlot(sender.Id());
+            if (slot && slot->view)
             {
-                if (view.Id() == sender.Id())
+                uint32_t indexOf = 0;
+                if (audioSessionViews.IndexOf(slot->view, indexOf))
                 {
-                    uint32_t indexOf = 0;
-                    if (audioSessionViews.IndexOf(view, indexOf))
-                    {
-                        audioSessionViews.RemoveAt(indexOf);
-    }
-
-                    return;
+                    audioSessionViews.RemoveAt(indexOf);
                 }
+                // The session stays indexed so that it can be shown again when it becomes active.
+                ReleaseAudioSessionLogo(*slot);
+                slot->view = nullptr;
             }
 #endif // DEBUG
 
@@ -1460,6 +1454,28 @@ namespace winrt::SND_Vol::implementation
 
         layout = unbox_value_or(settings.TryLookup(L"SessionsLayout"), 0);
 
+        // Time without audio after which the peak meters are polled at the idle rate.
+        PeakPollingSettings peakPollingSettings{};
+        peakPollingSettings.silenceTimeout = chrono::milliseconds(
+            unbox_value_or(settings.TryLookup(L"PeakMetersSilenceTimeout"), static_cast<int64_t>(peakPollingSettings.silenceTimeout.count()))
+        );
+
+        // Meters ballistics, in milliseconds.
+        MeterBallisticsSettings ballisticsSettings{};
+        ballisticsSettings.attackTime = chrono::milliseconds(
+            unbox_value_or(settings.TryLookup(L"MeterAttackTime"), static_cast<int64_t>(ballisticsSettings.attackTime.count()))
+        );
+        ballisticsSettings.releaseTime = chrono::milliseconds(
+            unbox_value_or(settings.TryLookup(L"MeterReleaseTime"), static_cast<int64_t>(ballisticsSettings.releaseTime.count()))
+        );
+        ballisticsSettings.peakHoldTime = chrono::milliseconds(
+            unbox_value_or(settings.TryLookup(L"MeterPeakHoldTime"), static_cast<int64_t>(ballisticsSettings.peakHoldTime.count()))
+        );
+
+        meteringEngine.Configure(peakPollingSettings, ballisticsSettings);
+        mainAudioEndpointBallistics = MeterBallistics(ballisticsSettings);
+        mainAudioEndpointPeakScheduler = PeakPollingScheduler(peakPollingSettings);
+
         KeepOnTopToggleButton().IsChecked(alwaysOnTop);
         DisableAnimationsIconToggleButton().IsOn(unbox_value_or(settings.TryLookup(L"DisableAnimations"), false));
         bool showMenu = unbox_value_or(settings.TryLookup(L"ShowAppBar"), false);
@@ -1501,7 +1517,7 @@ namespace winrt::SND_Vol::implementation
                 AppBarGrid().Visibility() == Visibility::Visible
             );
             currentAudioProfile.DisableAnimations(
-                mainAudioEndpointPeakTimer.IsRunning()
+                DisableAnimationsIconToggleButton().IsOn()
             );
 
             unique_lock lock{ audioSessionsMutex };
@@ -1542,6 +1558,7 @@ namespace winrt::SND_Vol::implementation
 
                         if (disableAnimations)
                         {
+                            DisableAnimationsIconToggleButton().IsOn(true);
                             DisableAnimationsIconButton_Click(nullptr, nullptr);
                         }
 
@@ -1757,44 +1774,33 @@ namespace winrt::SND_Vol::implementation
 
     void MainWindow::ReloadAudioSessions()
     {
-        if (audioSessionsPeakTimer.IsRunning())
-        {
-            audioSessionsPeakTimer.Stop();
-        }
-
-        audioSessionViews.Clear();
-        VolumeStoryboard().Stop();
-
-        // Unregister VolumeChanged event handler & unregister audio sessions from audio events and release com ptrs.
-        {
-            unique_lock lock{ audioSessionsMutex };
-            for (size_t i = 0; i < audioSessions->size(); i++)
-            {
-                audioSessions->at(i)->VolumeChanged(audioSessionVolumeChanged[audioSessions->at(i)->Id()]);
-                audioSessions->at(i)->StateChanged(audioSessionsStateChanged[audioSessions->at(i)->Id()]);
-                audioSessions->at(i)->Unregister();
-                audioSessions->at(i)->Release();
-            }
-            audioSessions->clear();
-            // The lock can be realeased since no interactions will be made with audioSessions && audioSessionViews
-        }
-
+        // Reconciles the live sessions with the enumerated ones by instance identifier: sessions that are still there keep their views and
+        // state, only the sessions that appeared are created and only the sessions that disappeared are removed.
         try
         {
-            // Reload audio sessions.
-            audioSessions = unique_ptr<vector<AudioSession*>>(audioController->GetSessions());
-            for (size_t i = 0; i < audioSessions->size(); i++)
+            unordered_map<wstring, guid> liveSessions{};
+            unordered_set<wstring> missingInstanceIds{};
             {
-                if (AudioSessionView view = CreateAudioView(audioSessions->at(i)))
+                unique_lock lock{ audioSessionsMutex };
+                liveSessions.reserve(audioSessions->size());
+                missingInstanceIds.reserve(audioSessions->size());
+                for (AudioSession* audioSession : *audioSessions)
                 {
-                    audioSessionViews.Append(view);
+                    wstring instanceId{ audioSession->InstanceId() };
+                    liveSessions.insert({ instanceId, guid(audioSession->Id()) });
+                    missingInstanceIds.insert(instanceId);
                 }
             }
 
-            if (!DisableAnimationsIconToggleButton().IsOn() && audioSessions.get())
+            vector<AudioSession*> addedSessions = audioController->ReconcileSessions(missingInstanceIds);
+
+            for (const wstring& instanceId : missingInstanceIds)
             {
-                audioSessionsPeakTimer.Start();
+                RemoveAudioSession(liveSessions[instanceId]);
             }
+            AddAudioSessions(addedSessions);
+
+            OutputDebugHString(L"Audio sessions reconciled: " + to_hstring(addedSessions.size()) + L" added, " + to_hstring(missingInstanceIds.size()) + L" removed.");
         }
         catch (const winrt::hresult_error& err)
         {
@@ -1802,55 +1808,737 @@ namespace winrt::SND_Vol::implementation
         }
     }
 
-    void MainWindow::UpdatePeakMeters(IInspectable, IInspectable)
+    void MainWindow::IndexAudioSession(AudioSession* audioSession, AudioSessionView const& view)
     {
-        if (!loaded || !audioSessions.get()) return;
+        AudioSessionSlot* existingSlot = FindSlot(audioSession->Id());
+        if (!existingSlot)
+        {
+            AudioSessionSlot newSlot{};
+            newSlot.session = audioSession;
+            newSlot.group = audioSessionGroups.Add(audioSession);
+            System::SlotHandle handle = audioSessionSlots.Insert(move(newSlot));
+            audioSessionHandles.insert({ guid(audioSession->Id()), handle });
+            existingSlot = audioSessionSlots.Get(handle);
+        }
 
-        // TODO: Try to see if I can update the code to make it faster. Multithreading is not an option since it's a single threaded appartement.
-        for (size_t i = 0; i < audioSessions->size(); i++)
+        AudioSessionSlot& slot = *existingSlot;
+        if (slot.view != view)
         {
-            if (audioSessions->at(i))
-            {
-                guid id = audioSessions->at(i)->Id();
-                for (auto const& view : audioSessionViews)
-                {
-                    if (view.Id() == id)
-                    {
-                        auto&& pair = audioSessions->at(i)->GetChannelsPeak();
-                        view.SetPeak(pair.first, pair.second);
-                        //OutputDebugHString(audioSessions->at(i)->Name() + L" peak values : [" + to_hstring(pair.first) + L", " + to_hstring(pair.second) + L"]");
+            ReleaseAudioSessionLogo(slot);
+        }
+        slot.view = view;
+        slot.channelMeters = view && view.ChannelMetersEnabled();
+        UpdateAudioSessionLogo(slot);
 
-                        break;
-                    }
-                }
+        if (view && compositionMeters)
+        {
+            if (slot.meterKey.empty())
+            {
+                slot.meterKey = compositionMeters.CreateKey();
             }
+            view.UseCompositionMeters(compositionMeters.Values(), slot.meterKey);
         }
     }
 
-    void MainWindow::AppWindow_Closing(winrt::Microsoft::UI::Windowing::AppWindow, winrt::Microsoft::UI::Windowing::AppWindowClosingEventArgs)
+    bool MainWindow::RegisterAudioSession(AudioSession* audioSession)
+    {
+        auto it = audioSessionHandles.find(guid(audioSession->Id()));
+        if (it == audioSessionHandles.end() || !audioSession->Register())
+        {
+            return false;
+        }
+
+        // The handlers are bound to the record of the session, not to its id: a late notification cannot reach another session.
+        System::SlotHandle handle = it->second;
+        AudioSessionSlot* slot = audioSessionSlots.Get(handle);
+        slot->volumeChangedToken = audioSession->VolumeChanged([this, handle](winrt::guid, float newVolume)
+        {
+            AudioSession_VolumeChanged(handle, newVolume);
+        });
+        slot->stateChangedToken = audioSession->StateChanged([this, handle](winrt::guid, uint32_t state)
+        {
+            AudioSession_StateChanged(handle, state);
+        });
+        return true;
+    }
+
+    void MainWindow::UnregisterAudioSession(AudioSessionSlot& slot)
     {
-        if (audioSessionsPeakTimer && audioSessionsPeakTimer.IsRunning())
+        if (slot.volumeChangedToken)
         {
-            audioSessionsPeakTimer.Stop();
+            slot.session->VolumeChanged(slot.volumeChangedToken);
+            slot.volumeChangedToken = {};
         }
-        if (mainAudioEndpointPeakTimer && mainAudioEndpointPeakTimer.IsRunning())
+        if (slot.stateChangedToken)
         {
-            mainAudioEndpointPeakTimer.Stop();
+            slot.session->StateChanged(slot.stateChangedToken);
+            slot.stateChangedToken = {};
         }
+        slot.session->Unregister();
+    }
 
-        VolumeStoryboard().Stop();
+    MainWindow::AudioSessionSlot* MainWindow::FindSlot(const winrt::guid& id)
+    {
+        auto it = audioSessionHandles.find(id);
+        return it != audioSessionHandles.end() ? audioSessionSlots.Get(it->second) : nullptr;
+    }
 
-        // Clean up ComPtr/IUnknown objects
-        if (audioController)
+    AudioSessionView MainWindow::FindAudioSessionView(const winrt::guid& id)
+    {
+        AudioSessionSlot* slot = FindSlot(id);
+        if (!slot)
         {
-            if (mainAudioEndpoint)
-            {
-                mainAudioEndpoint->VolumeChanged(mainAudioEndpointVolumeChangedToken);
-                mainAudioEndpoint->Unregister();
+            return nullptr;
+        }
+
+        AudioSessionSlot* viewSlot = FindViewSlot(*slot);
+        return viewSlot ? viewSlot->view : nullptr;
+    }
+
+    MainWindow::AudioSessionSlot* MainWindow::FindViewSlot(AudioSessionSlot& slot)
+    {
+        if (slot.view)
+        {
+            return &slot;
+        }
+        if (!slot.group || slot.group->Size() < 2)
+        {
+            return nullptr;
+        }
+
+        for (AudioSession* member : slot.group->Members())
+        {
+            AudioSessionSlot* memberSlot = FindSlot(member->Id());
+            if (memberSlot && memberSlot->view)
+            {
+                return memberSlot;
+            }
+        }
+        return nullptr;
+    }
+
+    void MainWindow::SetViewVolume(const AudioSessionView& view, const float& volume)
+    {
+        // The slider is bound to Volume, setting it raises VolumeChanged synchronously.
+        settingViewVolume = true;
+        view.Volume(static_cast<double>(volume) * 100.0);
+        settingViewVolume = false;
+    }
+
+    AudioSession* MainWindow::FindAudioSession(const winrt::guid& id)
+    {
+        AudioSessionSlot* slot = FindSlot(id);
+        return slot ? slot->session : nullptr;
+    }
+
+    void MainWindow::RemoveAudioSession(const winrt::guid& id)
+    {
+        auto it = audioSessionHandles.find(id);
+        if (it == audioSessionHandles.end())
+        {
+            return;
+        }
+
+        // Removing the record invalidates its handle, the events of the session still queued on the dispatcher are dropped.
+        AudioSessionSlot slot = *audioSessionSlots.Get(it->second);
+        audioSessionSlots.Remove(it->second);
+        audioSessionHandles.erase(it);
+
+        if (compositionMeters)
+        {
+            compositionMeters.ReleaseKey(slot.meterKey);
+        }
+
+        AudioSessionGroup* group = audioSessionGroups.Remove(slot.session);
+        if (slot.view && group)
+        {
+            // The view controls the rest of the group, it is handed over to the oldest remaining member.
+            AudioSession* member = group->Members().front();
+            slot.view.Id(guid(member->Id()));
+            slot.view.Header(member->Name());
+            slot.view.SetState(group->IsActive() ? AudioSessionState::Active : AudioSessionState::Inactive);
+            SetViewVolume(slot.view, group->Volume());
+            IndexAudioSession(member, slot.view);
+        }
+        else if (slot.view)
+        {
+            uint32_t indexOf = 0;
+            if (audioSessionViews.IndexOf(slot.view, indexOf))
+            {
+                audioSessionViews.RemoveAt(indexOf);
+            }
+        }
+        // Released after the handover, the member taking the view already references its own logo.
+        ReleaseAudioSessionLogo(slot);
+
+        meteringEngine.RemoveSession(id);
+
+        {
+            // The last session takes the place of the removed one.
+            unique_lock lock{ audioSessionsMutex };
+            AudioSession* last = audioSessions->back();
+            audioSessions->at(slot.listIndex) = last;
+            audioSessions->pop_back();
+            if (last != slot.session)
+            {
+                FindSlot(last->Id())->listIndex = slot.listIndex;
+            }
+        }
+
+        UnregisterAudioSession(slot);
+        slot.session->Release();
+    }
+
+    void MainWindow::ClearAudioSessionsIndex()
+    {
+        for (AudioSessionSlot& slot : audioSessionSlots)
+        {
+            if (compositionMeters)
+            {
+                compositionMeters.ReleaseKey(slot.meterKey);
+            }
+            ReleaseAudioSessionLogo(slot);
+        }
+        audioSessionSlots.Clear();
+        audioSessionHandles.clear();
+        audioSessionGroups.Clear();
+    }
+
+    void MainWindow::UpdateAudioSessionLogo(AudioSessionSlot& slot)
+    {
+        if (!slot.view)
+        {
+            return;
+        }
+
+        wstring logoPath = slot.session->LogoPath();
+        shared_ptr<const ::Imaging::IconPixels> logoPixels = slot.session->TakeLogoPixels();
+        if (logoPath.empty() || logoPath == slot.logoPath)
+        {
+            return;
+        }
+
+        // Acquired before the previous logo is released, a logo shared by both is not decoded again.
+        Brush logoBrush = logoPixels && logoPixels->path == logoPath ? iconAtlas.Acquire(*logoPixels) : iconAtlas.Acquire(logoPath);
+        ReleaseAudioSessionLogo(slot);
+        if (logoBrush)
+        {
+            slot.view.SetLogoBrush(logoBrush, ::Imaging::IconAtlas::CellSize);
+            slot.logoPath = logoPath;
+        }
+        else
+        {
+            // Not decodable by WIC (the atlas logs why), the view gets its own image.
+            slot.view.SetLogo(hstring(logoPath));
+        }
+    }
+
+    void MainWindow::ReleaseAudioSessionLogo(AudioSessionSlot& slot)
+    {
+        if (!slot.logoPath.empty())
+        {
+            iconAtlas.Release(slot.logoPath);
+            slot.logoPath.clear();
+        }
+    }
+
+    void MainWindow::ScaleIconAtlas(const double& rasterizationScale)
+    {
+        if (rasterizationScale <= 0. || rasterizationScale == logoScale)
+        {
+            return;
+        }
+
+        logoScale = rasterizationScale;
+        uint32_t cellPixels = ::Imaging::IconAtlas::CellPixelsAt(rasterizationScale);
+        if (audioController)
+        {
+            // Sessions resolved from now on come with logos decoded at the new size.
+            audioController->LogoSize(cellPixels);
+        }
+
+        vector<wstring> paths = iconAtlas.Paths();
+        if (paths.empty())
+        {
+            iconAtlas.Scale(rasterizationScale);
+            return;
+        }
+
+        concurrency::create_task([this, dispatcherQueue = DispatcherQueue(), paths = move(paths), rasterizationScale, cellPixels]()
+        {
+            bool uninitialize = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+            vector<::Imaging::IconPixels> logos{};
+            logos.reserve(paths.size());
+            for (const wstring& path : paths)
+            {
+                ::Imaging::IconPixels logo{ path, cellPixels, {} };
+                try
+                {
+                    ::Imaging::IconCache::Current().CopyIconPixels(path, cellPixels, logo.pixels);
+                    logos.push_back(move(logo));
+                }
+                catch (const hresult_error& error)
+                {
+                    OutputDebugHString(L"Failed to decode logo '" + hstring(path) + L"': " + error.message());
+                }
+            }
+
+            if (uninitialize)
+            {
+                CoUninitialize();
+            }
+
+            dispatcherQueue.TryEnqueue([this, logos = move(logos), rasterizationScale]()
+            {
+                // Else the scale changed again meanwhile, the logos are being decoded for the newer one.
+                if (rasterizationScale == logoScale)
+                {
+                    iconAtlas.Scale(rasterizationScale, logos);
+                }
+            });
+        });
+    }
+
+#if BENCHMARK_SESSIONS_INDEX
+    void MainWindow::BenchmarkSessionsIndex()
+    {
+        constexpr size_t ticks = 100;
+
+        for (size_t sessionCount : { 10ull, 100ull, 1000ull })
+        {
+            vector<AudioSessionView> views{};
+            unordered_map<guid, AudioSessionSlot, GuidHash> index{};
+            PeakSnapshot snapshot{};
+            for (size_t i = 0; i < sessionCount; i++)
+            {
+                GUID id{};
+                check_bool(UuidCreate(&id) == 0);
+
+                AudioSessionView view{ L"Synthetic session", 50. };
+                view.Id(id);
+                views.push_back(view);
+                index[guid(id)] = AudioSessionSlot{ view, nullptr };
+                ChannelPeaks peaks{};
+                peaks.values[0] = peaks.values[1] = 0.5f;
+                peaks.count = 2;
+                snapshot.Push(id, peaks, peaks, PeakHistoryStatistics(), 0);
+            }
+
+            // Previous implementation: for each session, compare the id of every view.
+            size_t hits = 0;
+            auto start = chrono::high_resolution_clock::now();
+            for (size_t tick = 0; tick < ticks; tick++)
+            {
+                for (size_t i = 0; i < snapshot.Size(); i++)
+                {
+                    guid id = snapshot.ids[i];
+                    for (auto const& view : views)
+                    {
+                        if (view.Id() == id)
+                        {
+                            hits++;
+                            break;
+                        }
+                    }
+                }
+            }
+            auto linearDuration = chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - start).count() / ticks;
+
+            start = chrono::high_resolution_clock::now();
+            for (size_t tick = 0; tick < ticks; tick++)
+            {
+                for (size_t i = 0; i < snapshot.Size(); i++)
+                {
+                    auto it = index.find(snapshot.ids[i]);
+                    if (it != index.end() && it->second.view)
+                    {
+                        hits++;
+                    }
+                }
+            }
+            auto indexDuration = chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - start).count() / ticks;
+
+            OutputDebugHString(
+                L"Sessions index benchmark, " + to_hstring(static_cast<uint64_t>(sessionCount)) + L" sessions: linear scan " + 
+                to_hstring(linearDuration) + L"us/tick, index " + to_hstring(indexDuration) + L"us/tick (" + to_hstring(static_cast<uint64_t>(hits)) + L" hits)."
+            );
+        }
+    }
+#endif // BENCHMARK_SESSIONS_INDEX
+
+#if BENCHMARK_ICON_CONVERSION
+    void MainWindow::BenchmarkIconConversion()
+    {
+        // One-off measure of the icon conversion paths, with the icon of the application.
+        concurrency::create_task([]()
+        {
+            if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) return;
+
+            wchar_t modulePath[MAX_PATH]{};
+            HICON icon = nullptr;
+            if (GetModuleFileName(nullptr, modulePath, MAX_PATH) > 0 &&
+                SHDefExtractIcon(modulePath, 0, 0, &icon, nullptr, ::Imaging::IconCache::DefaultIconSize) == S_OK && icon)
+            {
+                try
+                {
+                    ::Imaging::IconHelper iconHelper{};
+                    OutputDebugHString(hstring(iconHelper.BenchmarkHICONConversion(icon, 1000)));
+                }
+                catch (const hresult_error& error)
+                {
+                    OutputDebugHString(L"Icon conversion benchmark failed: " + error.message());
+                }
+                DestroyIcon(icon);
+            }
+
+            CoUninitialize();
+        });
+    }
+#endif // BENCHMARK_ICON_CONVERSION
+
+#if MEASURE_METERS_FRAME_TIME
+    void MainWindow::MeasureMetersFrameTime(IInspectable const&, IInspectable const&)
+    {
+        // Handling CompositionTarget::Rendering makes XAML render every frame, the intervals show the frames delayed by the meters updates.
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (lastFrameTime != chrono::steady_clock::time_point())
+        {
+            double frameTime = chrono::duration<double, milli>(now - lastFrameTime).count();
+            frameTimeTotal += frameTime;
+            frameTimeMax = frameTime > frameTimeMax ? frameTime : frameTimeMax;
+            frameCount++;
+        }
+        lastFrameTime = now;
+
+        if (frameCount == 600)
+        {
+            OutputDebugHString(
+                hstring(USE_COMPOSITION_METERS ? L"Composition meters" : L"Storyboard meters") +
+                L" - frame time: avg " + to_hstring(frameTimeTotal / frameCount) + L" ms, max " + to_hstring(frameTimeMax) + L" ms" +
+                L" - peak meters update: avg " + to_hstring(peakMetersUpdateCount > 0 ? peakMetersUpdateTotal / peakMetersUpdateCount : 0.) + L" ms" +
+                L" (" + to_hstring(peakMetersUpdateCount) + L" updates)"
+            );
+
+            frameCount = 0;
+            frameTimeTotal = 0.;
+            frameTimeMax = 0.;
+            peakMetersUpdateCount = 0;
+            peakMetersUpdateTotal = 0.;
+        }
+    }
+#endif // MEASURE_METERS_FRAME_TIME
+
+    void MainWindow::UpdatePeakMeters()
+    {
+        if (!loaded) return;
+
+        // Follow the rate chosen by the metering engine. The interval is read before the snapshot: when it is 0 the snapshot resetting the
+        // meters has already been published. WakePeakMeters restarts the timer.
+        chrono::milliseconds interval = meteringEngine.PollingInterval();
+        if (interval.count() == 0)
+        {
+            frameClock.Stop(audioSessionsPeakClockToken);
+        }
+        else
+        {
+            frameClock.Period(audioSessionsPeakClockToken, interval);
+        }
+
+        // Peak values are polled by the metering engine on its own thread, the UI thread only reads the last published snapshot.
+        const PeakSnapshot& snapshot = meteringEngine.AcquireSnapshot();
+        if (snapshot.sequence == peakSnapshotSequence)
+        {
+            return;
+        }
+        peakSnapshotSequence = snapshot.sequence;
+
+#if MEASURE_METERS_FRAME_TIME
+        chrono::steady_clock::time_point updateStart = chrono::steady_clock::now();
+#endif // MEASURE_METERS_FRAME_TIME
+#if USE_SYNTHETIC_SESSIONS
+        chrono::steady_clock::time_point tickStart = chrono::steady_clock::now();
+        uint64_t tickAllocations = SyntheticSessionBenchmark::AllocationCount();
+#endif // USE_SYNTHETIC_SESSIONS
+
+        auto setMeters = [this](AudioSessionSlot& slot, const float4& levels, std::span<const float> channels)
+        {
+            if (compositionMeters)
+            {
+                // One property write per session, the clips and peak-hold markers are moved by the compositor.
+                compositionMeters.Set(slot.meterKey, levels);
+                if (slot.channelMeters)
+                {
+                    slot.view.SetChannelPeaks(levels.x, levels.y, array_view<const float>(channels.data(), static_cast<uint32_t>(channels.size())));
+                }
+            }
+            else
+            {
+                slot.view.SetChannelPeaks(levels.x, levels.y, array_view<const float>(channels.data(), static_cast<uint32_t>(channels.size())));
+                slot.view.SetPeakHold(levels.z, levels.w);
+            }
+        };
+
+        groupedPeakSlots.clear();
+        for (size_t i = 0; i < snapshot.Size(); i++)
+        {
+            AudioSessionSlot* snapshotSlot = FindSlot(snapshot.ids[i]);
+            if (!snapshotSlot)
+            {
+                continue;
+            }
+
+            // Hidden sessions keep their activity up to date.
+            AudioSessionSlot& slot = *snapshotSlot;
+            slot.activity = snapshot.activity[i];
+
+            float4 levels{ snapshot.left[i], snapshot.right[i], snapshot.leftHold[i], snapshot.rightHold[i] };
+            std::span<const float> channels = snapshot.Channels(i);
+            if (!slot.group || slot.group->Size() < 2)
+            {
+                if (slot.view)
+                {
+                    setMeters(slot, levels, channels);
+                }
+                continue;
+            }
+
+            // Group meters show the loudest member, accumulated here and set once every member has been read.
+            AudioSessionSlot* viewSlot = FindViewSlot(slot);
+            if (!viewSlot)
+            {
+                continue;
+            }
+
+            ChannelPeaks& groupChannels = viewSlot->groupChannels;
+            if (viewSlot->groupPeaksSequence != snapshot.sequence)
+            {
+                viewSlot->groupPeaksSequence = snapshot.sequence;
+                viewSlot->groupLevels = levels;
+                groupChannels = ChannelPeaks();
+                groupedPeakSlots.push_back(viewSlot);
+            }
+            else
+            {
+                float4& groupLevels = viewSlot->groupLevels;
+                groupLevels.x = levels.x > groupLevels.x ? levels.x : groupLevels.x;
+                groupLevels.y = levels.y > groupLevels.y ? levels.y : groupLevels.y;
+                groupLevels.z = levels.z > groupLevels.z ? levels.z : groupLevels.z;
+                groupLevels.w = levels.w > groupLevels.w ? levels.w : groupLevels.w;
+            }
+
+            uint32_t count = static_cast<uint32_t>(channels.size());
+            groupChannels.count = count > groupChannels.count ? count : groupChannels.count;
+            for (uint32_t channel = 0; channel < count; channel++)
+            {
+                groupChannels.values[channel] = channels[channel] > groupChannels.values[channel] ? channels[channel] : groupChannels.values[channel];
+            }
+        }
+
+        for (AudioSessionSlot* slot : groupedPeakSlots)
+        {
+            setMeters(*slot, slot->groupLevels, slot->groupChannels.Channels());
+        }
+
+#if MEASURE_METERS_FRAME_TIME
+        peakMetersUpdateTotal += chrono::duration<double, milli>(chrono::steady_clock::now() - updateStart).count();
+        peakMetersUpdateCount++;
+#endif // MEASURE_METERS_FRAME_TIME
+#if USE_SYNTHETIC_SESSIONS
+        if (syntheticSessions)
+        {
+            syntheticSessions->TickMeasured(chrono::steady_clock::now() - tickStart, SyntheticSessionBenchmark::AllocationCount() - tickAllocations);
+        }
+#endif // USE_SYNTHETIC_SESSIONS
+    }
+
+    void MainWindow::UpdateMainAudioEndpointPeakMeter()
+    {
+        if (!loaded || !mainAudioEndpoint) return;
+
+        try
+        {
+            pair<float, float> peakValues = mainAudioEndpoint->GetPeaks();
+            if (compositionMeters)
+            {
+                // Without a storyboard to smooth the values, the endpoint meter goes through the same ballistics as the sessions meters.
+                chrono::steady_clock::time_point now = chrono::steady_clock::now();
+                mainAudioEndpointBallistics.Prepare(clamp(
+                    chrono::duration_cast<chrono::milliseconds>(now - lastMainAudioEndpointPoll),
+                    chrono::milliseconds(1),
+                    chrono::milliseconds(1000)
+                ));
+                lastMainAudioEndpointPoll = now;
+                mainAudioEndpointBallistics.Step(mainAudioEndpointMeter[0], peakValues.first);
+                mainAudioEndpointBallistics.Step(mainAudioEndpointMeter[1], peakValues.second);
+
+                compositionMeters.Set(mainAudioEndpointMeterKey, float4(
+                    MeterBallistics::ToFloat(mainAudioEndpointMeter[0].level),
+                    MeterBallistics::ToFloat(mainAudioEndpointMeter[1].level),
+                    0.f,
+                    0.f
+                ));
+            }
+            else
+            {
+                LeftVolumeAnimation().To(static_cast<double>(peakValues.first));
+                RightVolumeAnimation().To(static_cast<double>(peakValues.second));
+                VolumeStoryboard().Begin();
+            }
+
+            // The endpoint is always active, its meter never stops but backs off to the idle rate when silent.
+            float peak = peakValues.first > peakValues.second ? peakValues.first : peakValues.second;
+            chrono::milliseconds interval = mainAudioEndpointPeakScheduler.Update(
+                1,
+                peak,
+                fabsf(peak - lastMainAudioEndpointPeak),
+                chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch())
+            );
+            lastMainAudioEndpointPeak = peak;
+
+            frameClock.Period(mainAudioEndpointPeakClockToken, interval);
+        }
+        catch (const hresult_error&)
+        {
+            // TODO: Handle error.
+        }
+    }
+
+    void MainWindow::SuspendPeakMeters(const PeakMetersSuspendReasons& reason)
+    {
+        bool running = peakMetersSuspendReasons == 0;
+        peakMetersSuspendReasons |= static_cast<uint32_t>(reason);
+        if (!running)
+        {
+            return;
+        }
+
+        frameClock.Stop(audioSessionsPeakClockToken);
+        frameClock.Stop(mainAudioEndpointPeakClockToken);
+        meteringEngine.Stop();
+
+        if (reason != PeakMetersSuspendReasons::Closing)
+        {
+            if (compositionMeters)
+            {
+                mainAudioEndpointMeter[0] = MeterChannelState();
+                mainAudioEndpointMeter[1] = MeterChannelState();
+                compositionMeters.Set(mainAudioEndpointMeterKey, float4::zero());
+
+                for (AudioSessionSlot& slot : audioSessionSlots)
+                {
+                    if (!slot.meterKey.empty())
+                    {
+                        compositionMeters.Set(slot.meterKey, float4::zero());
+                    }
+                }
+            }
+            else
+            {
+                LeftVolumeAnimation().To(0.);
+                RightVolumeAnimation().To(0.);
+                VolumeStoryboard().Begin();
+
+                for (auto&& view : audioSessionViews)
+                {
+                    view.SetPeak(0, 0);
+                    view.SetPeakHold(0, 0);
+                }
+            }
+        }
+    }
+
+    void MainWindow::ResumePeakMeters(const PeakMetersSuspendReasons& reason)
+    {
+        if (peakMetersSuspendReasons == 0)
+        {
+            return;
+        }
+
+        peakMetersSuspendReasons &= ~static_cast<uint32_t>(reason);
+        if (peakMetersSuspendReasons != 0)
+        {
+            return;
+        }
+
+        if (mainAudioEndpoint)
+        {
+            StartMainAudioEndpointPeakMeter();
+        }
+
+        if (audioSessions.get())
+        {
+            meteringEngine.Start();
+            WakePeakMeters();
+        }
+    }
+
+    void MainWindow::WakePeakMeters()
+    {
+        if (peakMetersSuspendReasons != 0 || !audioSessions.get())
+        {
+            return;
+        }
+
+        meteringEngine.Wake();
+        if (frameClock.IsRunning(audioSessionsPeakClockToken))
+        {
+            frameClock.Period(audioSessionsPeakClockToken, meteringEngine.PollingInterval());
+        }
+        else
+        {
+            frameClock.Start(audioSessionsPeakClockToken, meteringEngine.PollingInterval());
+        }
+    }
+
+    void MainWindow::StartMainAudioEndpointPeakMeter()
+    {
+        if (!mainAudioEndpoint)
+        {
+            return;
+        }
+
+        mainAudioEndpointPeakScheduler.Wake(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()));
+        frameClock.Start(mainAudioEndpointPeakClockToken, mainAudioEndpointPeakScheduler.Settings().normalInterval);
+        lastMainAudioEndpointPoll = chrono::steady_clock::now();
+        if (!compositionMeters)
+        {
+            VolumeStoryboard().Begin();
+        }
+    }
+
+    void MainWindow::AppWindow_Closing(winrt::Microsoft::UI::Windowing::AppWindow, winrt::Microsoft::UI::Windowing::AppWindowClosingEventArgs)
+    {
+        SuspendPeakMeters(PeakMetersSuspendReasons::Closing);
+        frameClock.Unregister(audioSessionsPeakClockToken);
+        frameClock.Unregister(mainAudioEndpointPeakClockToken);
+        frameClock.Unregister(newAudioSessionsClockToken);
+        frameClock.Unregister(audioSessionsResyncClockToken);
+        frameClock.Unregister(sessionEventsClockToken);
+        meteringEngine.ClearSessions();
+
+#if USE_SYNTHETIC_SESSIONS
+        // Stops raising events before the sessions are unregistered.
+        frameClock.Unregister(syntheticSessionsReportClockToken);
+        syntheticSessions.reset();
+#endif // USE_SYNTHETIC_SESSIONS
+
+        VolumeStoryboard().Stop();
+        // Writes the last requested volumes before they are saved and the sessions and the endpoint are released.
+        volumeWriter.Stop();
+
+        // Clean up ComPtr/IUnknown objects
+        if (audioController)
+        {
+            if (mainAudioEndpoint)
+            {
+                mainAudioEndpoint->VolumeChanged(mainAudioEndpointVolumeChangedToken);
+                mainAudioEndpoint->Unregister();
                 mainAudioEndpoint->Release();
             }
 
             audioController->EndpointChanged(audioControllerEndpointChangedToken);
+            audioController->EndpointsChanged(audioControllerEndpointsChangedToken);
             audioController->SessionAdded(audioControllerSessionAddedToken);
 
             audioController->Unregister();
@@ -1864,13 +2552,24 @@ namespace winrt::SND_Vol::implementation
 
             SaveAudioLevels();
 
+            for (AudioSessionSlot& slot : audioSessionSlots)
+            {
+                UnregisterAudioSession(slot);
+            }
             for (size_t i = 0; i < audioSessions->size(); i++)
             {
-                audioSessions->at(i)->VolumeChanged(audioSessionVolumeChanged[audioSessions->at(i)->Id()]);
-                audioSessions->at(i)->StateChanged(audioSessionsStateChanged[audioSessions->at(i)->Id()]);
-                audioSessions->at(i)->Unregister();
                 audioSessions->at(i)->Release();
             }
+            ClearAudioSessionsIndex();
+        }
+
+        try
+        {
+            System::ProcessMetadataCache::Current().Save(System::ProcessMetadataCache::DefaultPath());
+        }
+        catch (const hresult_error& error)
+        {
+            OutputDebugHString(L"Failed to save process metadata cache: " + error.message());
         }
 
         SaveSettings();
@@ -1886,185 +2585,319 @@ namespace winrt::SND_Vol::implementation
         });
     }
 
-    void MainWindow::AudioSession_VolumeChanged(const winrt::guid& id, const float& newVolume)
+    void MainWindow::AudioSession_VolumeChanged(const System::SlotHandle& handle, const float& newVolume)
     {
         if (!loaded) return;
 
-        DispatcherQueue().TryEnqueue([this, id, newVolume]()
+        if (sessionEvents.Volume(handle, newVolume))
         {
-            for (auto const& view : audioSessionViews)
-            {
-                if (view.Id() == id)
+            ScheduleAudioSessionEventsFlush();
+        }
+    }
+
+    void MainWindow::AudioSession_StateChanged(const System::SlotHandle& handle, const uint32_t& state)
+    {
+        if (!loaded) return;
+
+        // The state channel carries both the raw session states (inactive, active, expired) and AudioSessionStates flags.
+        bool schedule = false;
+        switch (state)
+        {
+            case static_cast<uint32_t>(AudioSessionStates::Muted):
+                schedule = sessionEvents.Mute(handle, true);
+                break;
+
+            case static_cast<uint32_t>(AudioSessionStates::Unmuted):
+                schedule = sessionEvents.Mute(handle, false);
+                break;
+
+            case static_cast<uint32_t>(AudioSessionStates::Expired):
+                schedule = sessionEvents.State(handle, ::AudioSessionState::AudioSessionStateExpired);
+                break;
+
+            case static_cast<uint32_t>(AudioSessionStates::DisplayNameChanged):
+                schedule = sessionEvents.Changed(handle, SessionEventFlags::DisplayName);
+                break;
+
+            case static_cast<uint32_t>(AudioSessionStates::IconChanged):
+                schedule = sessionEvents.Changed(handle, SessionEventFlags::Icon);
+                break;
+
+            default:
+                if (state <= static_cast<uint32_t>(::AudioSessionState::AudioSessionStateExpired))
                 {
-                    view.Volume(static_cast<double>(newVolume) * 100.0);
+                    schedule = sessionEvents.State(handle, static_cast<::AudioSessionState>(state));
                 }
+                break;
+        }
+
+        if (schedule)
+        {
+            ScheduleAudioSessionEventsFlush();
+        }
+    }
+
+    void MainWindow::ScheduleAudioSessionEventsFlush()
+    {
+        // Only the first change of a batch gets here, the changes recorded until the flush ride along.
+        DispatcherQueue().TryEnqueue([this]()
+        {
+            if (!frameClock.IsRunning(sessionEventsClockToken))
+            {
+                frameClock.Start(sessionEventsClockToken, System::FrameClock::FrameInterval);
             }
         });
     }
 
-    void MainWindow::AudioSession_StateChanged(const winrt::guid& id, const uint32_t& state)
+    void MainWindow::FlushAudioSessionEvents()
     {
-        if (!loaded) return;
-
-        // Cast state to AudioSessionState, uint32_t is only used to cross ABI
-        AudioSessionState audioState = (AudioSessionState)state;
-        if (audioState == AudioSessionState::Expired || audioState == AudioSessionState::Active)
+        size_t dropped = 0;
+        sessionEvents.Drain(pendingSessionEvents);
+        for (const SessionEvents& events : pendingSessionEvents)
         {
-            audioSessionsPeakTimer.Stop();
+            // A stale handle means that the session has been removed since its events were recorded.
+            AudioSessionSlot* slot = audioSessionSlots.Get(events.handle);
+            if (!slot)
+            {
+                dropped++;
+                continue;
+            }
 
-            unique_lock lock{ audioSessionsMutex };
+            // Members of a group are shown by the view of the group.
+            AudioSession* session = slot->session;
+            AudioSessionSlot* viewSlot = FindViewSlot(*slot);
+            AudioSessionView view = viewSlot ? viewSlot->view : nullptr;
+            AudioSessionGroup* group = slot->group && slot->group->Size() > 1 ? slot->group : nullptr;
+#if USE_SYNTHETIC_SESSIONS
+            if (syntheticSessions)
+            {
+                syntheticSessions->EventHandled(session->Name());
+            }
+#endif // USE_SYNTHETIC_SESSIONS
 
-            GUID sessionID = id;
-            for (size_t i = 0; i < audioSessions->size(); i++)
+            if (slot->view && events.Has(SessionEventFlags::DisplayName))
             {
-                if (audioSessions->at(i)->Id() == sessionID)
-                {
-                    if (audioState == AudioSessionState::Active)
-                    {
-                        // Check if the newly active session is added to the UI, if not I need to add it as it might been skipped because of grouping params and the session being inactive at the time.
-                        bool added = false;
-                        for (auto const& view : audioSessionViews)
-                        {
-                            if (view.Id() == id)
-                            {
-                                added = true;
-                                break;
-                            }
-                        }
+                slot->view.Header(session->Name());
+            }
+            if (slot->view && events.Has(SessionEventFlags::Icon))
+            {
+                UpdateAudioSessionLogo(*slot);
+            }
 
-                        if (!added)
-                        {
-                            lock.unlock();
-                            
-                            DispatcherQueue().TryEnqueue([this, sessionID]() // I do the same thing twice, but i can't assume that the index of the audio session will remain the same
-                            {
-                                unique_lock lock{ audioSessionsMutex };
-                                for (size_t i = 0; i < audioSessions->size(); i++)
-                                {
-                                    if (audioSessions->at(i)->Id() == sessionID)
-                                    {
-                                        if (AudioSessionView view = CreateAudioSessionView(audioSessions->at(i), true))
-                                        {
-                                            audioSessionViews.InsertAt(0, view);
-                                        }
-                                    }
-                                }
-                            });
+            if (view && events.Has(SessionEventFlags::Volume))
+            {
+                // A group shows its loudest member, a member changed by another application does not change its siblings.
+                SetViewVolume(view, group ? group->Volume() : events.volume);
+            }
+            if (view && events.Has(SessionEventFlags::Mute))
+            {
+                // A group is muted when all its members are.
+                view.Muted(group ? group->Muted() : events.muted);
+            }
+
+            if (!events.Has(SessionEventFlags::State))
+            {
+                continue;
+            }
 
-                            // The function exists here since the code in DispatcherQueue().TryEnqueue() relies on finding an AudioSessionView with the matching id. Or I found that the AudioSessionView with the given id does not exists.
-                            audioSessionsPeakTimer.Start();
-                            return;
+            switch (events.state)
+            {
+                case ::AudioSessionState::AudioSessionStateActive:
+                    WakePeakMeters();
+
+                    if (!view)
+                    {
+                        // The session might not have a view if it has been skipped because of grouping params and the session being inactive at the time.
+                        if (AudioSessionView newView = CreateAudioSessionView(session, true))
+                        {
+                            audioSessionViews.InsertAt(0, newView);
+                            IndexAudioSession(session, newView);
                         }
+                        break;
                     }
-                    else
+                    view.SetState(AudioSessionState::Active);
+                    break;
+
+                case ::AudioSessionState::AudioSessionStateInactive:
+                    if (view)
                     {
-                        // The audio session is expired 
-                        AudioSession* session = audioSessions->at(i);
-                        session->Unregister();
-                        session->Release();
-                        audioSessions->erase(audioSessions->begin() + i);
+                        view.SetState(group && group->IsActive() ? AudioSessionState::Active : AudioSessionState::Inactive);
                     }
+                    break;
 
+                case ::AudioSessionState::AudioSessionStateExpired:
+                    // Invalidates slot, the other pending changes are looked up by handle.
+                    RemoveAudioSession(guid(session->Id()));
+                    if (audioSessionViews.Size() == 0)
+                    {
+                        WindowMessageBar().EnqueueString(L"All sessions expired.");
+                    }
                     break;
-                }
             }
+        }
 
-            audioSessionsPeakTimer.Start();
+        if (dropped > 0)
+        {
+            sessionEvents.Dropped(dropped);
         }
+    }
 
-        DispatcherQueue().TryEnqueue([this, id, audioState]()
+    void MainWindow::AudioController_SessionAdded(IInspectable, IInspectable)
+    {
+        // Raised once per batch of new sessions. The sessions are taken on the next frame, so that sessions created together (a browser
+        // opening several tabs) are added in one update.
+        DispatcherQueue().TryEnqueue([this]()
         {
-            for (auto const& view : audioSessionViews)
+            if (!frameClock.IsRunning(newAudioSessionsClockToken))
             {
-                if (view.Id() == id)
-                {
-                    switch (audioState)
-                    {
-                        case AudioSessionState::Muted:
-                            view.Muted(true);
-                            break;
+                frameClock.Start(newAudioSessionsClockToken, System::FrameClock::FrameInterval);
+            }
+        });
+    }
 
-                        case AudioSessionState::Unmuted:
-                            view.Muted(false);
-                            break;
+    void MainWindow::AddNewAudioSessions()
+    {
+        newAudioSessions.clear();
+        if (audioController && audioController->NewSessions(newAudioSessions) > 0)
+        {
+            AddAudioSessions(newAudioSessions);
+        }
+    }
 
-                        case AudioSessionState::Active:
-                        case AudioSessionState::Inactive:
-                            view.SetState(audioState);
-                            break;
+    void MainWindow::AddAudioSessions(const vector<AudioSession*>& sessions)
+    {
+        // TODO: Reorder audio sessions according to the currently loaded audio profile (if any).
+        if (sessions.empty())
+        {
+            return;
+        }
 
-                        case AudioSessionState::Expired:
-                            uint32_t indexOf = 0;
-                            if (audioSessionViews.IndexOf(view, indexOf))
-                            {
-                                audioSessionViews.RemoveAt(indexOf);
+        vector<pair<AudioSession*, AudioSessionView>> newViews{};
+        for (AudioSession* newSession : sessions)
+        {
+            IndexAudioSession(newSession, nullptr);
+            {
+                unique_lock lock{ audioSessionsMutex };
+                FindSlot(newSession->Id())->listIndex = audioSessions->size();
+                audioSessions->push_back(newSession);
+            }
+            meteringEngine.AddSession(newSession);
+#if USE_SYNTHETIC_SESSIONS
+            if (syntheticSessions)
+            {
+                syntheticSessions->EventHandled(newSession->Name());
+            }
+#endif // USE_SYNTHETIC_SESSIONS
 
-                                if (audioSessionViews.Size() == 0)
-                                {
-                                    WindowMessageBar().EnqueueString(L"All sessions expired.");
-                                }
-                            }
-                            break;
-                    }
+            if (AudioSessionView view = CreateAudioView(newSession))
+            {
+                // Indexed now so that the next members of the group find the view, the meters are bound once the views are in the list.
+                FindSlot(newSession->Id())->view = view;
+                newViews.push_back({ newSession, view });
+            }
+        }
 
-                    return;
-                }
+        if (newViews.size() == 1)
+        {
+            audioSessionViews.InsertAt(0, newViews[0].second);
+        }
+        else if (newViews.size() > 1)
+        {
+            // A single reset instead of one insertion per view. Newest sessions first, like the views inserted one by one at the top of the list.
+            vector<AudioSessionView> views{};
+            views.reserve(newViews.size() + audioSessionViews.Size());
+            for (auto it = newViews.rbegin(); it != newViews.rend(); it++)
+            {
+                views.push_back(it->second);
             }
-        });
+            for (const AudioSessionView& view : audioSessionViews)
+            {
+                views.push_back(view);
+            }
+            audioSessionViews.ReplaceAll(views);
+        }
+
+        for (const auto& [newSession, view] : newViews)
+        {
+            IndexAudioSession(newSession, view);
+        }
+
+        // Subscribed to the state changes above, the resolved metadata cannot be missed.
+        audioController->ResolveMetadata(sessions);
+
+        WakePeakMeters();
     }
 
-    void MainWindow::AudioController_SessionAdded(IInspectable, IInspectable)
+    void MainWindow::ResyncAudioSessions()
     {
-        // TODO: Reorder audio sessions according to the currently loaded audio profile (if any).
-        DispatcherQueue().TryEnqueue([this]()
+        vector<AudioSession*> sessions{};
         {
-            audioSessionsPeakTimer.Stop();
-            while (AudioSession* newSession = audioController->NewSession())
+            unique_lock lock{ audioSessionsMutex };
+            if (!audioSessions)
             {
-                {
-                    unique_lock lock{ audioSessionsMutex };
-                    audioSessions->push_back(newSession);
-                }
+                return;
+            }
 
-                AudioSessionView view = CreateAudioView(newSession);
-                if (view)
-                {
-                    audioSessionViews.InsertAt(0, view);
-                }
+            sessions.reserve(audioSessions->size());
+            for (AudioSession* session : *audioSessions)
+            {
+                session->AddRef();
+                sessions.push_back(session);
+            }
+        }
+
+        // Reads go to the audio service, off the UI thread. Corrections come back through the sessions events.
+        concurrency::create_task([sessions = move(sessions)]()
+        {
+            for (AudioSession* session : sessions)
+            {
+                session->Resync();
+                session->Release();
             }
-            audioSessionsPeakTimer.Start();
+        });
+    }
+
+    void MainWindow::AudioController_EndpointsChanged(IInspectable, IInspectable)
+    {
+        // Sessions of a closed endpoint are gone from the enumeration, sessions of an opened endpoint are new.
+        DispatcherQueue().TryEnqueue([this]()
+        {
+            ReloadAudioSessions();
         });
     }
 
     void MainWindow::AudioController_EndpointChanged(IInspectable, IInspectable)
     {
-        // Stop animation while getting the new audio endpoint.
-        mainAudioEndpointPeakTimer.Stop();
+        // The whole swap runs on the UI thread: the endpoint peak meter is updated by the frame clock of the UI thread, the old endpoint is only
+        // released once its clock entry is stopped.
+        DispatcherQueue().TryEnqueue([this]()
+        {
+            frameClock.Stop(mainAudioEndpointPeakClockToken);
 
-        mainAudioEndpoint->VolumeChanged(mainAudioEndpointVolumeChangedToken);
-        mainAudioEndpoint->StateChanged(mainAudioEndpointStateChangedToken);
-        mainAudioEndpoint->Unregister();
-        mainAudioEndpoint->Release();
+            mainAudioEndpoint->VolumeChanged(mainAudioEndpointVolumeChangedToken);
+            mainAudioEndpoint->StateChanged(mainAudioEndpointStateChangedToken);
+            mainAudioEndpoint->Unregister();
+            mainAudioEndpoint->Release();
 
-        mainAudioEndpoint = audioController->GetMainAudioEndpoint();
-        if (mainAudioEndpoint->Register())
-        {
-            // Register to events.
-            mainAudioEndpointVolumeChangedToken = mainAudioEndpoint->VolumeChanged({ this, &MainWindow::MainAudioEndpoint_VolumeChanged });
-            mainAudioEndpointStateChangedToken = mainAudioEndpoint->StateChanged([this](IInspectable, bool muted)
+            mainAudioEndpoint = audioController->GetMainAudioEndpoint();
+            if (mainAudioEndpoint->Register())
             {
-                DispatcherQueue().TryEnqueue([this, muted]()
+                // Register to events.
+                mainAudioEndpointVolumeChangedToken = mainAudioEndpoint->VolumeChanged({ this, &MainWindow::MainAudioEndpoint_VolumeChanged });
+                mainAudioEndpointStateChangedToken = mainAudioEndpoint->StateChanged([this](IInspectable, bool muted)
                 {
-                    MuteToggleButton().IsChecked(mainAudioEndpoint->Muted());
-                    MuteToggleButtonFontIcon().Glyph(muted ? L"\ue74f" : L"\ue767");
+                    DispatcherQueue().TryEnqueue([this, muted]()
+                    {
+                        MuteToggleButton().IsChecked(mainAudioEndpoint->Muted());
+                        MuteToggleButtonFontIcon().Glyph(muted ? L"\ue74f" : L"\ue767");
+                    });
                 });
-            });
-        }
-
+            }
 
-        DispatcherQueue().TryEnqueue([&]()
-        {
-            mainAudioEndpointPeakTimer.Start();
+            if (peakMetersSuspendReasons == 0)
+            {
+                StartMainAudioEndpointPeakMeter();
+            }
 
             MainEndpointNameTextBlock().Text(mainAudioEndpoint->Name());
             SystemVolumeSlider().Value(static_cast<double>(mainAudioEndpoint->Volume()) * 100.);
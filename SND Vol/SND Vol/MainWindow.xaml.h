@@ -3,9 +3,23 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include "AudioSession.h"
+#include "AudioSessionGroup.h"
+#include "AudioMeteringEngine.h"
+#include "CompositionMeters.h"
+#include "FrameClock.h"
+#include "GuidHash.h"
+#include "IconAtlas.h"
 #include "LegacyAudioController.h"
 #include "MainAudioEndpoint.h"
+#include "MeterBallistics.h"
+#include "PeakPollingScheduler.h"
+#include "SessionEventCoalescer.h"
+#include "SlotMap.h"
+#include "SyntheticAudioSession.h"
+#include "VolumeWriter.h"
 #include "HotKey.h"
 
 using namespace winrt::Windows::System;
@@ -70,11 +84,62 @@ namespace winrt::SND_Vol::implementation
         void CloseProfilesButton_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
         void OpenProfilesButton_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
         void RootGrid_ActualThemeChanged(winrt::Microsoft::UI::Xaml::FrameworkElement const& sender, winrt::Windows::Foundation::IInspectable const& args);
+        void XamlRoot_Changed(winrt::Microsoft::UI::Xaml::XamlRoot const& sender, winrt::Microsoft::UI::Xaml::XamlRootChangedEventArgs const& args);
         void NewContentButton_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
 
     private:
         using BackdropController = winrt::Microsoft::UI::Composition::SystemBackdrops::DesktopAcrylicController;
 
+        /**
+         * @brief Record of an audio session: the session, its view, its events subscriptions and its metering state. The view is null when
+         * the session is not displayed.
+        */
+        struct AudioSessionSlot
+        {
+            winrt::SND_Vol::AudioSessionView view{ nullptr };
+            Audio::AudioSession* session = nullptr;
+            winrt::event_token volumeChangedToken{};
+            winrt::event_token stateChangedToken{};
+            /**
+             * @brief Position of the session in audioSessions.
+            */
+            size_t listIndex = 0;
+            /**
+             * @brief Entry of the session in the composition meters property set, kept while the view is hidden.
+            */
+            winrt::hstring meterKey{};
+            bool channelMeters = false;
+            /**
+             * @brief Last activity statistics published by the metering engine (average level, loudness, last sound), for sorting and auto-hide.
+            */
+            Audio::PeakHistoryStatistics activity{};
+            /**
+             * @brief Group of sessions sharing the grouping parameter of the session. Only one member of a group has a view, it controls the whole group.
+            */
+            Audio::AudioSessionGroup* group = nullptr;
+            /**
+             * @brief Logo the view of the slot references in the icon atlas, empty if none.
+            */
+            std::wstring logoPath{};
+            // Group meter accumulated over the members during a peak meters update (UpdatePeakMeters), only used by the slot owning the group view.
+            uint64_t groupPeaksSequence = 0;
+            winrt::Windows::Foundation::Numerics::float4 groupLevels{};
+            Audio::ChannelPeaks groupChannels{};
+        };
+
+        /**
+         * @brief Reasons for the peak meters to be suspended, the meters run only when no reason is set.
+        */
+        enum class PeakMetersSuspendReasons : uint32_t
+        {
+            NotLoaded = 0x1,
+            AnimationsDisabled = 0x2,
+            UserAbsent = 0x4,
+            WindowDeactivated = 0x8,
+            Reloading = 0x10,
+            Closing = 0x20
+        };
+
         // Static fields
         static winrt::SND_Vol::MainWindow singleton;
 
@@ -84,12 +149,35 @@ namespace winrt::SND_Vol::implementation
         Audio::MainAudioEndpoint* mainAudioEndpoint = nullptr;
         Audio::LegacyAudioController* audioController = nullptr;
         std::unique_ptr<std::vector<Audio::AudioSession*>> audioSessions{ nullptr };
+        Audio::AudioMeteringEngine meteringEngine{ Audio::PeakPollingSettings(), Audio::MeterBallisticsSettings() };
+        uint64_t peakSnapshotSequence = 0;
+        Audio::PeakPollingScheduler mainAudioEndpointPeakScheduler{};
+        float lastMainAudioEndpointPeak = 0.f;
+        Audio::MeterBallistics mainAudioEndpointBallistics{};
+        Audio::MeterChannelState mainAudioEndpointMeter[2]{};
+        std::chrono::steady_clock::time_point lastMainAudioEndpointPoll{};
+        uint32_t peakMetersSuspendReasons = static_cast<uint32_t>(PeakMetersSuspendReasons::NotLoaded);
+        /**
+         * @brief Records of the indexed sessions. Only read and written from the UI thread. The session events are subscribed with the handle
+         * of their record: events dispatched after the removal of the session are dropped.
+        */
+        System::SlotMap<AudioSessionSlot> audioSessionSlots{};
+        /**
+         * @brief Session id -> handle of the session record, for the lookups by id (views, metering snapshots).
+        */
+        std::unordered_map<winrt::guid, System::SlotHandle, GuidHash> audioSessionHandles{};
+        /**
+         * @brief Grouping parameter -> sessions of the group. Only read and written from the UI thread, with the sessions index.
+        */
+        Audio::AudioSessionGroupIndex audioSessionGroups{};
+        // Slots owning a group view whose meter has been accumulated during the current peak meters update.
+        std::vector<AudioSessionSlot*> groupedPeakSlots{};
         winrt::event_token mainAudioEndpointVolumeChangedToken;
         winrt::event_token mainAudioEndpointStateChangedToken;
         winrt::event_token audioControllerSessionAddedToken;
         winrt::event_token audioControllerEndpointChangedToken;
-        std::map<winrt::guid, winrt::event_token> audioSessionVolumeChanged{};
-        std::map<winrt::guid, winrt::event_token> audioSessionsStateChanged{};
+        winrt::event_token audioControllerEndpointsChangedToken;
+        winrt::event_token xamlRootChangedToken{};
         // Hot keys.
         System::HotKey volumeUpHotKeyPtr{ VirtualKeyModifiers::Control | VirtualKeyModifiers::Shift, VK_UP };
         System::HotKey volumeDownHotKeyPtr{ VirtualKeyModifiers::Control | VirtualKeyModifiers::Shift, VK_DOWN };
@@ -100,6 +188,10 @@ namespace winrt::SND_Vol::implementation
         bool loaded = false;
         bool compact = false;
         bool usingCustomTitleBar = false;
+        /**
+         * @brief True while a session view volume is set from the audio service (SetViewVolume), the slider change is not written back.
+        */
+        bool settingViewVolume = false;
         uint16_t layout = 0;
         winrt::SND_Vol::AudioSessionState globalSessionAudioState = winrt::SND_Vol::AudioSessionState::Unmuted;
         winrt::Windows::Graphics::RectInt32 displayRect;
@@ -109,9 +201,40 @@ namespace winrt::SND_Vol::implementation
         winrt::Windows::System::DispatcherQueueController dispatcherQueueController = nullptr;
         winrt::Microsoft::UI::Composition::SystemBackdrops::SystemBackdropConfiguration systemBackdropConfiguration = nullptr;
         winrt::Microsoft::UI::Xaml::FrameworkElement::ActualThemeChanged_revoker themeChangedRevoker;
-        winrt::Microsoft::UI::Dispatching::DispatcherQueueTimer audioSessionsPeakTimer = nullptr;
-        winrt::Microsoft::UI::Dispatching::DispatcherQueueTimer mainAudioEndpointPeakTimer = nullptr;
         #pragma endregion
+        System::FrameClock& frameClock{ System::FrameClock::GetForCurrentThread() };
+        uint32_t audioSessionsPeakClockToken = 0;
+        uint32_t mainAudioEndpointPeakClockToken = 0;
+        uint32_t newAudioSessionsClockToken = 0;
+        uint32_t audioSessionsResyncClockToken = 0;
+        uint32_t sessionEventsClockToken = 0;
+        /**
+         * @brief Changes notified by the sessions since the last flush, applied once per frame by FlushAudioSessionEvents.
+        */
+        Audio::SessionEventCoalescer sessionEvents{};
+        Audio::VolumeWriter volumeWriter{};
+        /**
+         * @brief Session logos, shared by the views.
+        */
+        ::Imaging::IconAtlas iconAtlas{};
+        /**
+         * @brief Rasterization scale the logos are decoded at. Ahead of the icon atlas while the logos are decoded for a new scale (ScaleIconAtlas).
+        */
+        double logoScale = 1.;
+        std::vector<Audio::SessionEvents> pendingSessionEvents{};
+        std::vector<Audio::AudioSession*> newAudioSessions{};
+        ::Rendering::CompositionMeters compositionMeters{};
+        winrt::hstring mainAudioEndpointMeterKey{};
+        // Frame time measurement (MEASURE_METERS_FRAME_TIME).
+        std::chrono::steady_clock::time_point lastFrameTime{};
+        uint32_t frameCount = 0;
+        double frameTimeTotal = 0.;
+        double frameTimeMax = 0.;
+        uint32_t peakMetersUpdateCount = 0;
+        double peakMetersUpdateTotal = 0.;
+        // Synthetic sessions benchmark (USE_SYNTHETIC_SESSIONS).
+        std::unique_ptr<::Audio::SyntheticSessionBenchmark> syntheticSessions{};
+        uint32_t syntheticSessionsReportClockToken = 0;
         winrt::Windows::Foundation::Collections::IObservableVector<winrt::SND_Vol::AudioSessionView> audioSessionViews
         {
             winrt::multi_threaded_observable_vector<winrt::SND_Vol::AudioSessionView>()
@@ -131,14 +254,110 @@ namespace winrt::SND_Vol::implementation
         void SaveSettings();
         void LoadProfile(const hstring& profileName);
         void ReloadAudioSessions();
+        void IndexAudioSession(Audio::AudioSession* audioSession, winrt::SND_Vol::AudioSessionView const& view);
+        /**
+         * @brief Registers an indexed session to its system notifications and subscribes to its events.
+         * @return False if the session could not be registered
+        */
+        bool RegisterAudioSession(Audio::AudioSession* audioSession);
+        /**
+         * @brief Unsubscribes from the events of a session and unregisters it from its system notifications.
+        */
+        void UnregisterAudioSession(AudioSessionSlot& slot);
+        AudioSessionSlot* FindSlot(const winrt::guid& id);
+        /**
+         * @brief Finds the view controlling a session: its own view, or the view of its group.
+        */
+        winrt::SND_Vol::AudioSessionView FindAudioSessionView(const winrt::guid& id);
+        /**
+         * @brief Finds the slot owning the view that controls a session: the slot itself if it has a view, or the slot of the group member that has one.
+         * @return Slot, nullptr if neither the session nor its group has a view
+        */
+        AudioSessionSlot* FindViewSlot(AudioSessionSlot& slot);
+        /**
+         * @brief Shows a volume on a session view without writing it back to the sessions of the view.
+         * @param view Session view
+         * @param volume Volume ∈ [0, 1]
+        */
+        void SetViewVolume(const winrt::SND_Vol::AudioSessionView& view, const float& volume);
+        Audio::AudioSession* FindAudioSession(const winrt::guid& id);
+        void RemoveAudioSession(const winrt::guid& id);
+        /**
+         * @brief Clears the sessions index and releases the composition meters entries and the logos of the sessions.
+        */
+        void ClearAudioSessionsIndex();
+        /**
+         * @brief Shows the logo of the session in the view of the slot, from the icon atlas.
+        */
+        void UpdateAudioSessionLogo(AudioSessionSlot& slot);
+        /**
+         * @brief Releases the icon atlas entry referenced by the view of the slot.
+        */
+        void ReleaseAudioSessionLogo(AudioSessionSlot& slot);
+        /**
+         * @brief Decodes the logos of the icon atlas for a new rasterization scale on a background task, then rebuilds the atlas with them.
+        */
+        void ScaleIconAtlas(const double& rasterizationScale);
+        /**
+         * @brief Takes the sessions created since the last call and adds them (see AddAudioSessions).
+        */
+        void AddNewAudioSessions();
+        /**
+         * @brief Indexes and meters new sessions, and adds their views at the top of the list in a single collection update.
+         * @param sessions New sessions
+        */
+        void AddAudioSessions(const std::vector<Audio::AudioSession*>& sessions);
+        /**
+         * @brief Corrects the cached volume, mute and state of every audio session, in the background.
+        */
+        void ResyncAudioSessions();
+        /**
+         * @brief Steps the system volume (hot keys), through the volume writer.
+         * @param step Volume step, negative to lower the volume
+        */
+        void StepMainAudioEndpointVolume(const float& step);
+        /**
+         * @brief Schedules FlushAudioSessionEvents on the next frame. Can be called from any thread.
+        */
+        void ScheduleAudioSessionEventsFlush();
+        /**
+         * @brief Applies the pending session changes to the views.
+        */
+        void FlushAudioSessionEvents();
+        void BenchmarkSessionsIndex();
+        /**
+         * @brief Measures the icon conversion paths (BMP round trip and direct copy) on the icon of the application, on a worker thread.
+        */
+        void BenchmarkIconConversion();
+        /**
+         * @brief Accumulates the frame intervals and the peak meters update cost, and prints the averages every 600 frames.
+        */
+        void MeasureMetersFrameTime(winrt::Windows::Foundation::IInspectable const& sender, winrt::Windows::Foundation::IInspectable const& args);
+        /**
+         * @brief Stops the peak meters timers and the metering engine, and resets the meters.
+         * @param reason Reason for the suspension, the meters stay suspended until every reason has been resumed
+        */
+        void SuspendPeakMeters(const PeakMetersSuspendReasons& reason);
+        /**
+         * @brief Clears a suspension reason and restarts the peak meters if it was the last one.
+         * @param reason Reason to clear
+        */
+        void ResumePeakMeters(const PeakMetersSuspendReasons& reason);
+        /**
+         * @brief Restarts the audio sessions meters after the metering engine stopped for lack of active sessions.
+        */
+        void WakePeakMeters();
+        void StartMainAudioEndpointPeakMeter();
 
         void AppWindow_Closing(winrt::Microsoft::UI::Windowing::AppWindow, winrt::Microsoft::UI::Windowing::AppWindowClosingEventArgs);
-        void UpdatePeakMeters(winrt::Windows::Foundation::IInspectable /*sender*/, winrt::Windows::Foundation::IInspectable /*args*/);
+        void UpdatePeakMeters();
+        void UpdateMainAudioEndpointPeakMeter();
         void MainAudioEndpoint_VolumeChanged(winrt::Windows::Foundation::IInspectable /*sender*/, const float& newVolume);
-        void AudioSession_VolumeChanged(const winrt::guid& sender, const float& newVolume);
-        void AudioSession_StateChanged(const winrt::guid& sender, const uint32_t& state);
+        void AudioSession_VolumeChanged(const System::SlotHandle& handle, const float& newVolume);
+        void AudioSession_StateChanged(const System::SlotHandle& handle, const uint32_t& state);
         void AudioController_SessionAdded(winrt::Windows::Foundation::IInspectable /*sender*/, winrt::Windows::Foundation::IInspectable /*args*/);
         void AudioController_EndpointChanged(winrt::Windows::Foundation::IInspectable /*sender*/, winrt::Windows::Foundation::IInspectable /*args*/);
+        void AudioController_EndpointsChanged(winrt::Windows::Foundation::IInspectable /*sender*/, winrt::Windows::Foundation::IInspectable /*args*/);
     };
 }
 
@@ -17,12 +17,17 @@ namespace winrt::SND_Vol::implementation
     {
         InitializeComponent();
 
-        timer = DispatcherQueue().CreateTimer();
         auto duration = (Application::Current().Resources().Lookup(box_value(L"MessageBarIntervalSeconds")).as<int32_t>() * 1000) + 150;
-        timer.Interval(
-            std::chrono::milliseconds(duration)
-        );
-        timer.Tick({ this, &MessageBar::DispatcherQueueTimer_Tick });
+        interval = std::chrono::milliseconds(duration);
+        clockToken = frameClock.Register(System::FrameClockPriority::Low, [this]()
+        {
+            DisplayMessage();
+        });
+    }
+
+    MessageBar::~MessageBar()
+    {
+        frameClock.Unregister(clockToken);
     }
 
     void MessageBar::EnqueueMessage(const IInspectable& message)
@@ -32,10 +37,17 @@ namespace winrt::SND_Vol::implementation
             messageQueue.push(message);
         }
 
-        if (!timer.IsRunning()) 
+        // The frame clock belongs to the UI thread.
+        if (DispatcherQueue().HasThreadAccess())
         {
-            DisplayMessage();
-            timer.Start();
+            ShowMessages();
+        }
+        else
+        {
+            DispatcherQueue().TryEnqueue([this]()
+            {
+                ShowMessages();
+            });
         }
     }
 
@@ -46,7 +58,7 @@ namespace winrt::SND_Vol::implementation
 
     void MessageBar::CloseButton_Click(winrt::Windows::Foundation::IInspectable const&, RoutedEventArgs const&)
     {
-        timer.Stop();
+        frameClock.Stop(clockToken);
         TimerProgressBarStoryboard().Stop();
     }
 
@@ -61,6 +73,14 @@ namespace winrt::SND_Vol::implementation
     }
 
 
+    void MessageBar::ShowMessages()
+    {
+        if (!frameClock.IsRunning(clockToken))
+        {
+            DisplayMessage();
+        }
+    }
+
     void MessageBar::DisplayMessage()
     {
         // Dequeue a message, send it to the UI
@@ -76,7 +96,7 @@ namespace winrt::SND_Vol::implementation
             }
             else
             {
-                timer.Stop();
+                frameClock.Stop(clockToken);
                 // Hide the control.
                 VisualStateManager::GoToState(*this, L"Collapsed", true);
             }
@@ -100,9 +120,7 @@ namespace winrt::SND_Vol::implementation
                         msCount = 1000;
                     }
 
-                    timer.Interval(
-                        std::chrono::milliseconds(msCount + 150)
-                    );
+                    interval = std::chrono::milliseconds(msCount + 150);
                     TimerProgressBarAnimation().Duration(
                         DurationHelper::FromTimeSpan(std::chrono::milliseconds(msCount))
                     );
@@ -110,9 +128,7 @@ namespace winrt::SND_Vol::implementation
             }
             else
             {
-                timer.Interval(
-                    std::chrono::milliseconds(4150)
-                );
+                interval = std::chrono::milliseconds(4150);
                 TimerProgressBarAnimation().Duration(
                     DurationHelper::FromTimeSpan(std::chrono::milliseconds(4000))
                 );
@@ -126,12 +142,7 @@ namespace winrt::SND_Vol::implementation
 
             MainContentPresenter().Content(box_value(message));
             TimerProgressBarStoryboard().Begin();
-            timer.Start();
+            frameClock.Start(clockToken, interval);
         }
     }
-
-    void MessageBar::DispatcherQueueTimer_Tick(winrt::Microsoft::UI::Dispatching::DispatcherQueueTimer, winrt::Windows::Foundation::IInspectable)
-    {
-        DisplayMessage();
-    }
 }
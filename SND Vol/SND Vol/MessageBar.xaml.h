@@ -6,6 +6,7 @@
 #include "MessageBar.g.h"
 
 #include <queue>
+#include "FrameClock.h"
 
 namespace winrt::SND_Vol::implementation
 {
@@ -13,6 +14,7 @@ namespace winrt::SND_Vol::implementation
     {
     public:
         MessageBar();
+        ~MessageBar();
 
         void EnqueueMessage(const winrt::Windows::Foundation::IInspectable& message);
         void EnqueueString(const winrt::hstring& message);
@@ -24,11 +26,12 @@ namespace winrt::SND_Vol::implementation
     private:
         std::mutex messageQueueMutex{};
         std::queue<winrt::Windows::Foundation::IInspectable> messageQueue{};
-        winrt::Microsoft::UI::Dispatching::DispatcherQueueTimer timer = nullptr;
+        System::FrameClock& frameClock{ System::FrameClock::GetForCurrentThread() };
+        uint32_t clockToken = 0;
+        std::chrono::milliseconds interval{};
 
+        void ShowMessages();
         void DisplayMessage();
-
-        void DispatcherQueueTimer_Tick(winrt::Microsoft::UI::Dispatching::DispatcherQueueTimer, winrt::Windows::Foundation::IInspectable);
     };
 }
 
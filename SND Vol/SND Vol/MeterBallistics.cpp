@@ -0,0 +1,68 @@
+#include "MeterBallistics.h"
+
+#include <math.h>
+
+using namespace std;
+
+
+namespace Audio
+{
+    MeterBallistics::MeterBallistics(const MeterBallisticsSettings& settings) :
+        settings{ settings }
+    {
+    }
+
+
+    void MeterBallistics::Prepare(const chrono::milliseconds& elapsed)
+    {
+        elapsedMilliseconds = static_cast<int32_t>(elapsed.count());
+        attackCoefficient = Coefficient(elapsed, settings.attackTime);
+        releaseCoefficient = Coefficient(elapsed, settings.releaseTime);
+    }
+
+    void MeterBallistics::Step(MeterChannelState& state, const float& peak) const
+    {
+        uint32_t input = ToFixed(peak);
+        state.level = Approach(state.level, input, input > state.level ? attackCoefficient : releaseCoefficient);
+
+        // The peak-hold follows the displayed level, not the raw input, so that the marker sits on top of the bar.
+        if (state.level >= state.hold)
+        {
+            state.hold = state.level;
+            state.holdRemaining = static_cast<int32_t>(settings.peakHoldTime.count());
+        }
+        else if (state.holdRemaining > 0)
+        {
+            state.holdRemaining -= elapsedMilliseconds;
+        }
+        else
+        {
+            state.hold = Approach(state.hold, state.level, releaseCoefficient);
+        }
+    }
+
+
+    uint32_t MeterBallistics::Coefficient(const chrono::milliseconds& elapsed, const chrono::milliseconds& timeConstant)
+    {
+        if (timeConstant.count() <= 0)
+        {
+            return One;
+        }
+
+        // Fraction of the distance to the target covered in 'elapsed' by a first order filter.
+        double coefficient = 1. - exp(-static_cast<double>(elapsed.count()) / static_cast<double>(timeConstant.count()));
+        return static_cast<uint32_t>(coefficient * One + 0.5);
+    }
+
+    uint32_t MeterBallistics::Approach(const uint32_t& value, const uint32_t& target, const uint32_t& coefficient)
+    {
+        int64_t distance = static_cast<int64_t>(target) - static_cast<int64_t>(value);
+        int64_t step = distance * static_cast<int64_t>(coefficient) / static_cast<int64_t>(One);
+        // Snap when the remaining distance is below the resolution of the coefficient, otherwise the meter never reaches 0.
+        if (step == 0)
+        {
+            step = distance;
+        }
+        return static_cast<uint32_t>(static_cast<int64_t>(value) + step);
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+namespace Audio
+{
+    struct MeterBallisticsSettings
+    {
+        /**
+         * @brief Time constant of the meter rise, 0 for an instantaneous rise.
+        */
+        std::chrono::milliseconds attackTime{ 10 };
+        /**
+         * @brief Time constant of the meter and peak-hold fall.
+        */
+        std::chrono::milliseconds releaseTime{ 300 };
+        /**
+         * @brief Time the peak-hold marker stays at its maximum before falling.
+        */
+        std::chrono::milliseconds peakHoldTime{ 1000 };
+    };
+
+    /**
+     * @brief Ballistics state of a single meter channel, in Q16 fixed point (MeterBallistics::One is full scale).
+    */
+    struct MeterChannelState
+    {
+        uint32_t level = 0;
+        uint32_t hold = 0;
+        int32_t holdRemaining = 0;
+    };
+
+    /**
+     * @brief Smooths instantaneous peak values with exponential attack/release and a peak-hold. Deterministic and free of any
+     * platform dependency, a sequence of Prepare/Step calls always produces the same states.
+    */
+    class MeterBallistics
+    {
+    public:
+        static constexpr uint32_t One = 1u << 16;
+
+        MeterBallistics() = default;
+        /**
+         * @brief Default constructor.
+         * @param settings Attack, release and peak-hold times
+        */
+        MeterBallistics(const MeterBallisticsSettings& settings);
+
+        inline const MeterBallisticsSettings& Settings() const
+        {
+            return settings;
+        };
+
+        /**
+         * @brief Computes the coefficients of the next step, shared by every channel stepped until the next call.
+         * @param elapsed Time elapsed since the previous step
+        */
+        void Prepare(const std::chrono::milliseconds& elapsed);
+        /**
+         * @brief Advances a channel by the duration given to Prepare.
+         * @param state State of the channel
+         * @param peak Instantaneous peak value ∈ [0, 1]
+        */
+        void Step(MeterChannelState& state, const float& peak) const;
+
+        static inline float ToFloat(const uint32_t& value)
+        {
+            return static_cast<float>(value) / static_cast<float>(One);
+        };
+
+        static inline uint32_t ToFixed(const float& value)
+        {
+            return value <= 0.f ? 0u : value >= 1.f ? One : static_cast<uint32_t>(value * static_cast<float>(One) + 0.5f);
+        };
+
+    private:
+        MeterBallisticsSettings settings{};
+        uint32_t attackCoefficient = One;
+        uint32_t releaseCoefficient = One;
+        int32_t elapsedMilliseconds = 0;
+
+        static uint32_t Coefficient(const std::chrono::milliseconds& elapsed, const std::chrono::milliseconds& timeConstant);
+        static uint32_t Approach(const uint32_t& value, const uint32_t& target, const uint32_t& coefficient);
+    };
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+namespace System
+{
+	/**
+	 * @brief Lock-free multi-producer/single-consumer queue. Producers push from any thread, the consumer drains every pending item at
+	 * once, in push order.
+	*/
+	template<typename T>
+	class MpscQueue
+	{
+	public:
+		MpscQueue() = default;
+		MpscQueue(const MpscQueue&) = delete;
+
+		~MpscQueue()
+		{
+			Node* node = head.exchange(nullptr);
+			while (node)
+			{
+				Node* next = node->next;
+				delete node;
+				node = next;
+			}
+		};
+
+		/**
+		 * @brief Pushes an item, can be called from any thread.
+		 * @return True if the queue was empty: the consumer needs to be woken up
+		*/
+		bool Push(const T& value)
+		{
+			Node* node = new Node{ value, head.load(std::memory_order_relaxed) };
+			while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+			return node->next == nullptr;
+		};
+
+		/**
+		 * @brief Moves every pending item to the back of items, oldest first. Consumer thread only.
+		 * @return Number of items drained
+		*/
+		size_t Drain(std::vector<T>& items)
+		{
+			// The whole stack is taken at once, newest first: it is reversed in place before being appended.
+			Node* node = head.exchange(nullptr, std::memory_order_acquire);
+			Node* reversed = nullptr;
+			while (node)
+			{
+				Node* next = node->next;
+				node->next = reversed;
+				reversed = node;
+				node = next;
+			}
+
+			size_t count = 0;
+			while (reversed)
+			{
+				Node* next = reversed->next;
+				items.push_back(std::move(reversed->value));
+				delete reversed;
+				reversed = next;
+				count++;
+			}
+			return count;
+		};
+
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+	private:
+		struct Node
+		{
+			T value;
+			Node* next = nullptr;
+		};
+
+		std::atomic<Node*> head = nullptr;
+	};
+}
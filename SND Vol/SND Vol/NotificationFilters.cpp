@@ -0,0 +1,69 @@
+#include "NotificationFilters.h"
+
+using namespace std;
+
+
+namespace Audio
+{
+    #pragma region SessionCreationFilter
+    bool SessionCreationFilter::Accept(const wstring& instanceId)
+    {
+        unique_lock lock{ mutex };
+        return instanceIds.insert(instanceId).second;
+    }
+
+    void SessionCreationFilter::Remove(const wstring& instanceId)
+    {
+        unique_lock lock{ mutex };
+        instanceIds.erase(instanceId);
+    }
+
+    bool SessionCreationFilter::Contains(const wstring& instanceId)
+    {
+        unique_lock lock{ mutex };
+        return instanceIds.contains(instanceId);
+    }
+
+    void SessionCreationFilter::Clear()
+    {
+        unique_lock lock{ mutex };
+        instanceIds.clear();
+    }
+
+    size_t SessionCreationFilter::Size()
+    {
+        unique_lock lock{ mutex };
+        return instanceIds.size();
+    }
+    #pragma endregion
+
+
+    #pragma region DeviceChangeFilter
+    DeviceChangeFilter::DeviceChangeFilter(const chrono::milliseconds& window) :
+        window{ window }
+    {
+    }
+
+    bool DeviceChangeFilter::Accept(const uint32_t& flow, const uint32_t& role, const wstring& deviceId, const chrono::steady_clock::time_point& now)
+    {
+        unique_lock lock{ mutex };
+
+        auto [it, inserted] = lastAccepted.try_emplace((static_cast<uint64_t>(flow) << 32) | role, AcceptedChange{ deviceId, now });
+        if (inserted)
+        {
+            return true;
+        }
+
+        // Repeats do not extend the window. Switching to another device and back within the window is not a repeat.
+        AcceptedChange& last = it->second;
+        if (last.deviceId == deviceId && now - last.time < window)
+        {
+            return false;
+        }
+
+        last.deviceId = deviceId;
+        last.time = now;
+        return true;
+    }
+    #pragma endregion
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Audio
+{
+    /**
+     * @brief De-duplicates session creation notifications by session instance identifier: the audio service can notify the creation of
+     * the same session more than once. Thread safe, only depends on the standard library.
+    */
+    class SessionCreationFilter
+    {
+    public:
+        /**
+         * @brief Checks a created session against the known sessions and records it.
+         * @param instanceId Session instance identifier (IAudioSessionControl2::GetSessionInstanceIdentifier)
+         * @return True if the session is new, false for a repeated notification
+        */
+        bool Accept(const std::wstring& instanceId);
+        /**
+         * @brief Forgets an expired (or disconnected) session, a later session with the same identifier is accepted.
+         * @param instanceId Session instance identifier
+        */
+        void Remove(const std::wstring& instanceId);
+        /**
+         * @brief Checks if a session has been accepted and not removed since.
+         * @param instanceId Session instance identifier
+        */
+        bool Contains(const std::wstring& instanceId);
+        void Clear();
+        size_t Size();
+
+    private:
+        std::mutex mutex{};
+        std::unordered_set<std::wstring> instanceIds{};
+    };
+
+
+    /**
+     * @brief De-duplicates default device change notifications: a notification for the same (flow, role, device) as the last one accepted for
+     * that (flow, role), less than the debounce window ago, is a repeat. Time is passed by the caller, so that recorded notifications can be replayed
+     * (see Tests/NotificationFiltersTests.cpp). Thread safe, only depends on the standard library.
+    */
+    class DeviceChangeFilter
+    {
+    public:
+        static constexpr std::chrono::milliseconds DefaultWindow{ 500 };
+
+        DeviceChangeFilter() = default;
+        DeviceChangeFilter(const std::chrono::milliseconds& window);
+
+        /**
+         * @brief Checks a default device change notification and records it if accepted.
+         * @param flow Data flow (EDataFlow)
+         * @param role Device role (ERole)
+         * @param deviceId New default device identifier
+         * @param now Time of the notification
+         * @return True if the notification is not a repeat
+        */
+        bool Accept(const uint32_t& flow, const uint32_t& role, const std::wstring& deviceId, const std::chrono::steady_clock::time_point& now);
+
+    private:
+        struct AcceptedChange
+        {
+            std::wstring deviceId{};
+            std::chrono::steady_clock::time_point time{};
+        };
+
+        std::chrono::milliseconds window = DefaultWindow;
+        std::mutex mutex{};
+        /**
+         * @brief Last accepted notification of each (flow, role), keyed by flow << 32 | role.
+        */
+        std::unordered_map<uint64_t, AcceptedChange> lastAccepted{};
+    };
+}
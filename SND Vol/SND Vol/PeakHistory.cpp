@@ -0,0 +1,152 @@
+#include "PeakHistory.h"
+
+#include <math.h>
+
+using namespace std;
+
+
+namespace Audio
+{
+    /**
+     * @brief Linear amplitude of each quantization step, in Q16.
+    */
+    static const array<uint32_t, 256>& LinearTable()
+    {
+        static const array<uint32_t, 256> table = []()
+        {
+            array<uint32_t, 256> values{};
+            for (size_t i = 1; i < values.size(); i++)
+            {
+                values[i] = static_cast<uint32_t>(PeakHistory::Dequantize(static_cast<uint8_t>(i)) * 65536.f + 0.5f);
+            }
+            return values;
+        }();
+        return table;
+    }
+
+
+    void PeakHistory::Record(const float& peak, const chrono::milliseconds& now)
+    {
+        uint8_t sample = Quantize(peak);
+        int64_t time = now.count();
+        int64_t interval = SampleInterval.count();
+
+        if (!bucketOpen)
+        {
+            bucketStart = time - time % interval;
+            bucketMax = 0;
+            bucketOpen = true;
+        }
+        else if (time >= bucketStart + interval)
+        {
+            Push(bucketMax);
+
+            // Intervals without any record (metering stopped while every session was silent) are silence.
+            int64_t missed = (time - bucketStart) / interval - 1;
+            for (int64_t i = 0; i < missed && i < static_cast<int64_t>(Capacity); i++)
+            {
+                Push(0);
+            }
+
+            bucketStart = time - time % interval;
+            bucketMax = 0;
+        }
+
+        static const uint8_t soundSample = Quantize(powf(10.f, SoundThreshold / 20.f));
+        bucketMax = sample > bucketMax ? sample : bucketMax;
+        if (sample >= soundSample)
+        {
+            lastSound = time;
+        }
+    }
+
+    uint8_t PeakHistory::Sample(const size_t& age) const
+    {
+        if (age >= size)
+        {
+            return 0;
+        }
+        return samples[(head + Capacity - 1 - age) % Capacity];
+    }
+
+    size_t PeakHistory::CopyTo(span<uint8_t> destination) const
+    {
+        size_t count = destination.size() < size ? destination.size() : size;
+        for (size_t i = 0; i < count; i++)
+        {
+            destination[i] = Sample(count - 1 - i);
+        }
+        return count;
+    }
+
+    PeakHistoryStatistics PeakHistory::Statistics() const
+    {
+        PeakHistoryStatistics statistics{};
+        statistics.lastSound = lastSound;
+        if (size == 0)
+        {
+            return statistics;
+        }
+
+        statistics.averageLevel = static_cast<float>(static_cast<double>(linearSum) / static_cast<double>(size) / 65536.);
+        double meanPower = static_cast<double>(powerSum) / static_cast<double>(size) / (65536. * 65536.);
+        if (meanPower > 0.)
+        {
+            float loudness = static_cast<float>(10. * log10(meanPower));
+            statistics.loudness = loudness < MinDecibels ? MinDecibels : loudness;
+        }
+        return statistics;
+    }
+
+
+    uint8_t PeakHistory::Quantize(const float& peak)
+    {
+        if (peak <= 0.f)
+        {
+            return 0;
+        }
+
+        float decibels = 20.f * log10f(peak);
+        if (decibels < MinDecibels - DecibelsStep / 2.f)
+        {
+            return 0;
+        }
+
+        float step = (decibels - MinDecibels) / DecibelsStep + 1.5f;
+        return step >= 255.f ? 255 : static_cast<uint8_t>(step < 1.f ? 1.f : step);
+    }
+
+    float PeakHistory::Dequantize(const uint8_t& sample)
+    {
+        if (sample == 0)
+        {
+            return 0.f;
+        }
+        return powf(10.f, (MinDecibels + static_cast<float>(sample - 1) * DecibelsStep) / 20.f);
+    }
+
+
+    void PeakHistory::Push(const uint8_t& sample)
+    {
+        const array<uint32_t, 256>& linear = LinearTable();
+
+        if (size == Capacity)
+        {
+            // Evict the oldest sample, it is overwritten below.
+            uint64_t evicted = linear[samples[head]];
+            linearSum -= evicted;
+            powerSum -= evicted * evicted;
+        }
+        else
+        {
+            size++;
+        }
+
+        uint64_t value = linear[sample];
+        linearSum += value;
+        powerSum += value * value;
+
+        samples[head] = sample;
+        head = (head + 1) % Capacity;
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <span>
+#include <stdint.h>
+
+namespace Audio
+{
+    struct PeakHistoryStatistics
+    {
+        /**
+         * @brief Mean linear peak value over the history ∈ [0, 1].
+        */
+        float averageLevel = 0.f;
+        /**
+         * @brief Loudness estimate: power mean of the peak values over the history, in dBFS. PeakHistory::MinDecibels when silent.
+        */
+        float loudness = -95.25f;
+        /**
+         * @brief Steady clock time of the last sample above PeakHistory::SoundThreshold, in milliseconds. 0 if the session has never been heard.
+        */
+        int64_t lastSound = 0;
+    };
+
+    /**
+     * @brief Fixed-size ring buffer of the recent peak values of a session, one sample per SampleInterval quantized on a logarithmic scale.
+     * Holds Capacity samples (60 s at 10 Hz) and never allocates after construction, statistics are maintained incrementally.
+    */
+    class PeakHistory
+    {
+    public:
+        static constexpr size_t Capacity = 600;
+        static constexpr std::chrono::milliseconds SampleInterval{ 100 };
+        /**
+         * @brief Level of the quantization step 1, step 0 is silence.
+        */
+        static constexpr float MinDecibels = -95.25f;
+        static constexpr float DecibelsStep = 0.375f;
+        /**
+         * @brief Level above which a sample counts as sound.
+        */
+        static constexpr float SoundThreshold = -60.f;
+
+        PeakHistory() = default;
+
+        inline size_t Size() const
+        {
+            return size;
+        };
+
+        /**
+         * @brief Records a peak value. Peaks recorded within the same interval are merged (maximum), intervals without any record
+         * are stored as silence.
+         * @param peak Instantaneous peak value ∈ [0, 1]
+         * @param now Steady clock time, in milliseconds
+        */
+        void Record(const float& peak, const std::chrono::milliseconds& now);
+        /**
+         * @brief Gets a sample.
+         * @param age 0 for the most recent sample, Size() - 1 for the oldest
+         * @return Quantized sample, 0 for silence
+        */
+        uint8_t Sample(const size_t& age) const;
+        /**
+         * @brief Copies the samples, oldest first, for sparklines.
+         * @param destination Destination, at most Size() samples are copied
+         * @return Number of samples copied
+        */
+        size_t CopyTo(std::span<uint8_t> destination) const;
+        PeakHistoryStatistics Statistics() const;
+
+        static uint8_t Quantize(const float& peak);
+        static float Dequantize(const uint8_t& sample);
+
+    private:
+        std::array<uint8_t, Capacity> samples{};
+        size_t head = 0;
+        size_t size = 0;
+        int64_t bucketStart = 0;
+        uint8_t bucketMax = 0;
+        bool bucketOpen = false;
+        int64_t lastSound = 0;
+        // Sums of the linear amplitude (Q16) and power (Q32) of the samples in the buffer.
+        uint64_t linearSum = 0;
+        uint64_t powerSum = 0;
+
+        void Push(const uint8_t& sample);
+    };
+}
@@ -0,0 +1,59 @@
+#include "PeakPollingScheduler.h"
+
+using namespace std;
+
+
+namespace Audio
+{
+    PeakPollingScheduler::PeakPollingScheduler(const PeakPollingSettings& settings) :
+        settings{ settings }
+    {
+    }
+
+
+    chrono::milliseconds PeakPollingScheduler::Update(const uint32_t& activeCount, const float& maxPeak, const float& maxDelta, const chrono::milliseconds& now)
+    {
+        if (activeCount == 0)
+        {
+            rate = PeakPollingRate::Stopped;
+        }
+        else if (maxPeak > settings.movementThreshold || maxDelta > settings.movementThreshold)
+        {
+            lastMovement = now;
+            rate = PeakPollingRate::Fast;
+        }
+        else if (now - lastMovement < settings.silenceTimeout)
+        {
+            // Keep a reasonable rate for a while, the audio might only be paused between two tracks.
+            rate = PeakPollingRate::Normal;
+        }
+        else
+        {
+            rate = PeakPollingRate::Idle;
+        }
+
+        return Interval(rate);
+    }
+
+    void PeakPollingScheduler::Wake(const chrono::milliseconds& now)
+    {
+        lastMovement = now;
+        rate = PeakPollingRate::Normal;
+    }
+
+    chrono::milliseconds PeakPollingScheduler::Interval(const PeakPollingRate& pollingRate) const
+    {
+        switch (pollingRate)
+        {
+            case PeakPollingRate::Fast:
+                return settings.fastInterval;
+            case PeakPollingRate::Normal:
+                return settings.normalInterval;
+            case PeakPollingRate::Idle:
+                return settings.idleInterval;
+            case PeakPollingRate::Stopped:
+            default:
+                return chrono::milliseconds(0);
+        }
+    }
+}
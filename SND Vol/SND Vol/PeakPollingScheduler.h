@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+namespace Audio
+{
+    enum class PeakPollingRate : uint32_t
+    {
+        /**
+         * @brief Nothing is active, polling is stopped until the scheduler is woken.
+        */
+        Stopped = 0x0,
+        /**
+         * @brief Active sessions have been silent for longer than the silence timeout.
+        */
+        Idle = 0x1,
+        Normal = 0x10,
+        /**
+         * @brief A meter is moving, polling follows the display refresh rate.
+        */
+        Fast = 0x100
+    };
+
+    struct PeakPollingSettings
+    {
+        std::chrono::milliseconds fastInterval{ 16 };
+        std::chrono::milliseconds normalInterval{ 100 };
+        std::chrono::milliseconds idleInterval{ 250 };
+        /**
+         * @brief Time without any moving meter after which polling backs off to the idle interval.
+        */
+        std::chrono::milliseconds silenceTimeout{ 2000 };
+        /**
+         * @brief Peak value, or change of peak value between two polls, under which a meter is considered still.
+        */
+        float movementThreshold = 0.001f;
+    };
+
+    /**
+     * @brief Chooses the peak meters polling interval from the activity of the metered sessions. Does not own a timer or a thread.
+    */
+    class PeakPollingScheduler
+    {
+    public:
+        PeakPollingScheduler() = default;
+        /**
+         * @brief Default constructor.
+         * @param settings Polling intervals and thresholds
+        */
+        PeakPollingScheduler(const PeakPollingSettings& settings);
+
+        inline PeakPollingRate Rate() const
+        {
+            return rate;
+        };
+
+        inline const PeakPollingSettings& Settings() const
+        {
+            return settings;
+        };
+
+        /**
+         * @brief Updates the polling rate after a poll.
+         * @param activeCount Number of active sessions that have been polled
+         * @param maxPeak Largest peak value of the poll
+         * @param maxDelta Largest change of a peak value since the previous poll
+         * @param now Time of the poll
+         * @return Interval until the next poll, 0 if polling should stop
+        */
+        std::chrono::milliseconds Update(const uint32_t& activeCount, const float& maxPeak, const float& maxDelta, const std::chrono::milliseconds& now);
+        /**
+         * @brief Restarts polling at the normal rate, called when a session becomes active.
+         * @param now Current time
+        */
+        void Wake(const std::chrono::milliseconds& now);
+        /**
+         * @brief Gets the interval of a polling rate.
+         * @param pollingRate Polling rate
+         * @return The interval, 0 for PeakPollingRate::Stopped
+        */
+        std::chrono::milliseconds Interval(const PeakPollingRate& pollingRate) const;
+
+    private:
+        PeakPollingSettings settings{};
+        PeakPollingRate rate = PeakPollingRate::Normal;
+        std::chrono::milliseconds lastMovement{ 0 };
+    };
+}
@@ -3,9 +3,12 @@
 
 #include <appmodel.h>
 #include <regex>
+#include <tlhelp32.h>
 #include <winrt/Windows.Data.Xml.Dom.h>
 #include "ManifestApplicationNode.h"
 #include "IconHelper.h"
+#include "ProcessMetadataCache.h"
+#include "Trace.h"
 
 using namespace std;
 using namespace winrt;
@@ -17,6 +20,7 @@ namespace System
 {
     ProcessInfo::ProcessInfo(const PID& pid)
     {
+        TRACE_SPAN(L"ProcessInfo::ProcessInfo", GUID{}, pid);
         GetProcessInfo(pid);
     }
 
@@ -26,11 +30,27 @@ namespace System
         HANDLE processHandle = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
         check_pointer(processHandle);
 
-        if (!GetProcessInfoUWP(processHandle))
+        // Known executables (same package full name, or same image path, size and last write time) skip the version info and manifest reads.
+        ProcessMetadataCache& cache = ProcessMetadataCache::Current();
+        ProcessMetadataKey key = ProcessMetadataCache::Key(processHandle);
+        ProcessMetadata metadata{};
+        if (key.IsValid() && cache.TryGet(key, metadata))
+        {
+            name = metadata.name;
+            exePath = metadata.executablePath;
+            manifest.Logo(metadata.logo);
+
+            CloseHandle(processHandle);
+            return;
+        }
+
+        bool success = GetProcessInfoUWP(processHandle);
+        if (!success)
         {
             OutputDebugHString(L"Failed to get process info from package (UWP-like) for PID " + to_hstring((uint64_t)pid));
 
-            if (!GetProcessInfoWin32(processHandle))
+            success = GetProcessInfoWin32(processHandle);
+            if (!success)
             {
                 OutputDebugHString(L"Failed to get process info from process handle for PID " + to_hstring((uint64_t)pid));
 
@@ -40,6 +60,14 @@ namespace System
         }
 
         CloseHandle(processHandle);
+
+        if (success)
+        {
+            metadata.name = !name.empty() ? name : manifest.DisplayName();
+            metadata.executablePath = exePath;
+            metadata.logo = manifest.Logo();
+            cache.Insert(key, metadata);
+        }
     }
 
     bool ProcessInfo::GetProcessInfoWin32(const HANDLE& processHandle)
@@ -255,6 +283,34 @@ namespace System
         return success;
     }
 
+    ProcessSnapshot CaptureProcessSnapshot()
+    {
+        TRACE_SPAN(L"CaptureProcessSnapshot");
+        ProcessSnapshot snapshot{};
+
+        HANDLE snapshotHandle = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+        if (snapshotHandle == INVALID_HANDLE_VALUE)
+        {
+            OutputDebugHString(L"Failed to take a process snapshot.");
+            return snapshot;
+        }
+
+        PROCESSENTRY32W processEntry{};
+        processEntry.dwSize = sizeof(PROCESSENTRY32W);
+        if (Process32FirstW(snapshotHandle, &processEntry))
+        {
+            do
+            {
+                snapshot.Add(processEntry.th32ProcessID, processEntry.th32ParentProcessID, processEntry.szExeFile);
+            }
+            while (Process32NextW(snapshotHandle, &processEntry));
+        }
+
+        CloseHandle(snapshotHandle);
+        return snapshot;
+    }
+
+
     winrt::Windows::Foundation::IAsyncAction ProcessInfo::FindProcessIcon(std::wstring processIconPath)
     {
         for (int i = processIconPath.size() - 1; i >= 0; i--)
@@ -1,5 +1,6 @@
 #pragma once
 #include "ManifestApplicationNode.h"
+#include "ProcessSnapshot.h"
 
 namespace System
 {
@@ -36,5 +37,11 @@ namespace System
 		bool GetProcessPackageInfo(const HANDLE& processHandle);
 		winrt::Windows::Foundation::IAsyncAction FindProcessIcon(std::wstring processIconPath);
 	};
+
+	/**
+	 * @brief Takes a snapshot of the running processes (Toolhelp32), one system call for every process instead of opening each of them.
+	 * @return Snapshot, empty if it could not be taken
+	*/
+	ProcessSnapshot CaptureProcessSnapshot();
 }
 
@@ -0,0 +1,288 @@
+#include "pch.h"
+#include "ProcessMetadataCache.h"
+
+#include <algorithm>
+#include <appmodel.h>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+
+namespace System
+{
+	static void WriteValue(vector<char>& buffer, const void* value, const size_t& size)
+	{
+		const char* bytes = static_cast<const char*>(value);
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	static void WriteUInt32(vector<char>& buffer, const uint32_t& value)
+	{
+		WriteValue(buffer, &value, sizeof(value));
+	}
+
+	static void WriteUInt64(vector<char>& buffer, const uint64_t& value)
+	{
+		WriteValue(buffer, &value, sizeof(value));
+	}
+
+	static void WriteString(vector<char>& buffer, const wstring& value)
+	{
+		WriteUInt32(buffer, static_cast<uint32_t>(value.size()));
+		WriteValue(buffer, value.data(), value.size() * sizeof(wchar_t));
+	}
+
+	/**
+	 * @brief Bounds checked reader over the content of a cache file.
+	*/
+	struct BufferReader
+	{
+		const vector<char>& buffer;
+		size_t position = 0;
+
+		bool Read(void* value, const size_t& size)
+		{
+			if (buffer.size() - position < size)
+			{
+				return false;
+			}
+			memcpy(value, buffer.data() + position, size);
+			position += size;
+			return true;
+		}
+
+		bool ReadUInt32(uint32_t& value)
+		{
+			return Read(&value, sizeof(value));
+		}
+
+		bool ReadUInt64(uint64_t& value)
+		{
+			return Read(&value, sizeof(value));
+		}
+
+		bool ReadString(wstring& value)
+		{
+			uint32_t length = 0;
+			if (!ReadUInt32(length) || (buffer.size() - position) / sizeof(wchar_t) < length)
+			{
+				return false;
+			}
+			value.assign(reinterpret_cast<const wchar_t*>(buffer.data() + position), length);
+			position += static_cast<size_t>(length) * sizeof(wchar_t);
+			return true;
+		}
+	};
+
+
+	ProcessMetadataCache& ProcessMetadataCache::Current()
+	{
+		static ProcessMetadataCache cache{};
+		return cache;
+	}
+
+	wstring ProcessMetadataCache::DefaultPath()
+	{
+		return (filesystem::path(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path().c_str()) / L"ProcessMetadata.cache").wstring();
+	}
+
+	ProcessMetadataKey ProcessMetadataCache::Key(const HANDLE& processHandle)
+	{
+		ProcessMetadataKey key{};
+
+		uint32_t packageFullNameLength = 0;
+		if (GetPackageFullName(processHandle, &packageFullNameLength, nullptr) == ERROR_INSUFFICIENT_BUFFER)
+		{
+			wstring packageFullName(packageFullNameLength, L'\0');
+			if (GetPackageFullName(processHandle, &packageFullNameLength, packageFullName.data()) == ERROR_SUCCESS)
+			{
+				// The length includes the null terminator.
+				packageFullName.resize(packageFullNameLength > 0 ? packageFullNameLength - 1 : 0);
+				key.identity = L"package:" + packageFullName;
+				return key;
+			}
+		}
+
+		wchar_t executablePath[MAX_PATH]{};
+		DWORD executablePathLength = MAX_PATH;
+		WIN32_FILE_ATTRIBUTE_DATA attributes{};
+		if (QueryFullProcessImageName(processHandle, 0, executablePath, &executablePathLength) &&
+			GetFileAttributesEx(executablePath, GetFileExInfoStandard, &attributes))
+		{
+			key.identity = wstring(executablePath, executablePathLength);
+			key.fileSize = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+			key.lastWriteTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+		}
+
+		return key;
+	}
+
+
+	bool ProcessMetadataCache::TryGet(const ProcessMetadataKey& key, ProcessMetadata& metadata)
+	{
+		unique_lock lock{ entriesMutex };
+
+		auto it = entries.find(key);
+		if (it == entries.end())
+		{
+			misses.fetch_add(1, memory_order_relaxed);
+			return false;
+		}
+
+		if (it->second.lastUsed != run)
+		{
+			it->second.lastUsed = run;
+			dirty = true;
+		}
+		metadata = it->second.metadata;
+		hits.fetch_add(1, memory_order_relaxed);
+		return true;
+	}
+
+	void ProcessMetadataCache::Insert(const ProcessMetadataKey& key, const ProcessMetadata& metadata)
+	{
+		if (!key.IsValid())
+		{
+			return;
+		}
+
+		unique_lock lock{ entriesMutex };
+		entries[key] = Entry{ metadata, run };
+		dirty = true;
+	}
+
+
+	bool ProcessMetadataCache::Load(const wstring& path)
+	{
+		vector<char> buffer{};
+		{
+			ifstream file{ filesystem::path(path), ios::binary | ios::ate };
+			if (!file)
+			{
+				return false;
+			}
+
+			streamsize size = file.tellg();
+			if (size <= 0)
+			{
+				return false;
+			}
+			buffer.resize(static_cast<size_t>(size));
+			file.seekg(0);
+			if (!file.read(buffer.data(), size))
+			{
+				return false;
+			}
+		}
+
+		BufferReader reader{ buffer };
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint32_t savedRun = 0;
+		uint32_t count = 0;
+		if (!reader.ReadUInt32(magic) || magic != FileMagic ||
+			!reader.ReadUInt32(version) || version != FileVersion ||
+			!reader.ReadUInt32(savedRun) ||
+			!reader.ReadUInt32(count))
+		{
+			OutputDebugHString(L"Process metadata cache: '" + winrt::hstring(path) + L"' is not a valid cache file.");
+			return false;
+		}
+
+		vector<pair<ProcessMetadataKey, Entry>> loaded{};
+		loaded.reserve(count < MaxSavedEntries ? count : MaxSavedEntries);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			pair<ProcessMetadataKey, Entry> entry{};
+			if (!reader.ReadString(entry.first.identity) ||
+				!reader.ReadUInt64(entry.first.fileSize) ||
+				!reader.ReadUInt64(entry.first.lastWriteTime) ||
+				!reader.ReadUInt32(entry.second.lastUsed) ||
+				!reader.ReadString(entry.second.metadata.name) ||
+				!reader.ReadString(entry.second.metadata.executablePath) ||
+				!reader.ReadString(entry.second.metadata.logo))
+			{
+				// Truncated file, nothing is loaded rather than a partial set of entries.
+				OutputDebugHString(L"Process metadata cache: '" + winrt::hstring(path) + L"' is truncated.");
+				return false;
+			}
+			loaded.push_back(std::move(entry));
+		}
+
+		unique_lock lock{ entriesMutex };
+		run = savedRun + 1;
+		for (pair<ProcessMetadataKey, Entry>& entry : loaded)
+		{
+			// Entries resolved before the load are more recent.
+			entries.insert(std::move(entry));
+		}
+		return true;
+	}
+
+	void ProcessMetadataCache::Save(const wstring& path)
+	{
+		vector<char> buffer{};
+		{
+			unique_lock lock{ entriesMutex };
+			if (!dirty)
+			{
+				return;
+			}
+
+			vector<const pair<const ProcessMetadataKey, Entry>*> saved{};
+			saved.reserve(entries.size());
+			for (const pair<const ProcessMetadataKey, Entry>& entry : entries)
+			{
+				if (run - entry.second.lastUsed <= MaxIdleRuns)
+				{
+					saved.push_back(&entry);
+				}
+			}
+			sort(saved.begin(), saved.end(), [](auto a, auto b)
+			{
+				return a->second.lastUsed > b->second.lastUsed;
+			});
+			if (saved.size() > MaxSavedEntries)
+			{
+				saved.resize(MaxSavedEntries);
+			}
+
+			WriteUInt32(buffer, FileMagic);
+			WriteUInt32(buffer, FileVersion);
+			WriteUInt32(buffer, run);
+			WriteUInt32(buffer, static_cast<uint32_t>(saved.size()));
+			for (const pair<const ProcessMetadataKey, Entry>* entry : saved)
+			{
+				WriteString(buffer, entry->first.identity);
+				WriteUInt64(buffer, entry->first.fileSize);
+				WriteUInt64(buffer, entry->first.lastWriteTime);
+				WriteUInt32(buffer, entry->second.lastUsed);
+				WriteString(buffer, entry->second.metadata.name);
+				WriteString(buffer, entry->second.metadata.executablePath);
+				WriteString(buffer, entry->second.metadata.logo);
+			}
+
+			dirty = false;
+		}
+
+		// Written next to the cache file and swapped, a crash while saving leaves the previous file intact.
+		wstring temporaryPath = path + L".tmp";
+		{
+			ofstream file{ filesystem::path(temporaryPath), ios::binary | ios::trunc };
+			file.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+			if (!file)
+			{
+				OutputDebugHString(L"Process metadata cache: failed to write '" + winrt::hstring(temporaryPath) + L"'.");
+				return;
+			}
+		}
+
+		if (!MoveFileEx(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+		{
+			OutputDebugHString(L"Process metadata cache: failed to replace '" + winrt::hstring(path) + L"'.");
+			DeleteFile(temporaryPath.c_str());
+		}
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+namespace System
+{
+	/**
+	 * @brief Identity of an executable: package full name for packaged processes (the full name includes the version), image path plus file size
+	 * and last write time otherwise. Updating the executable or the package changes the identity.
+	*/
+	struct ProcessMetadataKey
+	{
+		std::wstring identity{};
+		uint64_t fileSize = 0;
+		/**
+		 * @brief Last write time of the image, as a FILETIME. 0 for packages.
+		*/
+		uint64_t lastWriteTime = 0;
+
+		inline bool IsValid() const
+		{
+			return !identity.empty();
+		};
+
+		inline bool operator==(const ProcessMetadataKey& other) const
+		{
+			return fileSize == other.fileSize && lastWriteTime == other.lastWriteTime && identity == other.identity;
+		};
+	};
+
+	struct ProcessMetadataKeyHash
+	{
+		inline size_t operator()(const ProcessMetadataKey& key) const noexcept
+		{
+			size_t hash = std::hash<std::wstring>()(key.identity);
+			return hash ^ ((key.fileSize ^ (key.lastWriteTime * 0x9e3779b97f4a7c15ull)) + (hash << 6) + (hash >> 2));
+		};
+	};
+
+	/**
+	 * @brief Metadata resolved by ProcessInfo for an executable.
+	*/
+	struct ProcessMetadata
+	{
+		std::wstring name{};
+		std::wstring executablePath{};
+		std::wstring logo{};
+	};
+
+	/**
+	 * @brief Process wide cache of the metadata resolved by ProcessInfo (version info of executables, package manifests), keyed by executable
+	 * identity. Persisted to a compact binary file so that known applications are resolved with one lookup from the first enumeration.
+	 * Thread safe.
+	*/
+	class ProcessMetadataCache
+	{
+	public:
+		/**
+		 * @brief Entries that have not been used for that many application runs are not saved anymore.
+		*/
+		static constexpr uint32_t MaxIdleRuns = 32;
+		/**
+		 * @brief Maximum number of entries saved, most recently used first.
+		*/
+		static constexpr size_t MaxSavedEntries = 512;
+
+		static ProcessMetadataCache& Current();
+		/**
+		 * @brief Path of the cache file in the application local folder.
+		*/
+		static std::wstring DefaultPath();
+
+		/**
+		 * @brief Computes the identity of the executable of a process.
+		 * @param processHandle Handle with PROCESS_QUERY_LIMITED_INFORMATION access
+		 * @return Key, invalid if the identity could not be read
+		*/
+		static ProcessMetadataKey Key(const HANDLE& processHandle);
+
+		/**
+		 * @brief Looks up an executable.
+		 * @param key Identity of the executable
+		 * @param metadata Receives the cached metadata on success
+		 * @return True if the executable is known
+		*/
+		bool TryGet(const ProcessMetadataKey& key, ProcessMetadata& metadata);
+		void Insert(const ProcessMetadataKey& key, const ProcessMetadata& metadata);
+
+		/**
+		 * @brief Loads the entries saved by a previous run. Entries already in memory are kept.
+		 * @param path Path of the cache file
+		 * @return False if the file does not exist or is not a valid cache file
+		*/
+		bool Load(const std::wstring& path);
+		/**
+		 * @brief Saves the entries to a file, if they changed since the last load or save. The file is replaced atomically.
+		 * @param path Path of the cache file
+		*/
+		void Save(const std::wstring& path);
+
+		inline uint64_t Hits() const
+		{
+			return hits.load(std::memory_order_relaxed);
+		};
+
+		inline uint64_t Misses() const
+		{
+			return misses.load(std::memory_order_relaxed);
+		};
+
+	private:
+		struct Entry
+		{
+			ProcessMetadata metadata{};
+			/**
+			 * @brief Run in which the entry has last been used.
+			*/
+			uint32_t lastUsed = 0;
+		};
+
+		static constexpr uint32_t FileMagic = 0x4d505653; // "SVPM"
+		static constexpr uint32_t FileVersion = 1;
+
+		std::mutex entriesMutex{};
+		std::unordered_map<ProcessMetadataKey, Entry, ProcessMetadataKeyHash> entries{};
+		/**
+		 * @brief Number of the current application run, incremented on each load.
+		*/
+		uint32_t run = 0;
+		bool dirty = false;
+		std::atomic<uint64_t> hits = 0;
+		std::atomic<uint64_t> misses = 0;
+	};
+}
@@ -0,0 +1,110 @@
+#include "ProcessSnapshot.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+
+namespace System
+{
+	void ProcessSnapshot::Add(const uint32_t& processId, const uint32_t& parentProcessId, const wstring_view& imageName)
+	{
+		entries[processId] = ProcessSnapshotEntry{ processId, parentProcessId, wstring(imageName) };
+	}
+
+	const ProcessSnapshotEntry* ProcessSnapshot::Find(const uint32_t& processId) const
+	{
+		auto it = entries.find(processId);
+		return it != entries.end() ? &it->second : nullptr;
+	}
+
+
+	ProcessSnapshot ProcessSnapshot::Parse(const wstring_view& recorded)
+	{
+		auto readNumber = [](wstring_view& line, uint32_t& value)
+		{
+			size_t i = 0;
+			uint64_t number = 0;
+			while (i < line.size() && line[i] >= L'0' && line[i] <= L'9' && number <= 0xffffffffull)
+			{
+				number = number * 10 + static_cast<uint64_t>(line[i] - L'0');
+				i++;
+			}
+			if (i == 0 || number > 0xffffffffull || (i < line.size() && line[i] != L' ' && line[i] != L'\t'))
+			{
+				return false;
+			}
+
+			value = static_cast<uint32_t>(number);
+			line.remove_prefix(i);
+			while (!line.empty() && (line.front() == L' ' || line.front() == L'\t'))
+			{
+				line.remove_prefix(1);
+			}
+			return true;
+		};
+
+		ProcessSnapshot snapshot{};
+		wstring_view remaining = recorded;
+		while (!remaining.empty())
+		{
+			size_t end = remaining.find(L'\n');
+			wstring_view line = remaining.substr(0, end);
+			remaining.remove_prefix(end == wstring_view::npos ? remaining.size() : end + 1);
+
+			if (!line.empty() && line.back() == L'\r')
+			{
+				line.remove_suffix(1);
+			}
+			if (line.empty() || line.front() == L'#')
+			{
+				continue;
+			}
+
+			// The image name is the rest of the line, it can contain spaces.
+			uint32_t processId = 0;
+			uint32_t parentProcessId = 0;
+			if (readNumber(line, processId) && readNumber(line, parentProcessId) && !line.empty())
+			{
+				snapshot.Add(processId, parentProcessId, line);
+			}
+		}
+
+		return snapshot;
+	}
+
+	wstring ProcessSnapshot::Record() const
+	{
+		vector<const ProcessSnapshotEntry*> sorted{};
+		sorted.reserve(entries.size());
+		for (const auto& [processId, entry] : entries)
+		{
+			sorted.push_back(&entry);
+		}
+		sort(sorted.begin(), sorted.end(), [](const ProcessSnapshotEntry* a, const ProcessSnapshotEntry* b)
+		{
+			return a->processId < b->processId;
+		});
+
+		wstring recorded{};
+		for (const ProcessSnapshotEntry* entry : sorted)
+		{
+			recorded += to_wstring(entry->processId) + L" " + to_wstring(entry->parentProcessId) + L" " + entry->imageName + L"\n";
+		}
+		return recorded;
+	}
+
+	wstring ProcessSnapshot::DisplayName(const wstring_view& imageName)
+	{
+		size_t separator = imageName.find_last_of(L"\\/");
+		wstring_view name = separator == wstring_view::npos ? imageName : imageName.substr(separator + 1);
+
+		size_t extension = name.rfind(L'.');
+		if (extension != wstring_view::npos && extension > 0)
+		{
+			name = name.substr(0, extension);
+		}
+		return wstring(name);
+	}
+}
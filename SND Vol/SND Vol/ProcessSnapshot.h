@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace System
+{
+	struct ProcessSnapshotEntry
+	{
+		uint32_t processId = 0;
+		uint32_t parentProcessId = 0;
+		/**
+		 * @brief File name of the executable, without its directory.
+		*/
+		std::wstring imageName{};
+	};
+
+	/**
+	 * @brief Index of the processes running at one point in time, process id -> image name and parent process id. Filled by a system source
+	 * (see CaptureProcessSnapshot in ProcessInfo.h) or parsed from a recorded snapshot. Only depends on the standard library.
+	*/
+	class ProcessSnapshot
+	{
+	public:
+		void Add(const uint32_t& processId, const uint32_t& parentProcessId, const std::wstring_view& imageName);
+		/**
+		 * @return Process, null if it was not running when the snapshot was taken
+		*/
+		const ProcessSnapshotEntry* Find(const uint32_t& processId) const;
+
+		inline size_t Size() const
+		{
+			return entries.size();
+		};
+
+		/**
+		 * @brief Parses a recorded snapshot: one process per line, "<process id> <parent process id> <image name>". Empty lines and lines
+		 * starting with '#' are skipped, malformed lines are ignored.
+		 * @param recorded Recorded snapshot
+		 * @return Snapshot
+		*/
+		static ProcessSnapshot Parse(const std::wstring_view& recorded);
+		/**
+		 * @brief Formats the snapshot in the format read by Parse, processes ordered by id.
+		*/
+		std::wstring Record() const;
+		/**
+		 * @brief Name of an executable for display, the image name without its extension ("firefox.exe" -> "firefox").
+		*/
+		static std::wstring DisplayName(const std::wstring_view& imageName);
+
+	private:
+		std::unordered_map<uint32_t, ProcessSnapshotEntry> entries{};
+	};
+}
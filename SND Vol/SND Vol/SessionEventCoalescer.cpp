@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "SessionEventCoalescer.h"
+
+using namespace std;
+
+
+namespace Audio
+{
+    bool SessionEventCoalescer::Volume(const System::SlotHandle& handle, const float& volume)
+    {
+        unique_lock lock{ pendingMutex };
+        bool first = false;
+        Record(handle, SessionEventFlags::Volume, first).volume = volume;
+        return first;
+    }
+
+    bool SessionEventCoalescer::Mute(const System::SlotHandle& handle, const bool& muted)
+    {
+        unique_lock lock{ pendingMutex };
+        bool first = false;
+        Record(handle, SessionEventFlags::Mute, first).muted = muted;
+        return first;
+    }
+
+    bool SessionEventCoalescer::State(const System::SlotHandle& handle, const ::AudioSessionState& state)
+    {
+        unique_lock lock{ pendingMutex };
+        bool first = false;
+        Record(handle, SessionEventFlags::State, first).state = state;
+        return first;
+    }
+
+    bool SessionEventCoalescer::Changed(const System::SlotHandle& handle, const SessionEventFlags& flag)
+    {
+        unique_lock lock{ pendingMutex };
+        bool first = false;
+        Record(handle, flag, first);
+        return first;
+    }
+
+    size_t SessionEventCoalescer::Drain(vector<SessionEvents>& events)
+    {
+        events.clear();
+
+        unique_lock lock{ pendingMutex };
+        // Swapping keeps both buffers allocated, the steady state does not allocate.
+        events.swap(pending);
+        pendingIndex.clear();
+
+        statistics.flushes++;
+        statistics.maxPending = events.size() > statistics.maxPending ? events.size() : statistics.maxPending;
+        return events.size();
+    }
+
+    void SessionEventCoalescer::Dropped(const size_t& count)
+    {
+        unique_lock lock{ pendingMutex };
+        statistics.dropped += count;
+    }
+
+    SessionEventStatistics SessionEventCoalescer::Statistics()
+    {
+        unique_lock lock{ pendingMutex };
+        SessionEventStatistics current = statistics;
+        current.pending = pending.size();
+        return current;
+    }
+
+
+    SessionEvents& SessionEventCoalescer::Record(const System::SlotHandle& handle, const SessionEventFlags& flag, bool& first)
+    {
+        statistics.recorded++;
+        first = pending.empty();
+
+        uint64_t key = (static_cast<uint64_t>(handle.generation) << 32) | handle.index;
+        auto it = pendingIndex.find(key);
+        if (it != pendingIndex.end())
+        {
+            SessionEvents& events = pending[it->second];
+            if (events.Has(flag))
+            {
+                statistics.merged++;
+            }
+            events.flags |= static_cast<uint32_t>(flag);
+            return events;
+        }
+
+        pendingIndex.insert({ key, pending.size() });
+        SessionEvents& events = pending.emplace_back();
+        events.handle = handle;
+        events.flags = static_cast<uint32_t>(flag);
+        return events;
+    }
+}
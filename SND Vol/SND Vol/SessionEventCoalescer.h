@@ -0,0 +1,114 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "SlotMap.h"
+
+namespace Audio
+{
+    enum class SessionEventFlags : uint32_t
+    {
+        Volume = 0x1,
+        Mute = 0x2,
+        State = 0x4,
+        DisplayName = 0x8,
+        Icon = 0x10
+    };
+
+    /**
+     * @brief Pending changes of a session: flags tell which values changed, only the latest value of each is kept.
+    */
+    struct SessionEvents
+    {
+        System::SlotHandle handle{};
+        uint32_t flags = 0;
+        float volume = 0.f;
+        bool muted = false;
+        ::AudioSessionState state = ::AudioSessionState::AudioSessionStateInactive;
+
+        inline bool Has(const SessionEventFlags& flag) const
+        {
+            return (flags & static_cast<uint32_t>(flag)) != 0;
+        };
+    };
+
+    struct SessionEventStatistics
+    {
+        /**
+         * @brief Sessions with pending changes (queue depth).
+        */
+        size_t pending = 0;
+        /**
+         * @brief Highest queue depth seen at a flush.
+        */
+        size_t maxPending = 0;
+        /**
+         * @brief Events recorded since the start.
+        */
+        uint64_t recorded = 0;
+        /**
+         * @brief Events that replaced a pending value of the same kind for the same session.
+        */
+        uint64_t merged = 0;
+        /**
+         * @brief Pending changes dropped at the flush because their session had been removed.
+        */
+        uint64_t dropped = 0;
+        uint64_t flushes = 0;
+    };
+
+    /**
+     * @brief Dirty set between the session notifications (audio threads) and the UI thread: notifications only record the latest value per
+     * session, the UI thread applies every pending change once per frame.
+    */
+    class SessionEventCoalescer
+    {
+    public:
+        /**
+         * @brief Records a volume change.
+         * @return True if nothing was pending: a flush needs to be scheduled
+        */
+        bool Volume(const System::SlotHandle& handle, const float& volume);
+        /**
+         * @brief Records a mute state change.
+         * @return True if nothing was pending: a flush needs to be scheduled
+        */
+        bool Mute(const System::SlotHandle& handle, const bool& muted);
+        /**
+         * @brief Records a session state change.
+         * @return True if nothing was pending: a flush needs to be scheduled
+        */
+        bool State(const System::SlotHandle& handle, const ::AudioSessionState& state);
+        /**
+         * @brief Records a change without value (display name, icon).
+         * @return True if nothing was pending: a flush needs to be scheduled
+        */
+        bool Changed(const System::SlotHandle& handle, const SessionEventFlags& flag);
+
+        /**
+         * @brief Takes every pending change, in the order the sessions were first marked dirty.
+         * @param events Receives the pending changes, its previous content is discarded
+         * @return Number of sessions with changes
+        */
+        size_t Drain(std::vector<SessionEvents>& events);
+        /**
+         * @brief Reports pending changes the consumer could not apply (stale handles).
+        */
+        void Dropped(const size_t& count);
+        SessionEventStatistics Statistics();
+
+    private:
+        std::mutex pendingMutex{};
+        std::vector<SessionEvents> pending{};
+        /**
+         * @brief Handle -> index in pending.
+        */
+        std::unordered_map<uint64_t, size_t> pendingIndex{};
+        SessionEventStatistics statistics{};
+
+        /**
+         * @brief Gets the pending changes of a session, creating them if needed. pendingMutex must be held.
+        */
+        SessionEvents& Record(const System::SlotHandle& handle, const SessionEventFlags& flag, bool& first);
+    };
+}
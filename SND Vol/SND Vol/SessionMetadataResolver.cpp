@@ -0,0 +1,280 @@
+#include "pch.h"
+#include "SessionMetadataResolver.h"
+
+#include <unordered_map>
+#include "IconCache.h"
+#include "ProcessInfo.h"
+#include "ProcessMetadataCache.h"
+
+using namespace std;
+using namespace winrt;
+
+
+namespace Audio
+{
+    SessionMetadataResolver::SessionMetadataResolver(const uint32_t& workerCount)
+    {
+        uint32_t count = workerCount;
+        if (count == 0)
+        {
+            // Resolution is mostly waiting on the file system and the process table, a few workers are enough.
+            uint32_t concurrency = thread::hardware_concurrency() / 2;
+            count = concurrency < 1 ? 1 : (concurrency > 4 ? 4 : concurrency);
+        }
+
+        workers.reserve(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            workers.push_back(new thread(&SessionMetadataResolver::WorkerFunction, this));
+        }
+    }
+
+    SessionMetadataResolver::~SessionMetadataResolver()
+    {
+        Stop();
+    }
+
+
+    void SessionMetadataResolver::Enqueue(AudioSession* session)
+    {
+        if (session->MetadataResolved())
+        {
+            return;
+        }
+
+        {
+            unique_lock lock{ pendingMutex };
+            if (!running)
+            {
+                return;
+            }
+            session->AddRef();
+            pending.push_back(WorkItem{ { session }, nullptr, false });
+        }
+        pendingCondition.notify_one();
+    }
+
+    void SessionMetadataResolver::Enqueue(const vector<AudioSession*>& sessions)
+    {
+        WorkItem item{ {}, nullptr, true };
+        for (AudioSession* session : sessions)
+        {
+            if (!session->MetadataResolved())
+            {
+                item.sessions.push_back(session);
+            }
+        }
+        if (item.sessions.empty())
+        {
+            return;
+        }
+
+        {
+            unique_lock lock{ pendingMutex };
+            if (!running)
+            {
+                return;
+            }
+            for (AudioSession* session : item.sessions)
+            {
+                session->AddRef();
+            }
+            pending.push_back(move(item));
+        }
+        pendingCondition.notify_one();
+    }
+
+    void SessionMetadataResolver::Clear()
+    {
+        deque<WorkItem> dropped{};
+        {
+            unique_lock lock{ pendingMutex };
+            dropped.swap(pending);
+        }
+
+        for (WorkItem& item : dropped)
+        {
+            for (AudioSession* session : item.sessions)
+            {
+                session->Release();
+            }
+        }
+    }
+
+    void SessionMetadataResolver::Stop()
+    {
+        {
+            unique_lock lock{ pendingMutex };
+            running = false;
+        }
+        pendingCondition.notify_all();
+
+        for (thread* worker : workers)
+        {
+            worker->join();
+            delete worker;
+        }
+        workers.clear();
+
+        Clear();
+    }
+
+
+    void SessionMetadataResolver::WorkerFunction()
+    {
+        // ProcessInfo reads package manifests through COM (AppxFactory), the workers live in the MTA.
+        bool uninitialize = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+        while (true)
+        {
+            WorkItem item{};
+            {
+                unique_lock lock{ pendingMutex };
+                pendingCondition.wait(lock, [this]()
+                {
+                    return !running || !pending.empty();
+                });
+
+                if (!running)
+                {
+                    break;
+                }
+
+                item = move(pending.front());
+                pending.pop_front();
+            }
+
+            if (item.batch)
+            {
+                SplitBatch(item);
+            }
+            else
+            {
+                Resolve(item);
+            }
+        }
+
+        if (uninitialize)
+        {
+            CoUninitialize();
+        }
+    }
+
+    void SessionMetadataResolver::SplitBatch(WorkItem& item)
+    {
+        // One system call for the whole process table, instead of an OpenProcess per session to find out which processes are still running.
+        shared_ptr<const System::ProcessSnapshot> snapshot = make_shared<const System::ProcessSnapshot>(System::CaptureProcessSnapshot());
+        if (snapshot->Size() == 0)
+        {
+            // No snapshot, every process is queried.
+            snapshot.reset();
+        }
+
+        unordered_map<DWORD, vector<AudioSession*>> processes{};
+        for (AudioSession* session : item.sessions)
+        {
+            processes[session->PID()].push_back(session);
+        }
+
+        {
+            unique_lock lock{ pendingMutex };
+            if (running)
+            {
+                for (auto& [processId, sessions] : processes)
+                {
+                    pending.push_front(WorkItem{ move(sessions), snapshot, false });
+                }
+                item.sessions.clear();
+            }
+        }
+        pendingCondition.notify_all();
+
+        // Stopped meanwhile, the sessions are released unresolved.
+        for (AudioSession* session : item.sessions)
+        {
+            session->Release();
+        }
+    }
+
+    void SessionMetadataResolver::Resolve(WorkItem& item)
+    {
+        DWORD processId = item.sessions.front()->PID();
+        const System::ProcessSnapshotEntry* process = item.snapshot ? item.snapshot->Find(processId) : nullptr;
+
+        System::ProcessMetadata metadata{};
+        if ((!item.snapshot || process) && !TryGetCachedMetadata(processId, metadata))
+        {
+            try
+            {
+                metadata = AudioSession::QueryProcessMetadata(processId);
+            }
+            catch (const hresult_error& error)
+            {
+                // Protected process, the sessions keep their display name unless the snapshot has a name for it.
+                OutputDebugHString(L"Failed to resolve process metadata of PID " + to_hstring(static_cast<uint64_t>(processId)) + L": " + error.message());
+            }
+
+            if (metadata.name.empty() && process)
+            {
+                metadata.name = System::ProcessSnapshot::DisplayName(process->imageName);
+            }
+        }
+        // Else the process exited after the sessions were enumerated, there is nothing to query.
+
+        shared_ptr<const ::Imaging::IconPixels> logoPixels = DecodeLogo(metadata.logo);
+        for (AudioSession* session : item.sessions)
+        {
+            session->ApplyMetadata(metadata, logoPixels);
+            session->Release();
+        }
+    }
+
+    bool SessionMetadataResolver::TryGetCachedMetadata(const DWORD& processId, System::ProcessMetadata& metadata)
+    {
+        // Limited access is enough to read the identity of the executable, and is granted for most processes that refuse the access
+        // ProcessInfo needs.
+        HANDLE processHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+        if (!processHandle)
+        {
+            return false;
+        }
+
+        System::ProcessMetadataKey key = System::ProcessMetadataCache::Key(processHandle);
+        CloseHandle(processHandle);
+        if (!key.IsValid() || !System::ProcessMetadataCache::Current().TryGet(key, metadata))
+        {
+            return false;
+        }
+
+        if (metadata.logo.empty() && !metadata.executablePath.empty())
+        {
+            // Same logo as AudioSession::QueryProcessMetadata, the icon cache extracts it once per executable.
+            metadata.logo = ::Imaging::IconCache::Current().GetIconPath(metadata.executablePath);
+        }
+        return true;
+    }
+
+    shared_ptr<const ::Imaging::IconPixels> SessionMetadataResolver::DecodeLogo(const wstring& logoPath)
+    {
+        uint32_t size = logoSize.load();
+        if (logoPath.empty() || size == 0)
+        {
+            return nullptr;
+        }
+
+        shared_ptr<::Imaging::IconPixels> logo = make_shared<::Imaging::IconPixels>();
+        logo->path = logoPath;
+        logo->size = size;
+        try
+        {
+            // On an icon cache miss the pixels are converted straight from the extracted icon, without waiting for its PNG file.
+            ::Imaging::IconCache::Current().CopyIconPixels(logoPath, size, logo->pixels);
+        }
+        catch (const hresult_error& error)
+        {
+            OutputDebugHString(L"Failed to decode logo '" + hstring(logoPath) + L"': " + error.message());
+            return nullptr;
+        }
+        return logo;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "AudioSession.h"
+#include "ProcessSnapshot.h"
+
+namespace Audio
+{
+    /**
+     * @brief Small pool of worker threads resolving the process metadata of audio sessions (AudioSession::ResolveMetadata), so that sessions
+     * can be shown as soon as they are created and get their name and logo when the workers catch up.
+     * Batches are resolved against one snapshot of the process table: sessions of processes that have exited are not queried, and the
+     * sessions of a process are resolved with a single query. Known executables (see ProcessMetadataCache) are resolved from a limited
+     * access handle, only the others are queried with ProcessInfo. The logos are decoded for the icon atlas by the workers too (LogoSize).
+    */
+    class SessionMetadataResolver
+    {
+    public:
+        /**
+         * @brief Default constructor.
+         * @param workerCount Number of worker threads, 0 to derive it from the hardware concurrency
+        */
+        SessionMetadataResolver(const uint32_t& workerCount = 0);
+        ~SessionMetadataResolver();
+
+        /**
+         * @brief Queues a session to resolve. The session is kept alive (AddRef) until it has been resolved. Sessions already resolved are ignored.
+         * @param session Session to resolve
+        */
+        void Enqueue(AudioSession* session);
+        /**
+         * @brief Queues a batch of sessions (a GetSessions enumeration) to resolve against a single process snapshot. The sessions are kept
+         * alive until they have been resolved. Sessions already resolved are ignored.
+         * @param sessions Sessions to resolve
+        */
+        void Enqueue(const std::vector<AudioSession*>& sessions);
+        /**
+         * @brief Sets the size the logos are decoded to for the icon atlas (IconAtlas::CellPixels), 0 to leave the logos to the UI thread.
+        */
+        inline void LogoSize(const uint32_t& size)
+        {
+            logoSize.store(size);
+        };
+        /**
+         * @brief Drops the sessions still waiting to be resolved.
+        */
+        void Clear();
+        /**
+         * @brief Stops the workers and waits for them to exit. Sessions still waiting are released unresolved.
+        */
+        void Stop();
+
+    private:
+        struct WorkItem
+        {
+            /**
+             * @brief Sessions to resolve, AddRef'd. All the sessions of an item resolved against a snapshot belong to the same process.
+            */
+            std::vector<AudioSession*> sessions{};
+            std::shared_ptr<const System::ProcessSnapshot> snapshot{};
+            /**
+             * @brief True for a batch that has not been split by process yet.
+            */
+            bool batch = false;
+        };
+
+        std::vector<std::thread*> workers{};
+        std::deque<WorkItem> pending{};
+        std::mutex pendingMutex{};
+        std::condition_variable pendingCondition{};
+        bool running = true;
+        std::atomic<uint32_t> logoSize = 0;
+
+        void WorkerFunction();
+        /**
+         * @brief Takes the snapshot of a batch and queues one item per process, ahead of the other items.
+        */
+        void SplitBatch(WorkItem& item);
+        void Resolve(WorkItem& item);
+        /**
+         * @brief Looks up the metadata of a process in the metadata cache by executable identity, opening the process with limited access only.
+         * @return False if the executable is not cached, the process then has to be queried with ProcessInfo
+        */
+        bool TryGetCachedMetadata(const DWORD& processId, System::ProcessMetadata& metadata);
+        /**
+         * @brief Decodes the logo of a process for the icon atlas, so that the UI thread only copies the pixels.
+         * @return Pixels, null if the logo cannot be decoded
+        */
+        std::shared_ptr<const ::Imaging::IconPixels> DecodeLogo(const std::wstring& logoPath);
+    };
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace System
+{
+	/**
+	 * @brief Stable handle to an item of a SlotMap. A handle outlives its item: once the item is removed, the handle is stale and lookups
+	 * with it fail, even if its slot has been reused.
+	*/
+	struct SlotHandle
+	{
+		static constexpr uint32_t InvalidIndex = 0xffffffff;
+
+		uint32_t index = InvalidIndex;
+		/**
+		 * @brief Generation of the slot when the item was inserted. Generations start at 1, a default handle never matches.
+		*/
+		uint32_t generation = 0;
+
+		inline bool IsValid() const
+		{
+			return index != InvalidIndex;
+		};
+
+		inline bool operator==(const SlotHandle& other) const
+		{
+			return index == other.index && generation == other.generation;
+		};
+	};
+
+	/**
+	 * @brief Generational slot map: O(1) insertion, lookup and removal through stable handles, items stored densely for iteration.
+	 * Removal moves the last item in place of the removed one: pointers to items and iteration order are invalidated by Insert, Remove and Clear.
+	 * Not thread safe.
+	*/
+	template<typename T>
+	class SlotMap
+	{
+	public:
+		SlotMap() = default;
+
+		/**
+		 * @brief Inserts an item.
+		 * @return Handle of the item
+		*/
+		SlotHandle Insert(T value)
+		{
+			uint32_t index = 0;
+			if (freeHead != SlotHandle::InvalidIndex)
+			{
+				index = freeHead;
+				freeHead = slots[index].denseIndex;
+			}
+			else
+			{
+				index = static_cast<uint32_t>(slots.size());
+				slots.push_back(Slot());
+			}
+
+			Slot& slot = slots[index];
+			slot.denseIndex = static_cast<uint32_t>(values.size());
+			values.push_back(std::move(value));
+			denseSlots.push_back(index);
+			return SlotHandle{ index, slot.generation };
+		};
+
+		/**
+		 * @brief Removes an item.
+		 * @return False if the handle is stale
+		*/
+		bool Remove(const SlotHandle& handle)
+		{
+			if (!Contains(handle))
+			{
+				return false;
+			}
+
+			Slot& slot = slots[handle.index];
+			uint32_t denseIndex = slot.denseIndex;
+			uint32_t lastIndex = static_cast<uint32_t>(values.size() - 1);
+			if (denseIndex != lastIndex)
+			{
+				values[denseIndex] = std::move(values[lastIndex]);
+				denseSlots[denseIndex] = denseSlots[lastIndex];
+				slots[denseSlots[denseIndex]].denseIndex = denseIndex;
+			}
+			values.pop_back();
+			denseSlots.pop_back();
+
+			// Bumping the generation invalidates every handle to the removed item.
+			slot.generation++;
+			slot.denseIndex = freeHead;
+			freeHead = handle.index;
+			return true;
+		};
+
+		/**
+		 * @brief Gets an item.
+		 * @return Item, nullptr if the handle is stale
+		*/
+		T* Get(const SlotHandle& handle)
+		{
+			return Contains(handle) ? &values[slots[handle.index].denseIndex] : nullptr;
+		};
+
+		const T* Get(const SlotHandle& handle) const
+		{
+			return Contains(handle) ? &values[slots[handle.index].denseIndex] : nullptr;
+		};
+
+		inline bool Contains(const SlotHandle& handle) const
+		{
+			return handle.index < slots.size() && slots[handle.index].generation == handle.generation;
+		};
+
+		/**
+		 * @brief Gets the handle of the item at a position of the dense storage.
+		*/
+		inline SlotHandle HandleAt(const size_t& denseIndex) const
+		{
+			uint32_t index = denseSlots[denseIndex];
+			return SlotHandle{ index, slots[index].generation };
+		};
+
+		inline size_t Size() const
+		{
+			return values.size();
+		};
+
+		inline bool Empty() const
+		{
+			return values.empty();
+		};
+
+		void Reserve(const size_t& capacity)
+		{
+			slots.reserve(capacity);
+			values.reserve(capacity);
+			denseSlots.reserve(capacity);
+		};
+
+		/**
+		 * @brief Removes every item, every handle becomes stale.
+		*/
+		void Clear()
+		{
+			for (uint32_t index : denseSlots)
+			{
+				Slot& slot = slots[index];
+				slot.generation++;
+				slot.denseIndex = freeHead;
+				freeHead = index;
+			}
+			values.clear();
+			denseSlots.clear();
+		};
+
+		inline typename std::vector<T>::iterator begin()
+		{
+			return values.begin();
+		};
+
+		inline typename std::vector<T>::iterator end()
+		{
+			return values.end();
+		};
+
+		inline typename std::vector<T>::const_iterator begin() const
+		{
+			return values.begin();
+		};
+
+		inline typename std::vector<T>::const_iterator end() const
+		{
+			return values.end();
+		};
+
+	private:
+		struct Slot
+		{
+			/**
+			 * @brief Position of the item in the dense storage, or next free slot when the slot is free.
+			*/
+			uint32_t denseIndex = SlotHandle::InvalidIndex;
+			uint32_t generation = 1;
+		};
+
+		std::vector<Slot> slots{};
+		std::vector<T> values{};
+		/**
+		 * @brief Dense position -> slot index.
+		*/
+		std::vector<uint32_t> denseSlots{};
+		uint32_t freeHead = SlotHandle::InvalidIndex;
+	};
+}
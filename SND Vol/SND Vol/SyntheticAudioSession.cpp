@@ -0,0 +1,518 @@
+#include "pch.h"
+#include "SyntheticAudioSession.h"
+
+#include <new>
+
+using namespace std;
+using namespace winrt;
+
+
+#if USE_SYNTHETIC_SESSIONS
+static atomic<uint64_t> allocationCount = 0;
+
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* pointer = malloc(size > 0 ? size : 1))
+    {
+        return pointer;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+#endif // USE_SYNTHETIC_SESSIONS
+
+
+namespace Audio
+{
+    static inline int64_t SteadyClockNanoseconds()
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    #pragma region SyntheticAudioSessionControl
+    SyntheticAudioSessionControl::SyntheticAudioSessionControl(const wstring& displayName, const bool& active) :
+        displayName{ displayName },
+        state{ active ? ::AudioSessionState::AudioSessionStateActive : ::AudioSessionState::AudioSessionStateInactive }
+    {
+        check_hresult(CoCreateGuid(&groupingParam));
+        check_hresult(CoCreateGuid(&eventContext));
+    }
+
+
+    void SyntheticAudioSessionControl::Peak(const float& value)
+    {
+        peak.store(value, memory_order_relaxed);
+    }
+
+    void SyntheticAudioSessionControl::RaiseVolumeChanged(const float& newVolume)
+    {
+        volume.store(newVolume);
+
+        unique_lock lock{ eventsMutex };
+        if (events)
+        {
+            events->OnSimpleVolumeChanged(newVolume, muted.load(), &eventContext);
+        }
+    }
+
+    void SyntheticAudioSessionControl::RaiseStateChanged(const ::AudioSessionState& newState)
+    {
+        state.store(newState);
+        if (newState != ::AudioSessionState::AudioSessionStateActive)
+        {
+            peak.store(0.f, memory_order_relaxed);
+        }
+
+        unique_lock lock{ eventsMutex };
+        if (events)
+        {
+            events->OnStateChanged(newState);
+        }
+    }
+
+
+    #pragma region IUnknown
+    IFACEMETHODIMP_(ULONG) SyntheticAudioSessionControl::AddRef()
+    {
+        return ++refCount;
+    }
+
+    IFACEMETHODIMP_(ULONG) SyntheticAudioSessionControl::Release()
+    {
+        const uint32_t remaining = --refCount;
+
+        if (remaining == 0)
+        {
+            {
+                unique_lock lock{ eventsMutex };
+                if (events)
+                {
+                    events->Release();
+                    events = nullptr;
+                }
+            }
+            delete this;
+        }
+
+        return remaining;
+    }
+
+    IFACEMETHODIMP SyntheticAudioSessionControl::QueryInterface(REFIID riid, VOID** ppvInterface)
+    {
+        if (riid == IID_IUnknown || riid == __uuidof(IAudioSessionControl) || riid == __uuidof(IAudioSessionControl2))
+        {
+            *ppvInterface = static_cast<IAudioSessionControl2*>(this);
+        }
+        else if (riid == __uuidof(ISimpleAudioVolume))
+        {
+            *ppvInterface = static_cast<ISimpleAudioVolume*>(this);
+        }
+        else if (riid == __uuidof(IAudioMeterInformation))
+        {
+            *ppvInterface = static_cast<IAudioMeterInformation*>(this);
+        }
+        else
+        {
+            *ppvInterface = NULL;
+            return E_NOINTERFACE;
+        }
+
+        AddRef();
+        return S_OK;
+    }
+    #pragma endregion
+
+
+    #pragma region IAudioSessionControl2
+    STDMETHODIMP SyntheticAudioSessionControl::GetState(::AudioSessionState* pRetVal)
+    {
+        *pRetVal = state.load();
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetDisplayName(LPWSTR* pRetVal)
+    {
+        return CopyString(displayName, pRetVal);
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::SetDisplayName(LPCWSTR, LPCGUID)
+    {
+        return E_NOTIMPL;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetIconPath(LPWSTR* pRetVal)
+    {
+        return CopyString(L"", pRetVal);
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::SetIconPath(LPCWSTR, LPCGUID)
+    {
+        return E_NOTIMPL;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetGroupingParam(GUID* pRetVal)
+    {
+        *pRetVal = groupingParam;
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::SetGroupingParam(LPCGUID, LPCGUID)
+    {
+        return E_NOTIMPL;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::RegisterAudioSessionNotification(IAudioSessionEvents* NewNotifications)
+    {
+        if (!NewNotifications)
+        {
+            return E_POINTER;
+        }
+
+        unique_lock lock{ eventsMutex };
+        if (events)
+        {
+            events->Release();
+        }
+        events = NewNotifications;
+        events->AddRef();
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::UnregisterAudioSessionNotification(IAudioSessionEvents* NewNotifications)
+    {
+        unique_lock lock{ eventsMutex };
+        if (events && events == NewNotifications)
+        {
+            events->Release();
+            events = nullptr;
+        }
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetSessionIdentifier(LPWSTR* pRetVal)
+    {
+        return CopyString(L"Synthetic|" + displayName, pRetVal);
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetSessionInstanceIdentifier(LPWSTR* pRetVal)
+    {
+        return CopyString(L"Synthetic|" + displayName, pRetVal);
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetProcessId(DWORD* pRetVal)
+    {
+        // No process: AudioSession uses the display name and does not query process information.
+        *pRetVal = 0;
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::IsSystemSoundsSession()
+    {
+        return S_FALSE;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::SetDuckingPreference(BOOL)
+    {
+        return S_OK;
+    }
+    #pragma endregion
+
+
+    #pragma region ISimpleAudioVolume
+    STDMETHODIMP SyntheticAudioSessionControl::SetMasterVolume(float fLevel, LPCGUID)
+    {
+        // Changes made by the application are not notified back, AudioSession ignores its own event context anyway.
+        volume.store(fLevel);
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetMasterVolume(float* pfLevel)
+    {
+        *pfLevel = volume.load();
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::SetMute(const BOOL bMute, LPCGUID)
+    {
+        muted.store(bMute != FALSE);
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetMute(BOOL* pbMute)
+    {
+        *pbMute = muted.load() ? TRUE : FALSE;
+        return S_OK;
+    }
+    #pragma endregion
+
+
+    #pragma region IAudioMeterInformation
+    STDMETHODIMP SyntheticAudioSessionControl::GetPeakValue(float* pfPeak)
+    {
+        *pfPeak = peak.load(memory_order_relaxed);
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetMeteringChannelCount(UINT* pnChannelCount)
+    {
+        *pnChannelCount = ChannelCount;
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::GetChannelsPeakValues(UINT32 u32ChannelCount, float* afPeakValues)
+    {
+        if (u32ChannelCount != ChannelCount)
+        {
+            return E_INVALIDARG;
+        }
+
+        float value = peak.load(memory_order_relaxed);
+        for (UINT32 i = 0; i < u32ChannelCount; i++)
+        {
+            afPeakValues[i] = value;
+        }
+        return S_OK;
+    }
+
+    STDMETHODIMP SyntheticAudioSessionControl::QueryHardwareSupport(DWORD* pdwHardwareSupportMask)
+    {
+        *pdwHardwareSupportMask = 0;
+        return S_OK;
+    }
+    #pragma endregion
+
+
+    HRESULT SyntheticAudioSessionControl::CopyString(const wstring& string, LPWSTR* pRetVal)
+    {
+        size_t size = (string.size() + 1) * sizeof(wchar_t);
+        *pRetVal = static_cast<LPWSTR>(CoTaskMemAlloc(size));
+        if (!*pRetVal)
+        {
+            return E_OUTOFMEMORY;
+        }
+        memcpy(*pRetVal, string.c_str(), size);
+        return S_OK;
+    }
+    #pragma endregion
+
+
+    #pragma region SyntheticSessionBenchmark
+    SyntheticSessionBenchmark::SyntheticSessionBenchmark(LegacyAudioController* audioController, const SyntheticSessionSettings& settings) :
+        audioController{ audioController },
+        script{ settings }
+    {
+        audioController->AddRef();
+    }
+
+    SyntheticSessionBenchmark::~SyntheticSessionBenchmark()
+    {
+        Stop();
+
+        for (SyntheticAudioSessionControl* control : controls)
+        {
+            if (control)
+            {
+                control->Release();
+            }
+        }
+        controls.clear();
+        audioController->Release();
+    }
+
+
+    uint64_t SyntheticSessionBenchmark::AllocationCount()
+    {
+#if USE_SYNTHETIC_SESSIONS
+        return allocationCount.load(memory_order_relaxed);
+#else
+        return 0;
+#endif // USE_SYNTHETIC_SESSIONS
+    }
+
+    void SyntheticSessionBenchmark::Start()
+    {
+        if (running.exchange(true))
+        {
+            return;
+        }
+
+        thread = new std::thread(&SyntheticSessionBenchmark::ThreadFunction, this);
+    }
+
+    void SyntheticSessionBenchmark::Stop()
+    {
+        if (!running.exchange(false))
+        {
+            return;
+        }
+
+        if (thread)
+        {
+            thread->join();
+            delete thread;
+            thread = nullptr;
+        }
+    }
+
+    void SyntheticSessionBenchmark::EventHandled(const hstring& sessionName)
+    {
+        int64_t now = SteadyClockNanoseconds();
+
+        unique_lock lock{ measuresMutex };
+        auto it = pendingEvents.find(wstring(sessionName));
+        if (it != pendingEvents.end())
+        {
+            eventLatency.Add(static_cast<double>(now - it->second) / 1000000.);
+            pendingEvents.erase(it);
+        }
+    }
+
+    void SyntheticSessionBenchmark::TickMeasured(const chrono::nanoseconds& duration, const uint64_t& allocations)
+    {
+        unique_lock lock{ measuresMutex };
+        tickDuration.Add(static_cast<double>(duration.count()) / 1000000.);
+        tickAllocations.Add(static_cast<double>(allocations));
+    }
+
+    hstring SyntheticSessionBenchmark::Report()
+    {
+        unique_lock lock{ measuresMutex };
+
+        hstring report = L"Synthetic sessions (" + to_hstring(script.Settings().sessionCount) + L")" +
+            L" - peak meters tick: avg " + to_hstring(tickDuration.Mean()) + L" ms, max " + to_hstring(tickDuration.max) + L" ms" +
+            L", " + to_hstring(tickAllocations.Mean()) + L" allocations/tick over " + to_hstring(tickDuration.count) + L" ticks" +
+            L" - event to UI: avg " + to_hstring(eventLatency.Mean()) + L" ms, max " + to_hstring(eventLatency.max) + L" ms" +
+            L" (" + to_hstring(eventLatency.count) + L"/" + to_hstring(raisedEvents) + L" events handled)";
+
+        tickDuration = Measure();
+        tickAllocations = Measure();
+        eventLatency = Measure();
+        raisedEvents = 0;
+        // Events superseded by a later event of the same session, or never handled (session without view), are not reported.
+        pendingEvents.clear();
+
+        return report;
+    }
+
+
+    void SyntheticSessionBenchmark::ThreadFunction()
+    {
+        // AudioSession and the controller are free threaded, raise the notifications from the MTA like the audio service does.
+        bool uninitialize = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+        vector<SyntheticEvent> events{};
+        chrono::milliseconds period = chrono::milliseconds(static_cast<int64_t>(1000.f / (script.Settings().peakRate > 1.f ? script.Settings().peakRate : 1.f)));
+        chrono::steady_clock::time_point last = chrono::steady_clock::now();
+        while (running.load())
+        {
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            events.clear();
+            script.Advance(chrono::duration_cast<chrono::milliseconds>(now - last), events);
+            last = now;
+
+            for (const SyntheticEvent& event : events)
+            {
+                try
+                {
+                    Apply(event);
+                }
+                catch (const hresult_error& error)
+                {
+                    OutputDebugHString(L"Synthetic sessions: " + error.message());
+                }
+            }
+
+            this_thread::sleep_until(now + period);
+        }
+
+        if (uninitialize)
+        {
+            CoUninitialize();
+        }
+    }
+
+    void SyntheticSessionBenchmark::Apply(const SyntheticEvent& event)
+    {
+        if (event.session >= controls.size())
+        {
+            controls.resize(event.session + 1, nullptr);
+        }
+
+        SyntheticAudioSessionControl*& control = controls[event.session];
+        switch (event.type)
+        {
+            case SyntheticEventType::Add:
+            {
+                wstring name = L"Synthetic session " + to_wstring(++createdCount);
+                control = new SyntheticAudioSessionControl(name, event.value > 0.f);
+                EventRaised(name);
+                audioController->AddSyntheticSession(control);
+                break;
+            }
+
+            case SyntheticEventType::Expire:
+                if (control)
+                {
+                    wchar_t* name = nullptr;
+                    if (SUCCEEDED(control->GetDisplayName(&name)))
+                    {
+                        EventRaised(name);
+                        CoTaskMemFree(name);
+                    }
+                    control->RaiseStateChanged(::AudioSessionState::AudioSessionStateExpired);
+                    control->Release();
+                    control = nullptr;
+                }
+                break;
+
+            case SyntheticEventType::Activate:
+            case SyntheticEventType::Deactivate:
+            case SyntheticEventType::Volume:
+                if (control)
+                {
+                    wchar_t* name = nullptr;
+                    if (SUCCEEDED(control->GetDisplayName(&name)))
+                    {
+                        EventRaised(name);
+                        CoTaskMemFree(name);
+                    }
+
+                    if (event.type == SyntheticEventType::Volume)
+                    {
+                        control->RaiseVolumeChanged(event.value);
+                    }
+                    else
+                    {
+                        control->RaiseStateChanged(event.type == SyntheticEventType::Activate ?
+                            ::AudioSessionState::AudioSessionStateActive : ::AudioSessionState::AudioSessionStateInactive);
+                    }
+                }
+                break;
+
+            case SyntheticEventType::Peak:
+                if (control)
+                {
+                    control->Peak(event.value);
+                }
+                break;
+        }
+    }
+
+    void SyntheticSessionBenchmark::EventRaised(const wstring& sessionName)
+    {
+        unique_lock lock{ measuresMutex };
+        pendingEvents[sessionName] = SteadyClockNanoseconds();
+        raisedEvents++;
+    }
+    #pragma endregion
+}
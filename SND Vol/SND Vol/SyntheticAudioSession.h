@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "LegacyAudioController.h"
+#include "SyntheticSessionScript.h"
+
+// Adds synthetic sessions next to the system ones and periodically reports the cost of the metering and event paths. Debug builds only.
+#define USE_SYNTHETIC_SESSIONS 0
+#ifndef DEBUG
+#undef USE_SYNTHETIC_SESSIONS
+#define USE_SYNTHETIC_SESSIONS 0
+#endif
+
+namespace Audio
+{
+    /**
+     * @brief Stand-in for a system audio session: implements the session control, volume and meter interfaces used by AudioSession, and raises
+     * the IAudioSessionEvents notifications on demand.
+    */
+    class SyntheticAudioSessionControl : public IAudioSessionControl2, public ISimpleAudioVolume, public IAudioMeterInformation
+    {
+    public:
+        /**
+         * @brief Default constructor.
+         * @param displayName Display name of the session, used by AudioSession as the session name (the process id is 0)
+         * @param active True if the session starts in the active state
+        */
+        SyntheticAudioSessionControl(const std::wstring& displayName, const bool& active);
+
+        /**
+         * @brief Sets the peak value reported for every channel.
+         * @param peak Peak value ∈ [0, 1]
+        */
+        void Peak(const float& peak);
+        /**
+         * @brief Changes the volume as another application would, and notifies the registered client.
+         * @param volume New volume ∈ [0, 1]
+        */
+        void RaiseVolumeChanged(const float& volume);
+        /**
+         * @brief Changes the state of the session and notifies the registered client.
+         * @param state New state
+        */
+        void RaiseStateChanged(const ::AudioSessionState& state);
+
+        // IUnknown
+        IFACEMETHODIMP_(ULONG) AddRef();
+        IFACEMETHODIMP_(ULONG) Release();
+        IFACEMETHODIMP QueryInterface(REFIID riid, VOID** ppvInterface);
+
+        // IAudioSessionControl
+        STDMETHOD(GetState)(::AudioSessionState* pRetVal);
+        STDMETHOD(GetDisplayName)(LPWSTR* pRetVal);
+        STDMETHOD(SetDisplayName)(LPCWSTR Value, LPCGUID EventContext);
+        STDMETHOD(GetIconPath)(LPWSTR* pRetVal);
+        STDMETHOD(SetIconPath)(LPCWSTR Value, LPCGUID EventContext);
+        STDMETHOD(GetGroupingParam)(GUID* pRetVal);
+        STDMETHOD(SetGroupingParam)(LPCGUID Override, LPCGUID EventContext);
+        STDMETHOD(RegisterAudioSessionNotification)(IAudioSessionEvents* NewNotifications);
+        STDMETHOD(UnregisterAudioSessionNotification)(IAudioSessionEvents* NewNotifications);
+        // IAudioSessionControl2
+        STDMETHOD(GetSessionIdentifier)(LPWSTR* pRetVal);
+        STDMETHOD(GetSessionInstanceIdentifier)(LPWSTR* pRetVal);
+        STDMETHOD(GetProcessId)(DWORD* pRetVal);
+        STDMETHOD(IsSystemSoundsSession)();
+        STDMETHOD(SetDuckingPreference)(BOOL optOut);
+        // ISimpleAudioVolume
+        STDMETHOD(SetMasterVolume)(float fLevel, LPCGUID EventContext);
+        STDMETHOD(GetMasterVolume)(float* pfLevel);
+        STDMETHOD(SetMute)(const BOOL bMute, LPCGUID EventContext);
+        STDMETHOD(GetMute)(BOOL* pbMute);
+        // IAudioMeterInformation
+        STDMETHOD(GetPeakValue)(float* pfPeak);
+        STDMETHOD(GetMeteringChannelCount)(UINT* pnChannelCount);
+        STDMETHOD(GetChannelsPeakValues)(UINT32 u32ChannelCount, float* afPeakValues);
+        STDMETHOD(QueryHardwareSupport)(DWORD* pdwHardwareSupportMask);
+
+    private:
+        static constexpr uint32_t ChannelCount = 2;
+
+        ::winrt::impl::atomic_ref_count refCount{ 1 };
+        std::mutex eventsMutex{};
+        IAudioSessionEvents* events = nullptr;
+        std::wstring displayName;
+        GUID groupingParam{};
+        GUID eventContext{};
+        std::atomic<::AudioSessionState> state;
+        std::atomic<float> volume = 1.f;
+        std::atomic_bool muted = false;
+        std::atomic<float> peak = 0.f;
+
+        static HRESULT CopyString(const std::wstring& string, LPWSTR* pRetVal);
+    };
+
+
+    /**
+     * @brief Drives synthetic sessions from a SyntheticSessionScript on a background thread and measures the cost of the UI paths: per tick
+     * cost and allocations of the peak meters update, and latency between an audio event and its handling on the UI thread.
+    */
+    class SyntheticSessionBenchmark
+    {
+    public:
+        /**
+         * @brief Default constructor.
+         * @param audioController Controller the synthetic sessions are added to, raising its SessionAdded event
+         * @param settings Session count and event rates
+        */
+        SyntheticSessionBenchmark(LegacyAudioController* audioController, const SyntheticSessionSettings& settings);
+        ~SyntheticSessionBenchmark();
+
+        /**
+         * @brief Number of allocations made by the process since it started, only counted when USE_SYNTHETIC_SESSIONS is set.
+        */
+        static uint64_t AllocationCount();
+
+        void Start();
+        void Stop();
+        /**
+         * @brief Records the handling of an event on the UI thread.
+         * @param sessionName Name of the session the event has been raised for
+        */
+        void EventHandled(const winrt::hstring& sessionName);
+        /**
+         * @brief Records the cost of a peak meters update.
+         * @param duration Duration of the update
+         * @param allocations Number of allocations made by the update
+        */
+        void TickMeasured(const std::chrono::nanoseconds& duration, const uint64_t& allocations);
+        /**
+         * @brief Formats the measurements made since the last report and resets them.
+         * @return Report
+        */
+        winrt::hstring Report();
+
+    private:
+        struct Measure
+        {
+            uint64_t count = 0;
+            double total = 0.;
+            double max = 0.;
+
+            inline void Add(const double& value)
+            {
+                count++;
+                total += value;
+                max = value > max ? value : max;
+            };
+
+            inline double Mean() const
+            {
+                return count > 0 ? total / static_cast<double>(count) : 0.;
+            };
+        };
+
+        LegacyAudioController* audioController = nullptr;
+        SyntheticSessionScript script;
+        std::thread* thread = nullptr;
+        std::atomic_bool running = false;
+        // Script thread only.
+        std::vector<SyntheticAudioSessionControl*> controls{};
+        uint32_t createdCount = 0;
+        std::mutex measuresMutex{};
+        /**
+         * @brief Session name -> time at which the last pending event has been raised, in steady clock nanoseconds.
+        */
+        std::unordered_map<std::wstring, int64_t> pendingEvents{};
+        Measure tickDuration{};
+        Measure tickAllocations{};
+        Measure eventLatency{};
+        uint64_t raisedEvents = 0;
+
+        void ThreadFunction();
+        void Apply(const SyntheticEvent& event);
+        void EventRaised(const std::wstring& sessionName);
+    };
+}
@@ -0,0 +1,158 @@
+#include "SyntheticSessionScript.h"
+
+#include <math.h>
+
+using namespace std;
+
+
+namespace Audio
+{
+    SyntheticSessionScript::SyntheticSessionScript(const SyntheticSessionSettings& settings) :
+        settings{ settings },
+        state{ settings.seed != 0 ? settings.seed : 1 }
+    {
+    }
+
+
+    void SyntheticSessionScript::Advance(const chrono::milliseconds& elapsed, vector<SyntheticEvent>& events)
+    {
+        if (!started)
+        {
+            started = true;
+            sessions.reserve(settings.sessionCount);
+            for (uint32_t i = 0; i < settings.sessionCount; i++)
+            {
+                AddSession(events);
+            }
+        }
+
+        double seconds = static_cast<double>(elapsed.count()) / 1000.;
+        time += seconds;
+
+        churnBudget += settings.churnRate * seconds;
+        while (churnBudget >= 1.)
+        {
+            churnBudget -= 1.;
+
+            uint32_t slot = PickSession();
+            if (slot == sessions.size())
+            {
+                break;
+            }
+
+            sessions[slot].alive = false;
+            freeSlots.push_back(slot);
+            events.push_back(SyntheticEvent{ SyntheticEventType::Expire, slot, 0.f });
+            AddSession(events);
+        }
+
+        stateBudget += settings.stateChangeRate * seconds;
+        while (stateBudget >= 1.)
+        {
+            stateBudget -= 1.;
+
+            uint32_t slot = PickSession();
+            if (slot == sessions.size())
+            {
+                break;
+            }
+
+            sessions[slot].active = !sessions[slot].active;
+            events.push_back(SyntheticEvent{ sessions[slot].active ? SyntheticEventType::Activate : SyntheticEventType::Deactivate, slot, 0.f });
+        }
+
+        volumeBudget += settings.volumeChangeRate * seconds;
+        while (volumeBudget >= 1.)
+        {
+            volumeBudget -= 1.;
+
+            uint32_t slot = PickSession();
+            if (slot == sessions.size())
+            {
+                break;
+            }
+
+            events.push_back(SyntheticEvent{ SyntheticEventType::Volume, slot, NextFloat() });
+        }
+
+        // Peaks of every active session are updated together, like an audio engine period.
+        peakBudget += settings.peakRate * seconds;
+        if (peakBudget >= 1.)
+        {
+            peakBudget -= floor(peakBudget);
+
+            for (uint32_t slot = 0; slot < sessions.size(); slot++)
+            {
+                const SessionState& session = sessions[slot];
+                if (!session.alive || !session.active)
+                {
+                    continue;
+                }
+
+                // Slow envelope with some noise on top, so that the meters and the polling scheduler see movement.
+                float envelope = 0.5f + 0.4f * static_cast<float>(sin(6.283185307179586 * session.frequency * time + session.phase));
+                float peak = envelope * (0.8f + 0.2f * NextFloat());
+                events.push_back(SyntheticEvent{ SyntheticEventType::Peak, slot, peak });
+            }
+        }
+    }
+
+
+    uint32_t SyntheticSessionScript::Next()
+    {
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    float SyntheticSessionScript::NextFloat()
+    {
+        return static_cast<float>(Next() >> 8) / static_cast<float>(1u << 24);
+    }
+
+    uint32_t SyntheticSessionScript::AddSession(vector<SyntheticEvent>& events)
+    {
+        uint32_t slot = 0;
+        if (!freeSlots.empty())
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<uint32_t>(sessions.size());
+            sessions.push_back(SessionState());
+        }
+
+        SessionState& session = sessions[slot];
+        session.alive = true;
+        session.active = (Next() & 1) != 0;
+        session.phase = NextFloat() * 6.2831853f;
+        session.frequency = 0.1f + NextFloat() * 2.f;
+
+        events.push_back(SyntheticEvent{ SyntheticEventType::Add, slot, session.active ? 1.f : 0.f });
+        return slot;
+    }
+
+    uint32_t SyntheticSessionScript::PickSession()
+    {
+        uint32_t count = static_cast<uint32_t>(sessions.size());
+        if (count == 0)
+        {
+            return count;
+        }
+
+        uint32_t start = Next() % count;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t slot = (start + i) % count;
+            if (sessions[slot].alive)
+            {
+                return slot;
+            }
+        }
+        return count;
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+
+namespace Audio
+{
+    struct SyntheticSessionSettings
+    {
+        /**
+         * @brief Number of live sessions, kept constant by the churn (each expired session is replaced).
+        */
+        uint32_t sessionCount = 100;
+        /**
+         * @brief Peak updates per second of each active session.
+        */
+        float peakRate = 100.f;
+        /**
+         * @brief Volume changes per second, all sessions combined.
+        */
+        float volumeChangeRate = 20.f;
+        /**
+         * @brief Active/inactive transitions per second, all sessions combined.
+        */
+        float stateChangeRate = 4.f;
+        /**
+         * @brief Sessions expiring (and replaced by a new session) per second.
+        */
+        float churnRate = 1.f;
+        uint32_t seed = 0x2545f491;
+    };
+
+    enum class SyntheticEventType : uint8_t
+    {
+        /**
+         * @brief A session is created, value is 1 if the session starts active.
+        */
+        Add,
+        Expire,
+        Activate,
+        Deactivate,
+        /**
+         * @brief Volume changed by another application, value is the new volume.
+        */
+        Volume,
+        /**
+         * @brief New peak value of an active session.
+        */
+        Peak
+    };
+
+    struct SyntheticEvent
+    {
+        SyntheticEventType type = SyntheticEventType::Peak;
+        /**
+         * @brief Slot of the session. Slots of expired sessions are reused by the next Add.
+        */
+        uint32_t session = 0;
+        float value = 0.f;
+    };
+
+    /**
+     * @brief Deterministic generator of audio session activity (creation, expiration, state and volume changes, peaks) at configurable rates.
+     * Only depends on the standard library, the same seed and sequence of Advance calls always produce the same events.
+    */
+    class SyntheticSessionScript
+    {
+    public:
+        /**
+         * @brief Default constructor.
+         * @param settings Session count, event rates and seed
+        */
+        SyntheticSessionScript(const SyntheticSessionSettings& settings);
+
+        inline const SyntheticSessionSettings& Settings() const
+        {
+            return settings;
+        };
+
+        /**
+         * @brief Advances the script. The first call creates the initial sessions.
+         * @param elapsed Time elapsed since the previous call
+         * @param events Receives the events due in the elapsed time, in order
+        */
+        void Advance(const std::chrono::milliseconds& elapsed, std::vector<SyntheticEvent>& events);
+
+    private:
+        struct SessionState
+        {
+            bool alive = false;
+            bool active = false;
+            float phase = 0.f;
+            float frequency = 0.f;
+        };
+
+        SyntheticSessionSettings settings;
+        std::vector<SessionState> sessions{};
+        std::vector<uint32_t> freeSlots{};
+        uint32_t state = 0;
+        bool started = false;
+        double time = 0.;
+        double peakBudget = 0.;
+        double volumeBudget = 0.;
+        double stateBudget = 0.;
+        double churnBudget = 0.;
+
+        uint32_t Next();
+        float NextFloat();
+        uint32_t AddSession(std::vector<SyntheticEvent>& events);
+        /**
+         * @brief Picks a random live session.
+         * @return Slot of the session, or the number of slots if no session is alive
+        */
+        uint32_t PickSession();
+    };
+}
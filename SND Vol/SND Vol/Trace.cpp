@@ -0,0 +1,144 @@
+#include "pch.h"
+#include "Trace.h"
+
+#include <fstream>
+
+using namespace std;
+using namespace winrt;
+
+
+namespace System
+{
+	atomic_bool Trace::enabled = false;
+
+	void Trace::Enabled(const bool& value)
+	{
+		enabled.store(value);
+	}
+
+	void Trace::Record(const TraceEvent& event)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+
+		// Single writer: the slot is written first, then published with the release store.
+		uint64_t index = buffer.written.load(memory_order_relaxed);
+		buffer.events[index % BufferCapacity] = event;
+		buffer.written.store(index + 1, memory_order_release);
+	}
+
+	string Trace::ToJson()
+	{
+		vector<pair<uint32_t, vector<TraceEvent>>> threads{};
+		{
+			unique_lock lock{ BuffersMutex() };
+			for (const unique_ptr<ThreadBuffer>& buffer : Buffers())
+			{
+				uint64_t last = buffer->written.load(memory_order_acquire);
+				uint64_t first = last > BufferCapacity ? last - BufferCapacity : 0;
+
+				vector<TraceEvent> events{};
+				events.reserve(static_cast<size_t>(last - first));
+				for (uint64_t i = first; i < last; i++)
+				{
+					events.push_back(buffer->events[i % BufferCapacity]);
+				}
+
+				// Drop the events the owner thread may have overwritten while they were copied, including the slot it may be writing.
+				atomic_thread_fence(memory_order_acquire);
+				uint64_t written = buffer->written.load(memory_order_acquire);
+				uint64_t overwritten = written + 1 > BufferCapacity ? written + 1 - BufferCapacity : 0;
+				if (overwritten > first)
+				{
+					size_t count = static_cast<size_t>(overwritten - first);
+					events.erase(events.begin(), events.begin() + (count < events.size() ? count : events.size()));
+				}
+
+				threads.push_back({ buffer->threadId, move(events) });
+			}
+		}
+
+		uint32_t processId = GetCurrentProcessId();
+		string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool firstEvent = true;
+		char number[32]{};
+		for (const auto& [threadId, events] : threads)
+		{
+			for (const TraceEvent& event : events)
+			{
+				json += firstEvent ? "\n" : ",\n";
+				firstEvent = false;
+
+				// Names are string literals (identifiers), they do not need escaping.
+				json += "{\"name\":\"" + winrt::to_string(event.name) + "\",\"cat\":\"audio\",\"ph\":\"X\"";
+				snprintf(number, sizeof(number), "%.3f", static_cast<double>(event.start) / 1000.);
+				json += ",\"ts\":";
+				json += number;
+				snprintf(number, sizeof(number), "%.3f", static_cast<double>(event.duration) / 1000.);
+				json += ",\"dur\":";
+				json += number;
+				json += ",\"pid\":" + std::to_string(processId) + ",\"tid\":" + std::to_string(threadId);
+
+				json += ",\"args\":{";
+				bool hasSession = event.session != GUID{};
+				if (hasSession)
+				{
+					json += "\"session\":\"" + winrt::to_string(to_hstring(guid(event.session))) + "\"";
+				}
+				if (event.processId != 0)
+				{
+					json += hasSession ? "," : "";
+					json += "\"process\":" + std::to_string(event.processId);
+				}
+				json += "}}";
+			}
+		}
+		json += "\n]}\n";
+
+		return json;
+	}
+
+	wstring Trace::Dump()
+	{
+		filesystem::path path = filesystem::path(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path().c_str()) /
+			(L"trace-" + std::to_wstring(chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count()) + L".json");
+
+		string json = ToJson();
+		ofstream file{ path, ios::binary | ios::trunc };
+		file.write(json.data(), static_cast<streamsize>(json.size()));
+		if (!file)
+		{
+			throw hresult_error(E_FAIL, L"Failed to write trace file " + hstring(path.wstring()));
+		}
+
+		return path.wstring();
+	}
+
+
+	mutex& Trace::BuffersMutex()
+	{
+		static mutex buffersMutex{};
+		return buffersMutex;
+	}
+
+	vector<unique_ptr<Trace::ThreadBuffer>>& Trace::Buffers()
+	{
+		// Buffers outlive their threads, the events of exited threads are still exported.
+		static vector<unique_ptr<ThreadBuffer>> buffers{};
+		return buffers;
+	}
+
+	Trace::ThreadBuffer& Trace::GetThreadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (!buffer)
+		{
+			unique_ptr<ThreadBuffer> newBuffer = make_unique<ThreadBuffer>();
+			newBuffer->threadId = GetCurrentThreadId();
+			buffer = newBuffer.get();
+
+			unique_lock lock{ BuffersMutex() };
+			Buffers().push_back(move(newBuffer));
+		}
+		return *buffer;
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace System
+{
+	/**
+	 * @brief Completed span, recorded by the thread that ran it.
+	*/
+	struct TraceEvent
+	{
+		/**
+		 * @brief Name of the span, a string literal.
+		*/
+		const wchar_t* name = nullptr;
+		/**
+		 * @brief Start of the span, in steady clock nanoseconds.
+		*/
+		int64_t start = 0;
+		int64_t duration = 0;
+		/**
+		 * @brief Audio session the span is about, null GUID if none.
+		*/
+		GUID session{};
+		/**
+		 * @brief Process the span is about (owner of the audio session, queried process), 0 if none.
+		*/
+		uint32_t processId = 0;
+	};
+
+	/**
+	 * @brief Collects timed spans into per-thread ring buffers and exports them as Chrome trace_event JSON (chrome://tracing, Perfetto).
+	 * Recording a span is lock-free and does not allocate, except for the first span of a thread which creates the thread buffer.
+	*/
+	class Trace
+	{
+	public:
+		/**
+		 * @brief Events kept per thread, older events are overwritten.
+		*/
+		static constexpr size_t BufferCapacity = 8192;
+
+		inline static bool Enabled()
+		{
+			return enabled.load(std::memory_order_relaxed);
+		};
+		/**
+		 * @brief Enables or disables recording. Spans started while disabled are not recorded.
+		*/
+		static void Enabled(const bool& value);
+
+		/**
+		 * @brief Records a completed span in the buffer of the calling thread.
+		*/
+		static void Record(const TraceEvent& event);
+		/**
+		 * @brief Formats the events of every thread as Chrome trace_event JSON. Can be called while other threads record.
+		 * @return JSON document
+		*/
+		static std::string ToJson();
+		/**
+		 * @brief Writes ToJson to a new file in the application local folder.
+		 * @return Path of the file
+		*/
+		static std::wstring Dump();
+
+	private:
+		struct ThreadBuffer
+		{
+			uint32_t threadId = 0;
+			/**
+			 * @brief Number of events ever written, the last BufferCapacity of them are in the ring.
+			*/
+			std::atomic<uint64_t> written = 0;
+			std::array<TraceEvent, BufferCapacity> events{};
+		};
+
+		static std::atomic_bool enabled;
+
+		static std::mutex& BuffersMutex();
+		static std::vector<std::unique_ptr<ThreadBuffer>>& Buffers();
+		static ThreadBuffer& GetThreadBuffer();
+	};
+
+	/**
+	 * @brief Times its own lifetime and records it as a Trace event. Does nothing when tracing is disabled.
+	*/
+	class TraceSpan
+	{
+	public:
+		/**
+		 * @brief Default constructor, starts the span.
+		 * @param name Name of the span, must be a string literal
+		 * @param session Audio session the span is about
+		 * @param processId Process the span is about
+		*/
+		TraceSpan(const wchar_t* name, const GUID& session = GUID{}, const uint32_t& processId = 0)
+		{
+			if (Trace::Enabled())
+			{
+				event.name = name;
+				event.session = session;
+				event.processId = processId;
+				event.start = Now();
+			}
+		};
+		TraceSpan(const TraceSpan&) = delete;
+
+		~TraceSpan()
+		{
+			if (event.name)
+			{
+				event.duration = Now() - event.start;
+				Trace::Record(event);
+			}
+		};
+
+		TraceSpan& operator=(const TraceSpan&) = delete;
+
+	private:
+		TraceEvent event{};
+
+		inline static int64_t Now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		};
+	};
+}
+
+#define TRACE_SPAN_CONCAT_INNER(a, b) a##b
+#define TRACE_SPAN_CONCAT(a, b) TRACE_SPAN_CONCAT_INNER(a, b)
+/**
+ * @brief Traces the rest of the enclosing scope: TRACE_SPAN(L"Name"), TRACE_SPAN(L"Name", sessionGuid) or TRACE_SPAN(L"Name", sessionGuid, pid).
+*/
+#define TRACE_SPAN(...) ::System::TraceSpan TRACE_SPAN_CONCAT(traceSpan, __LINE__){ __VA_ARGS__ }
@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "VolumeWriter.h"
+
+using namespace std;
+using namespace winrt;
+
+
+namespace Audio
+{
+    VolumeWriter::VolumeWriter(const chrono::milliseconds& interval) :
+        interval{ interval }
+    {
+        thread = new std::thread(&VolumeWriter::ThreadFunction, this);
+    }
+
+    VolumeWriter::~VolumeWriter()
+    {
+        Stop();
+    }
+
+
+    void VolumeWriter::Write(AudioSession* session, const float& volume)
+    {
+        Request request{};
+        request.session = session;
+        request.volume = volume;
+        Enqueue(session, request);
+    }
+
+    void VolumeWriter::Write(MainAudioEndpoint* endpoint, const float& volume, const bool& notify)
+    {
+        Request request{};
+        request.endpoint = endpoint;
+        request.notify = notify;
+        request.volume = volume;
+        Enqueue(endpoint, request);
+    }
+
+    bool VolumeWriter::Pending(const void* target, float& volume)
+    {
+        unique_lock lock{ requestsMutex };
+        auto it = requests.find(target);
+        if (it == requests.end())
+        {
+            return false;
+        }
+        volume = it->second.volume;
+        return true;
+    }
+
+    void VolumeWriter::Flush()
+    {
+        unique_lock lock{ requestsMutex };
+        if (!running)
+        {
+            return;
+        }
+
+        flushRequested = true;
+        requestsCondition.notify_all();
+        flushedCondition.wait(lock, [this]()
+        {
+            return !running || (requests.empty() && !writing);
+        });
+        flushRequested = false;
+    }
+
+    void VolumeWriter::Stop()
+    {
+        {
+            unique_lock lock{ requestsMutex };
+            running = false;
+        }
+        requestsCondition.notify_all();
+
+        if (thread)
+        {
+            thread->join();
+            delete thread;
+            thread = nullptr;
+        }
+    }
+
+    VolumeWriterStatistics VolumeWriter::Statistics()
+    {
+        unique_lock lock{ requestsMutex };
+        return statistics;
+    }
+
+
+    void VolumeWriter::Enqueue(const void* target, const Request& request)
+    {
+        {
+            unique_lock lock{ requestsMutex };
+            if (!running)
+            {
+                return;
+            }
+
+            statistics.requests++;
+            burstRequests++;
+
+            Request& pending = requests[target];
+            bool merged = pending.session || pending.endpoint;
+            chrono::steady_clock::time_point time = merged ? pending.time : chrono::steady_clock::now();
+            if (merged)
+            {
+                statistics.merged++;
+            }
+            else
+            {
+                // New pending target, kept alive until written. Replaced requests keep the reference of the first one.
+                if (request.session)
+                {
+                    request.session->AddRef();
+                }
+                else
+                {
+                    request.endpoint->AddRef();
+                }
+            }
+            // Latency is measured from the first request of the target, merged requests keep its time.
+            pending = request;
+            pending.time = time;
+        }
+        requestsCondition.notify_one();
+    }
+
+    void VolumeWriter::ThreadFunction()
+    {
+        // Audio endpoint and session interfaces are free threaded, the writer lives in the MTA.
+        bool uninitialize = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+        vector<Request> batch{};
+        chrono::steady_clock::time_point lastFlush{};
+        while (true)
+        {
+            {
+                unique_lock lock{ requestsMutex };
+                if (requests.empty() && burstWrites > 0)
+                {
+                    OutputDebugHString(
+                        L"Volume writer: " + to_hstring(burstRequests) + L" requests, " + to_hstring(burstWrites) + L" writes, latency max " +
+                        to_hstring(burstMaxLatency) + L" ms, mean " + to_hstring(statistics.meanLatency) + L" ms (" +
+                        to_hstring(statistics.writes) + L" writes)."
+                    );
+                    burstRequests = 0;
+                    burstWrites = 0;
+                    burstMaxLatency = 0.;
+                }
+
+                requestsCondition.wait(lock, [this]()
+                {
+                    return !running || !requests.empty();
+                });
+
+                // Bounded rate: requests arriving until the next flush are merged. Pending values are written before stopping, and
+                // immediately when a flush is requested.
+                if (running && !flushRequested)
+                {
+                    requestsCondition.wait_until(lock, lastFlush + interval, [this]()
+                    {
+                        return !running || flushRequested;
+                    });
+                }
+
+                if (requests.empty())
+                {
+                    flushedCondition.notify_all();
+                    break;
+                }
+
+                batch.clear();
+                for (auto& [target, request] : requests)
+                {
+                    batch.push_back(request);
+                }
+                requests.clear();
+                writing = true;
+            }
+
+            for (const Request& request : batch)
+            {
+                Apply(request);
+            }
+            lastFlush = chrono::steady_clock::now();
+
+            {
+                unique_lock lock{ requestsMutex };
+                writing = false;
+            }
+            flushedCondition.notify_all();
+        }
+
+        if (uninitialize)
+        {
+            CoUninitialize();
+        }
+    }
+
+    void VolumeWriter::Apply(const Request& request)
+    {
+        bool failed = false;
+        try
+        {
+            if (request.session)
+            {
+                request.session->Volume(request.volume);
+            }
+            else if (request.notify)
+            {
+                request.endpoint->SetVolume(request.volume);
+            }
+            else
+            {
+                request.endpoint->Volume(request.volume);
+            }
+        }
+        catch (const hresult_error& error)
+        {
+            failed = true;
+            OutputDebugHString(L"Volume writer: failed to write volume: " + error.message());
+        }
+
+        double latency = chrono::duration<double, milli>(chrono::steady_clock::now() - request.time).count();
+        if (request.session)
+        {
+            request.session->Release();
+        }
+        else
+        {
+            request.endpoint->Release();
+        }
+
+        unique_lock lock{ requestsMutex };
+        if (failed)
+        {
+            statistics.failures++;
+            return;
+        }
+
+        statistics.writes++;
+        burstWrites++;
+        totalLatency += latency;
+        statistics.meanLatency = totalLatency / static_cast<double>(statistics.writes);
+        statistics.maxLatency = latency > statistics.maxLatency ? latency : statistics.maxLatency;
+        burstMaxLatency = latency > burstMaxLatency ? latency : burstMaxLatency;
+    }
+}
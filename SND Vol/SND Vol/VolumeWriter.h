@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "AudioSession.h"
+#include "MainAudioEndpoint.h"
+
+namespace Audio
+{
+    struct VolumeWriterStatistics
+    {
+        uint64_t requests = 0;
+        uint64_t writes = 0;
+        /**
+         * @brief Requests replaced by a later request for the same target before being written.
+        */
+        uint64_t merged = 0;
+        uint64_t failures = 0;
+        /**
+         * @brief Time between the request of a written value and the end of its write, in milliseconds.
+        */
+        double meanLatency = 0.;
+        double maxLatency = 0.;
+    };
+
+    /**
+     * @brief Writes volumes to the audio service from a worker thread, at a bounded rate: only the latest requested value of each target is
+     * kept, and the last requested value is always written. Slider drags and hot key repeats never block the UI thread on the audio service.
+    */
+    class VolumeWriter
+    {
+    public:
+        /**
+         * @brief Minimum time between two flushes of the pending values.
+        */
+        static constexpr std::chrono::milliseconds DefaultInterval{ 16 };
+
+        VolumeWriter(const std::chrono::milliseconds& interval = DefaultInterval);
+        ~VolumeWriter();
+
+        /**
+         * @brief Requests a session volume, written with the session event context (no VolumeChanged event).
+         * @param session Session, kept alive until the value has been written
+         * @param volume Volume ∈ [0, 1]
+        */
+        void Write(AudioSession* session, const float& volume);
+        /**
+         * @brief Requests an endpoint volume.
+         * @param endpoint Endpoint, kept alive until the value has been written
+         * @param volume Volume ∈ [0, 1]
+         * @param notify True to write without the endpoint event context, the change is then notified like a change made by another application
+        */
+        void Write(MainAudioEndpoint* endpoint, const float& volume, const bool& notify);
+        /**
+         * @brief Gets the value waiting to be written for a target, the audio service does not know it yet.
+         * @param target Session or endpoint
+         * @param volume Receives the pending value
+         * @return False if nothing is pending for the target
+        */
+        bool Pending(const void* target, float& volume);
+        /**
+         * @brief Writes the pending values now and waits until they have been written. The writer keeps running.
+        */
+        void Flush();
+        /**
+         * @brief Writes the pending values and stops the worker thread, later requests are dropped.
+        */
+        void Stop();
+
+        VolumeWriterStatistics Statistics();
+
+    private:
+        struct Request
+        {
+            AudioSession* session = nullptr;
+            MainAudioEndpoint* endpoint = nullptr;
+            bool notify = false;
+            float volume = 0.f;
+            std::chrono::steady_clock::time_point time{};
+        };
+
+        std::chrono::milliseconds interval;
+        std::thread* thread = nullptr;
+        std::mutex requestsMutex{};
+        std::condition_variable requestsCondition{};
+        std::condition_variable flushedCondition{};
+        bool running = true;
+        bool flushRequested = false;
+        /**
+         * @brief True while a batch taken from the pending requests is being written.
+        */
+        bool writing = false;
+        /**
+         * @brief Target -> latest request.
+        */
+        std::unordered_map<const void*, Request> requests{};
+        VolumeWriterStatistics statistics{};
+        // Statistics of the current burst of requests, reported when the writer goes idle.
+        uint64_t burstRequests = 0;
+        uint64_t burstWrites = 0;
+        double burstMaxLatency = 0.;
+        double totalLatency = 0.;
+
+        void Enqueue(const void* target, const Request& request);
+        void ThreadFunction();
+        void Apply(const Request& request);
+    };
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <iostream>
+
+/*
+* Minimal assertions for the headless tests: a failed check is reported with its location and fails the test, the test goes on.
+*/
+
+namespace Tests
+{
+    inline int& Failures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    inline int Result()
+    {
+        if (Failures() > 0)
+        {
+            std::cerr << Failures() << " check(s) failed." << std::endl;
+        }
+        return Failures() > 0 ? 1 : 0;
+    }
+}
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            ::Tests::Failures()++; \
+        } \
+    } while (false)
@@ -0,0 +1,143 @@
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include "Check.h"
+#include "MeterBallistics.h"
+
+using namespace std;
+using namespace Audio;
+
+/*
+* Synthetic peak sequences stepped through the ballistics, expected values in Q16 (MeterBallistics::One is full scale).
+*/
+
+static uint32_t ExpectedCoefficient(const double& elapsed, const double& timeConstant)
+{
+    return static_cast<uint32_t>((1. - exp(-elapsed / timeConstant)) * MeterBallistics::One + 0.5);
+}
+
+static bool Near(const uint32_t& value, const uint32_t& expected, const uint32_t& tolerance)
+{
+    return (value > expected ? value - expected : expected - value) <= tolerance;
+}
+
+
+static void StepResponse()
+{
+    MeterBallistics ballistics{ MeterBallisticsSettings{ chrono::milliseconds(10), chrono::milliseconds(300), chrono::milliseconds(1000) } };
+    ballistics.Prepare(chrono::milliseconds(16));
+
+    // 0 -> full scale: the first step covers 1 - e^(-16/10) of the distance.
+    MeterChannelState state{};
+    ballistics.Step(state, 1.f);
+    CHECK(state.level == ExpectedCoefficient(16., 10.));
+    CHECK(state.hold == state.level);
+
+    // Converges to full scale exactly, never overshoots.
+    uint32_t previous = state.level;
+    for (int i = 0; i < 64; i++)
+    {
+        ballistics.Step(state, 1.f);
+        CHECK(state.level >= previous && state.level <= MeterBallistics::One);
+        previous = state.level;
+    }
+    CHECK(state.level == MeterBallistics::One);
+
+    // Instantaneous attack.
+    MeterBallistics instant{ MeterBallisticsSettings{ chrono::milliseconds(0), chrono::milliseconds(300), chrono::milliseconds(1000) } };
+    instant.Prepare(chrono::milliseconds(16));
+    MeterChannelState instantState{};
+    instant.Step(instantState, 0.5f);
+    CHECK(instantState.level == MeterBallistics::ToFixed(0.5f));
+    CHECK(instantState.level == MeterBallistics::One / 2);
+}
+
+static void HoldDuration()
+{
+    MeterBallistics ballistics{ MeterBallisticsSettings{ chrono::milliseconds(0), chrono::milliseconds(300), chrono::milliseconds(1000) } };
+    ballistics.Prepare(chrono::milliseconds(10));
+
+    MeterChannelState state{};
+    ballistics.Step(state, 1.f);
+    CHECK(state.hold == MeterBallistics::One);
+    CHECK(state.holdRemaining == 1000);
+
+    // Silence: the marker stays at its maximum for the hold time (100 steps of 10 ms) while the level falls.
+    for (int i = 0; i < 100; i++)
+    {
+        ballistics.Step(state, 0.f);
+        CHECK(state.hold == MeterBallistics::One);
+    }
+    CHECK(state.holdRemaining == 0);
+    CHECK(state.level < MeterBallistics::One);
+
+    // Then falls with the release time constant.
+    ballistics.Step(state, 0.f);
+    CHECK(state.hold < MeterBallistics::One);
+    CHECK(state.hold >= state.level);
+
+    // A new maximum re-arms the hold.
+    ballistics.Step(state, 1.f);
+    CHECK(state.hold == MeterBallistics::One && state.holdRemaining == 1000);
+}
+
+static void ReleaseSlope()
+{
+    MeterBallistics ballistics{ MeterBallisticsSettings{ chrono::milliseconds(0), chrono::milliseconds(300), chrono::milliseconds(1000) } };
+    ballistics.Prepare(chrono::milliseconds(10));
+
+    MeterChannelState state{};
+    ballistics.Step(state, 1.f);
+
+    // First step of the fall: exactly the release coefficient of full scale.
+    ballistics.Step(state, 0.f);
+    CHECK(state.level == MeterBallistics::One - ExpectedCoefficient(10., 300.));
+
+    // Each step keeps e^(-10/300) of the level, within the Q16 truncation of the steps.
+    uint32_t previous = state.level;
+    for (int i = 0; i < 10; i++)
+    {
+        ballistics.Step(state, 0.f);
+        uint32_t expected = static_cast<uint32_t>(previous * exp(-10. / 300.));
+        CHECK(Near(state.level, expected, 2));
+        previous = state.level;
+    }
+
+    // One time constant after the peak (30 steps): 1/e of full scale.
+    for (int i = 0; i < 19; i++)
+    {
+        ballistics.Step(state, 0.f);
+    }
+    CHECK(Near(state.level, static_cast<uint32_t>(MeterBallistics::One * exp(-1.)), 32));
+
+    // The level reaches 0 exactly instead of stalling at the last Q16 step.
+    for (int i = 0; i < 2000 && state.level > 0; i++)
+    {
+        ballistics.Step(state, 0.f);
+    }
+    CHECK(state.level == 0);
+}
+
+static void Deterministic()
+{
+    MeterBallistics ballistics{};
+    MeterChannelState a{};
+    MeterChannelState b{};
+    const float peaks[] = { 0.f, 0.9f, 0.2f, 0.2f, 1.f, 0.f, 0.f, 0.5f, 0.f, 0.3f };
+    for (int i = 0; i < 100; i++)
+    {
+        ballistics.Prepare(chrono::milliseconds(8 + i % 9));
+        ballistics.Step(a, peaks[i % 10]);
+        ballistics.Step(b, peaks[i % 10]);
+    }
+    CHECK(a.level == b.level && a.hold == b.hold && a.holdRemaining == b.holdRemaining);
+}
+
+int main()
+{
+    StepResponse();
+    HoldDuration();
+    ReleaseSlope();
+    Deterministic();
+    return Tests::Result();
+}
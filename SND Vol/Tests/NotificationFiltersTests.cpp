@@ -0,0 +1,169 @@
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "NotificationFilters.h"
+
+using namespace std;
+using namespace Audio;
+
+/*
+* Notification traces are replayed through the filters, one notification per line:
+*   "<time ms> created <instance id>"                 session creation (OnSessionCreated)
+*   "<time ms> expired <instance id>"                 session expiry (OnStateChanged AudioSessionStateExpired, OnSessionDisconnected)
+*   "<time ms> default <flow> <role> <device id>"     default device change (OnDefaultDeviceChanged)
+* The replay returns the notifications let through, in order.
+*/
+
+static vector<wstring> Replay(const wstring& trace, const chrono::milliseconds& window = DeviceChangeFilter::DefaultWindow)
+{
+    SessionCreationFilter creationFilter{};
+    DeviceChangeFilter deviceFilter{ window };
+    vector<wstring> accepted{};
+
+    wistringstream lines{ trace };
+    wstring line{};
+    while (getline(lines, line))
+    {
+        wistringstream fields{ line };
+        int64_t time = 0;
+        wstring type{};
+        if (!(fields >> time >> type))
+        {
+            continue;
+        }
+
+        chrono::steady_clock::time_point now{ chrono::milliseconds(time) };
+        if (type == L"created")
+        {
+            wstring instanceId{};
+            fields >> instanceId;
+            if (creationFilter.Accept(instanceId))
+            {
+                accepted.push_back(L"created " + instanceId);
+            }
+        }
+        else if (type == L"expired")
+        {
+            wstring instanceId{};
+            fields >> instanceId;
+            creationFilter.Remove(instanceId);
+        }
+        else if (type == L"default")
+        {
+            uint32_t flow = 0;
+            uint32_t role = 0;
+            wstring deviceId{};
+            fields >> flow >> role >> deviceId;
+            if (deviceFilter.Accept(flow, role, deviceId, now))
+            {
+                accepted.push_back(L"default " + to_wstring(flow) + L" " + to_wstring(role) + L" " + deviceId);
+            }
+        }
+    }
+
+    return accepted;
+}
+
+
+static void SingleCreation()
+{
+    vector<wstring> accepted = Replay(
+        L"0 created {0.0.0.00000000}.{a}|firefox.exe%b{1}\n"
+    );
+    CHECK(accepted == vector<wstring>({ L"created {0.0.0.00000000}.{a}|firefox.exe%b{1}" }));
+}
+
+static void DoubledCreation()
+{
+    // The audio service notified the same session twice, only the first notification creates the session.
+    vector<wstring> accepted = Replay(
+        L"0 created {0.0.0.00000000}.{a}|firefox.exe%b{1}\n"
+        L"1 created {0.0.0.00000000}.{a}|firefox.exe%b{1}\n"
+        L"2 created {0.0.0.00000000}.{a}|spotify.exe%b{2}\n"
+        L"40 created {0.0.0.00000000}.{a}|firefox.exe%b{1}\n"
+    );
+    CHECK(accepted == vector<wstring>({
+        L"created {0.0.0.00000000}.{a}|firefox.exe%b{1}",
+        L"created {0.0.0.00000000}.{a}|spotify.exe%b{2}"
+    }));
+}
+
+static void ExpiryThenRecreation()
+{
+    // An expired session is forgotten, the application opening a stream again creates the session again (same instance id).
+    vector<wstring> accepted = Replay(
+        L"0 created {a}|game.exe%b{1}\n"
+        L"500 expired {a}|game.exe%b{1}\n"
+        L"501 created {a}|game.exe%b{1}\n"
+        L"502 created {a}|game.exe%b{1}\n"
+        L"900 expired {a}|other.exe%b{2}\n"
+        L"901 created {a}|game.exe%b{1}\n"
+    );
+    CHECK(accepted == vector<wstring>({
+        L"created {a}|game.exe%b{1}",
+        L"created {a}|game.exe%b{1}"
+    }));
+}
+
+static void RepeatedDefaultDevice()
+{
+    // eRender = 0, eConsole = 0, eMultimedia = 1: each role is notified separately and filtered separately.
+    vector<wstring> accepted = Replay(
+        L"0 default 0 0 {speakers}\n"
+        L"0 default 0 1 {speakers}\n"
+        L"10 default 0 0 {speakers}\n"
+        L"10 default 0 1 {speakers}\n"
+        L"499 default 0 0 {speakers}\n"
+        L"500 default 0 0 {speakers}\n"
+    );
+    CHECK(accepted == vector<wstring>({
+        L"default 0 0 {speakers}",
+        L"default 0 1 {speakers}",
+        // Repeats do not extend the window.
+        L"default 0 0 {speakers}"
+    }));
+}
+
+static void SwitchBackInsideWindow()
+{
+    // A -> B -> A within the window: every switch is a real change and is let through.
+    vector<wstring> accepted = Replay(
+        L"0 default 0 0 {A}\n"
+        L"50 default 0 0 {B}\n"
+        L"60 default 0 0 {B}\n"
+        L"100 default 0 0 {A}\n"
+        L"120 default 0 0 {A}\n"
+    );
+    CHECK(accepted == vector<wstring>({
+        L"default 0 0 {A}",
+        L"default 0 0 {B}",
+        L"default 0 0 {A}"
+    }));
+}
+
+static void FlowsAreIndependent()
+{
+    // The same device id on the capture flow is not a repeat of the render notification.
+    vector<wstring> accepted = Replay(
+        L"0 default 0 0 {headset}\n"
+        L"1 default 1 0 {headset}\n"
+        L"2 default 1 0 {headset}\n"
+    );
+    CHECK(accepted == vector<wstring>({
+        L"default 0 0 {headset}",
+        L"default 1 0 {headset}"
+    }));
+}
+
+int main()
+{
+    SingleCreation();
+    DoubledCreation();
+    ExpiryThenRecreation();
+    RepeatedDefaultDevice();
+    SwitchBackInsideWindow();
+    FlowsAreIndependent();
+    return Tests::Result();
+}
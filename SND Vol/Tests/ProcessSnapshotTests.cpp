@@ -0,0 +1,96 @@
+#include <string>
+#include "Check.h"
+#include "ProcessSnapshot.h"
+
+using namespace std;
+using namespace System;
+
+
+static void RecordParseRoundTrip()
+{
+    ProcessSnapshot snapshot{};
+    snapshot.Add(4, 0, L"System");
+    snapshot.Add(1200, 4, L"firefox.exe");
+    snapshot.Add(36, 1200, L"Spotify Helper.exe");
+    snapshot.Add(0xffffffff, 36, L"last.exe");
+
+    wstring recorded = snapshot.Record();
+    // Ordered by process id.
+    CHECK(recorded == L"4 0 System\n36 1200 Spotify Helper.exe\n1200 4 firefox.exe\n4294967295 36 last.exe\n");
+
+    ProcessSnapshot parsed = ProcessSnapshot::Parse(recorded);
+    CHECK(parsed.Size() == 4);
+    CHECK(parsed.Record() == recorded);
+
+    const ProcessSnapshotEntry* entry = parsed.Find(36);
+    CHECK(entry && entry->parentProcessId == 1200 && entry->imageName == L"Spotify Helper.exe");
+    CHECK(parsed.Find(37) == nullptr);
+}
+
+static void ParseCommentsAndLineEndings()
+{
+    ProcessSnapshot snapshot = ProcessSnapshot::Parse(L"# recorded snapshot\r\n\r\n100 4 a.exe\r\n\n101\t100\tb.exe\r\n102 4 c.exe");
+    CHECK(snapshot.Size() == 3);
+
+    // CRLF line endings are not part of the image name.
+    const ProcessSnapshotEntry* a = snapshot.Find(100);
+    CHECK(a && a->imageName == L"a.exe");
+    const ProcessSnapshotEntry* b = snapshot.Find(101);
+    CHECK(b && b->parentProcessId == 100 && b->imageName == L"b.exe");
+    // Last line without a line ending.
+    const ProcessSnapshotEntry* c = snapshot.Find(102);
+    CHECK(c && c->imageName == L"c.exe");
+}
+
+static void ParseMalformedLines()
+{
+    ProcessSnapshot snapshot = ProcessSnapshot::Parse(
+        L"4294967296 4 overflow.exe\n"      // Process id over 32 bits
+        L"99999999999999999999 4 x.exe\n"   // Process id far over 32 bits
+        L"10 4294967296 parent.exe\n"       // Parent process id over 32 bits
+        L"11 4\n"                           // Missing name
+        L"12 4 \r\n"                        // Missing name, trailing space
+        L"13\n"                             // Missing parent and name
+        L"14a 4 letters.exe\n"              // Letters in the process id
+        L"-15 4 negative.exe\n"
+        L" 16 4 indented.exe\n"
+        L"17 4 valid.exe\n"
+    );
+
+    CHECK(snapshot.Size() == 1);
+    CHECK(snapshot.Find(17) != nullptr);
+    CHECK(snapshot.Find(0) == nullptr);
+    CHECK(snapshot.Find(10) == nullptr);
+    CHECK(snapshot.Find(11) == nullptr);
+    CHECK(snapshot.Find(12) == nullptr);
+    CHECK(snapshot.Find(13) == nullptr);
+    CHECK(snapshot.Find(14) == nullptr);
+    CHECK(snapshot.Find(16) == nullptr);
+}
+
+static void ParseDuplicateProcessId()
+{
+    // The process id was reused while the snapshot was recorded, the last line wins.
+    ProcessSnapshot snapshot = ProcessSnapshot::Parse(L"20 4 old.exe\n20 8 new.exe\n");
+    CHECK(snapshot.Size() == 1);
+    const ProcessSnapshotEntry* entry = snapshot.Find(20);
+    CHECK(entry && entry->parentProcessId == 8 && entry->imageName == L"new.exe");
+}
+
+static void DisplayNames()
+{
+    CHECK(ProcessSnapshot::DisplayName(L"firefox.exe") == L"firefox");
+    CHECK(ProcessSnapshot::DisplayName(L"C:\\Program Files\\App\\app.v2.exe") == L"app.v2");
+    CHECK(ProcessSnapshot::DisplayName(L"System") == L"System");
+    CHECK(ProcessSnapshot::DisplayName(L".hidden") == L".hidden");
+}
+
+int main()
+{
+    RecordParseRoundTrip();
+    ParseCommentsAndLineEndings();
+    ParseMalformedLines();
+    ParseDuplicateProcessId();
+    DisplayNames();
+    return Tests::Result();
+}